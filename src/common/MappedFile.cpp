@@ -0,0 +1,173 @@
+/*
+ * Implementation of a MappedFile, a memory mapping of a whole file: read-only, or writable for a file we create.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "MappedFile.h"
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(): data_(0), size_(0), writable_(false),
+#ifdef _WIN32
+	file_(INVALID_HANDLE_VALUE), mapping_(0)
+#else
+	fd_(-1)
+#endif
+{
+}
+
+MappedFile::~MappedFile(){
+	close();
+}
+
+/**
+ * Map a file into memory (read-only)
+ *
+ * @param filename: the file to map
+ * @return true if the file could be mapped
+ */
+bool MappedFile::open(const char* filename){
+	close();
+#ifdef _WIN32
+	file_ = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if(file_ == INVALID_HANDLE_VALUE){
+		return false;
+	}
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(file_, &size) || size.QuadPart == 0){
+		close();
+		return false;
+	}
+	size_ = (size_t) size.QuadPart;
+	mapping_ = CreateFileMappingA(file_, 0, PAGE_READONLY, 0, 0, 0);
+	if(!mapping_){
+		close();
+		return false;
+	}
+	data_ = (const char*) MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+#else
+	fd_ = ::open(filename, O_RDONLY);
+	if(fd_ < 0){
+		return false;
+	}
+	struct stat st;
+	if(fstat(fd_, &st) != 0 || st.st_size == 0){
+		close();
+		return false;
+	}
+	size_ = (size_t) st.st_size;
+	void* p = mmap(0, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+	data_ = (p == MAP_FAILED) ? 0 : (const char*) p;
+#endif
+	if(!data_){
+		close();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Create a file of a given size (overwriting any existing one), and map it into memory, writable. The contents start
+ * out zeroed, and changes get written back to the file by the OS, at the latest when the file is closed.
+ *
+ * @param filename: the file to create
+ * @param size: the size of the file, in bytes
+ * @return true if the file could be created and mapped
+ */
+bool MappedFile::create(const char* filename, size_t size){
+	close();
+	if(size == 0){
+		return false;
+	}
+#ifdef _WIN32
+	file_ = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+	if(file_ == INVALID_HANDLE_VALUE){
+		return false;
+	}
+	LARGE_INTEGER large_size;
+	large_size.QuadPart = (LONGLONG) size;
+	mapping_ = CreateFileMappingA(file_, 0, PAGE_READWRITE, large_size.HighPart, large_size.LowPart, 0);
+	if(!mapping_){
+		close();
+		return false;
+	}
+	data_ = (const char*) MapViewOfFile(mapping_, FILE_MAP_WRITE, 0, 0, 0);
+#else
+	fd_ = ::open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(fd_ < 0){
+		return false;
+	}
+	if(ftruncate(fd_, (off_t) size) != 0){
+		close();
+		return false;
+	}
+	void* p = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+	data_ = (p == MAP_FAILED) ? 0 : (const char*) p;
+#endif
+	size_ = size;
+	if(!data_){
+		close();
+		return false;
+	}
+	writable_ = true;
+	return true;
+}
+
+/**
+ * Unmap the file
+ */
+void MappedFile::close(){
+#ifdef _WIN32
+	if(data_){
+		UnmapViewOfFile(data_);
+	}
+	if(mapping_){
+		CloseHandle(mapping_);
+	}
+	if(file_ != INVALID_HANDLE_VALUE){
+		CloseHandle(file_);
+	}
+	mapping_ = 0;
+	file_ = INVALID_HANDLE_VALUE;
+#else
+	if(data_){
+		munmap((void*) data_, size_);
+	}
+	if(fd_ >= 0){
+		::close(fd_);
+	}
+	fd_ = -1;
+#endif
+	data_ = 0;
+	size_ = 0;
+	writable_ = false;
+}
+
+/**
+ * Returns a pointer to the mapped file contents
+ */
+const char* MappedFile::data() const{
+	return data_;
+}
+
+/**
+ * Returns a writable pointer to the mapped file contents, if the file was mapped by create (0 otherwise)
+ */
+char* MappedFile::writableData(){
+	return writable_ ? const_cast<char*>(data_) : 0;
+}
+
+/**
+ * Returns the size of the mapped file, in bytes
+ */
+size_t MappedFile::size() const{
+	return size_;
+}
@@ -0,0 +1,37 @@
+/*
+ * Definition of a MappedFile, a memory mapping of a whole file: read-only, or writable for a file we create.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef MAPPEDFILE_H_
+#define MAPPEDFILE_H_
+
+#include <cstddef>
+
+class MappedFile{
+private:
+	const char* data_;
+	size_t size_;
+	bool writable_;
+#ifdef _WIN32
+	void* file_;
+	void* mapping_;
+#else
+	int fd_;
+#endif
+	// no copies: the mapping is owned by this object
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+public:
+	MappedFile();
+	~MappedFile();
+	bool open(const char* filename);
+	bool create(const char* filename, size_t size);
+	void close();
+	const char* data() const;
+	char* writableData();
+	size_t size() const;
+};
+
+#endif /* MAPPEDFILE_H_ */
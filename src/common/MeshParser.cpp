@@ -0,0 +1,902 @@
+/*
+ * Implementation of a MeshParser, a parallel loader for OBJ and PLY meshes.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "MeshParser.h"
+#include "ThreadPool.h"
+#include "timestamp.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+#include <stdint.h>
+
+// PLY property types
+enum PlyType { PLY_NONE, PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64 };
+static const size_t ply_type_size[] = { 0, 1, 1, 2, 2, 4, 4, 4, 8 };
+
+// a PLY property: a scalar, or a list (a count, then that many items)
+struct PlyProperty{
+	std::string name_;
+	int type_;
+	bool list_;
+	int count_type_;
+};
+
+// a PLY element: a number of records, all with the same properties
+struct PlyElement{
+	std::string name_;
+	size_t count_;
+	std::vector<PlyProperty> properties_;
+	bool hasLists() const{
+		for(unsigned int i = 0; i < properties_.size(); i++){
+			if(properties_[i].list_){
+				return true;
+			}
+		}
+		return false;
+	}
+	// the size of a record, if it has no lists
+	size_t recordSize() const{
+		size_t size = 0;
+		for(unsigned int i = 0; i < properties_.size(); i++){
+			size += ply_type_size[properties_[i].type_];
+		}
+		return size;
+	}
+};
+
+static const double powers_of_ten[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool is_space(char c){
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline const char* skip_spaces(const char* p, const char* end){
+	while(p < end && is_space(*p)){
+		p++;
+	}
+	return p;
+}
+
+// skip the rest of a token (up to whitespace or the end of the line)
+static inline const char* skip_token(const char* p, const char* end){
+	while(p < end && !is_space(*p) && *p != '\n'){
+		p++;
+	}
+	return p;
+}
+
+static inline const char* next_line(const char* p, const char* end){
+	const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+	return newline ? newline + 1 : end;
+}
+
+// is this the end of the data on a text line?
+static inline bool at_line_end(const char* p, const char* end){
+	return p >= end || *p == '\n' || *p == '#';
+}
+
+/**
+ * Parse a decimal number (as in "-1.25e-3"), after optional spaces. Up to 19 significant digits are exact, and the
+ * result gets rounded once, from double precision.
+ *
+ * @return the first character after the number, or 0 if there's no number
+ */
+static const char* parse_float(const char* p, const char* end, float &value){
+	p = skip_spaces(p, end);
+	bool negative = false;
+	if(p < end && (*p == '-' || *p == '+')){
+		negative = *p == '-';
+		p++;
+	}
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool any = false;
+	for(; p < end && unsigned(*p - '0') < 10; p++){
+		any = true;
+		if(digits < 19){
+			mantissa = 10 * mantissa + (*p - '0');
+			digits += mantissa != 0;
+		}
+		else{
+			exponent++;
+		}
+	}
+	if(p < end && *p == '.'){
+		for(p++; p < end && unsigned(*p - '0') < 10; p++){
+			any = true;
+			if(digits < 19){
+				mantissa = 10 * mantissa + (*p - '0');
+				digits += mantissa != 0;
+				exponent--;
+			}
+		}
+	}
+	if(!any){
+		return 0;
+	}
+	if(p < end && (*p == 'e' || *p == 'E')){
+		const char* q = p + 1;
+		bool negative_exponent = false;
+		if(q < end && (*q == '-' || *q == '+')){
+			negative_exponent = *q == '-';
+			q++;
+		}
+		if(q < end && unsigned(*q - '0') < 10){
+			int e = 0;
+			for(; q < end && unsigned(*q - '0') < 10; q++){
+				e = std::min(10 * e + (*q - '0'), 100000);
+			}
+			exponent += negative_exponent ? -e : e;
+			p = q;
+		}
+	}
+	double v = double(mantissa);
+	if(exponent < 0){
+		v = exponent >= -22 ? v / powers_of_ten[-exponent] : v * pow(10.0, exponent);
+	}
+	else if(exponent > 0){
+		v = exponent <= 22 ? v * powers_of_ten[exponent] : v * pow(10.0, exponent);
+	}
+	value = float(negative ? -v : v);
+	return p;
+}
+
+/**
+ * Parse a decimal integer, after optional spaces
+ *
+ * @return the first character after the number, or 0 if there's no number
+ */
+static const char* parse_int(const char* p, const char* end, int &value){
+	p = skip_spaces(p, end);
+	bool negative = false;
+	if(p < end && (*p == '-' || *p == '+')){
+		negative = *p == '-';
+		p++;
+	}
+	if(p >= end || unsigned(*p - '0') >= 10){
+		return 0;
+	}
+	long long v = 0;
+	for(; p < end && unsigned(*p - '0') < 10; p++){
+		v = std::min(10 * v + (*p - '0'), 1LL << 40);
+	}
+	value = int(negative ? -v : v);
+	return p;
+}
+
+// read a binary (little-endian) PLY value
+static double read_value(const char* p, int type){
+	switch(type){
+	case PLY_INT8: { int8_t v; memcpy(&v, p, 1); return v; }
+	case PLY_UINT8: { uint8_t v; memcpy(&v, p, 1); return v; }
+	case PLY_INT16: { int16_t v; memcpy(&v, p, 2); return v; }
+	case PLY_UINT16: { uint16_t v; memcpy(&v, p, 2); return v; }
+	case PLY_INT32: { int32_t v; memcpy(&v, p, 4); return v; }
+	case PLY_UINT32: { uint32_t v; memcpy(&v, p, 4); return v; }
+	case PLY_FLOAT32: { float v; memcpy(&v, p, 4); return v; }
+	case PLY_FLOAT64: { double v; memcpy(&v, p, 8); return v; }
+	}
+	return 0.0;
+}
+
+// read a binary (little-endian) PLY integer: a list count or a vertex index
+static int read_index(const char* p, int type){
+	switch(type){
+	case PLY_INT8: { int8_t v; memcpy(&v, p, 1); return v; }
+	case PLY_UINT8: { uint8_t v; memcpy(&v, p, 1); return v; }
+	case PLY_INT16: { int16_t v; memcpy(&v, p, 2); return v; }
+	case PLY_UINT16: { uint16_t v; memcpy(&v, p, 2); return v; }
+	case PLY_INT32: { int32_t v; memcpy(&v, p, 4); return v; }
+	case PLY_UINT32: { uint32_t v; memcpy(&v, p, 4); return int(std::min(v, uint32_t(0x7fffffff))); }
+	}
+	return -1;
+}
+
+static int ply_type(const std::string &name){
+	if(name == "char" || name == "int8") return PLY_INT8;
+	if(name == "uchar" || name == "uint8") return PLY_UINT8;
+	if(name == "short" || name == "int16") return PLY_INT16;
+	if(name == "ushort" || name == "uint16") return PLY_UINT16;
+	if(name == "int" || name == "int32") return PLY_INT32;
+	if(name == "uint" || name == "uint32") return PLY_UINT32;
+	if(name == "float" || name == "float32") return PLY_FLOAT32;
+	if(name == "double" || name == "float64") return PLY_FLOAT64;
+	return PLY_NONE;
+}
+
+/**
+ * The size of a binary PLY record which may have lists, or 0 if it doesn't fit before the end of the data
+ */
+static size_t record_size(const PlyElement &element, const char* p, const char* end){
+	size_t size = 0;
+	for(unsigned int i = 0; i < element.properties_.size(); i++){
+		const PlyProperty &property = element.properties_[i];
+		if(property.list_){
+			if(p + size + ply_type_size[property.count_type_] > end){
+				return 0;
+			}
+			int n = read_index(p + size, property.count_type_);
+			if(n < 0){
+				return 0;
+			}
+			size += ply_type_size[property.count_type_] + size_t(n) * ply_type_size[property.type_];
+		}
+		else{
+			size += ply_type_size[property.type_];
+		}
+	}
+	return p + size <= end ? size : 0;
+}
+
+MeshParser::MeshParser(): format_(PARSE_NONE), vertices_(0), faces_(0), failed_(false), vertex_line_(0), face_line_(0),
+		vertex_begin_(0), vertex_stride_(0), vertex_count_(0), face_count_(0), index_type_(PLY_NONE), face_post_(0){
+}
+
+/**
+ * Map a mesh file and work out how to parse it: find its vertices and faces, cut it in blocks, and count the
+ * vertices and faces (text files get counted in parallel).
+ *
+ * @param filename: the mesh file (.obj, or .ply)
+ * @return false if we can't parse this file (it may still be readable by TriMesh::read)
+ */
+bool MeshParser::open(const char* filename){
+	close();
+	if(!file_.open(filename)){
+		return false;
+	}
+	bool ok = false;
+	if(file_.size() >= 4 && memcmp(file_.data(), "ply", 3) == 0 && (file_.data()[3] == '\n' || file_.data()[3] == '\r')){
+		ok = openPly();
+	}
+	else{
+		size_t length = strlen(filename);
+		if(length > 4 && filename[length - 4] == '.' && tolower(filename[length - 3]) == 'o' && tolower(filename[length - 2]) == 'b'
+				&& tolower(filename[length - 1]) == 'j'){
+			ok = openObj();
+		}
+	}
+	if(!ok){
+		close();
+	}
+	return ok;
+}
+
+void MeshParser::close(){
+	file_.close();
+	format_ = PARSE_NONE;
+	blocks_.clear();
+	vertices_ = faces_ = 0;
+}
+
+size_t MeshParser::vertices() const{
+	return vertices_;
+}
+
+size_t MeshParser::faces() const{
+	return faces_;
+}
+
+/**
+ * Run a function for every block, in parallel
+ */
+template <class Body>
+void MeshParser::forBlocks(const Body &body){
+	parallel_for(0, int(blocks_.size()), 1, body);
+}
+
+/**
+ * Give every block the index of its first vertex and face, from the counts of all blocks before it, and total them
+ */
+void MeshParser::sumBlocks(){
+	vertices_ = faces_ = 0;
+	for(unsigned int b = 0; b < blocks_.size(); b++){
+		blocks_[b].first_vertex_ = vertices_;
+		blocks_[b].first_face_ = faces_;
+		vertices_ += blocks_[b].vertices_;
+		faces_ += blocks_[b].faces_;
+	}
+}
+
+/**
+ * Cut a range of a text file in blocks of about PARSER_BLOCK_BYTES, every one ending right after a newline
+ */
+void MeshParser::splitText(size_t begin, size_t end){
+	const char* data = file_.data();
+	while(begin < end){
+		Block block;
+		memset(&block, 0, sizeof(block));
+		block.kind_ = BLOCK_TEXT;
+		block.begin_ = begin;
+		block.end_ = std::min(end, begin + PARSER_BLOCK_BYTES);
+		if(block.end_ < end){
+			const char* newline = static_cast<const char*>(memchr(data + block.end_, '\n', end - block.end_));
+			block.end_ = newline ? newline - data + 1 : end;
+		}
+		blocks_.push_back(block);
+		begin = block.end_;
+	}
+}
+
+/**
+ * Count the vertices and triangles of an OBJ block, or the lines of an ASCII PLY block
+ */
+void MeshParser::countBlock(int b){
+	Block &block = blocks_[b];
+	const char* data = file_.data();
+	const char* p = data + block.begin_;
+	const char* end = data + block.end_;
+	if(format_ == PARSE_PLY_ASCII){
+		size_t lines = 0;
+		while(p < end){
+			p = next_line(p, end);
+			lines++;
+		}
+		block.records_ = lines;
+		return;
+	}
+	while(p < end){
+		p = skip_spaces(p, end);
+		if(p + 1 < end && is_space(p[1])){
+			if(p[0] == 'v'){
+				block.vertices_++;
+			}
+			else if(p[0] == 'f'){
+				int n = 0;
+				const char* q = skip_spaces(p + 1, end);
+				while(!at_line_end(q, end)){
+					n++;
+					q = skip_spaces(skip_token(q, end), end);
+				}
+				block.faces_ += std::max(n - 2, 0);
+			}
+		}
+		p = next_line(p, end);
+	}
+}
+
+/**
+ * Count the vertices and triangles of an ASCII PLY block (once every block knows its first line)
+ */
+void MeshParser::countPlyTriangles(int b){
+	Block &block = blocks_[b];
+	const char* data = file_.data();
+	const char* p = data + block.begin_;
+	const char* end = data + block.end_;
+	for(size_t line = block.first_line_; p < end; line++){
+		if(line >= vertex_line_ && line < vertex_line_ + vertex_count_){
+			block.vertices_++;
+		}
+		else if(line >= face_line_ && line < face_line_ + face_count_){
+			const char* q = p;
+			for(size_t t = 0; t < face_list_.offset_ && q; t++){
+				q = skip_token(skip_spaces(q, end), end);
+			}
+			int n = 0;
+			if(!q || !parse_int(q, end, n)){
+				failed_ = true;
+			}
+			block.faces_ += std::max(n - 2, 0);
+		}
+		p = next_line(p, end);
+	}
+}
+
+/**
+ * Prepare an OBJ file: cut it in blocks, and count their vertices and faces
+ */
+bool MeshParser::openObj(){
+	format_ = PARSE_OBJ;
+	splitText(0, file_.size());
+	forBlocks([this](int b){ countBlock(b); });
+	sumBlocks();
+	return true;
+}
+
+/**
+ * Prepare a PLY file: read its header, find the vertex and face elements, and cut those in blocks
+ */
+bool MeshParser::openPly(){
+	const char* data = file_.data();
+	const char* end = data + file_.size();
+	// read the header, a line at a time
+	std::vector<PlyElement> elements;
+	bool binary = false;
+	const char* p = next_line(data, end);
+	for(;;){
+		if(p >= end){
+			return false;
+		}
+		const char* line_end = next_line(p, end);
+		std::vector<std::string> tokens;
+		for(const char* q = skip_spaces(p, line_end); q < line_end && *q != '\n'; q = skip_spaces(q, line_end)){
+			const char* token_end = skip_token(q, line_end);
+			tokens.push_back(std::string(q, token_end));
+			q = token_end;
+		}
+		p = line_end;
+		if(tokens.empty() || tokens[0] == "comment" || tokens[0] == "obj_info"){
+			continue;
+		}
+		if(tokens[0] == "end_header"){
+			break;
+		}
+		if(tokens[0] == "format" && tokens.size() >= 2){
+			if(tokens[1] == "binary_little_endian"){
+				binary = true;
+			}
+			else if(tokens[1] != "ascii"){
+				return false; // big endian: leave it to TriMesh2
+			}
+		}
+		else if(tokens[0] == "element" && tokens.size() >= 3){
+			PlyElement element;
+			element.name_ = tokens[1];
+			element.count_ = strtoull(tokens[2].c_str(), 0, 10);
+			elements.push_back(element);
+		}
+		else if(tokens[0] == "property" && !elements.empty()){
+			PlyProperty property;
+			property.list_ = tokens.size() >= 5 && tokens[1] == "list";
+			property.count_type_ = property.list_ ? ply_type(tokens[2]) : PLY_NONE;
+			property.type_ = ply_type(tokens[property.list_ ? 3 : 1]);
+			property.name_ = tokens.back();
+			if(property.type_ == PLY_NONE || (property.list_ && property.count_type_ == PLY_NONE)){
+				return false;
+			}
+			elements.back().properties_.push_back(property);
+		}
+		else{
+			return false;
+		}
+	}
+	format_ = binary ? PARSE_PLY_BINARY : PARSE_PLY_ASCII;
+	size_t body = p - data;
+
+	// find the vertex positions and the face index lists in the records
+	const PlyElement* vertex_element = 0;
+	const PlyElement* face_element = 0;
+	size_t line = 0;
+	for(unsigned int e = 0; e < elements.size(); e++){
+		const PlyElement &element = elements[e];
+		if(element.name_ == "vertex" && !vertex_element){
+			vertex_element = &element;
+			vertex_line_ = line;
+			vertex_count_ = element.count_;
+			if(element.hasLists()){
+				return false;
+			}
+			vertex_stride_ = binary ? element.recordSize() : element.properties_.size();
+			const char* names[3] = { "x", "y", "z" };
+			for(int k = 0; k < 3; k++){
+				position_[k].type_ = PLY_NONE;
+				size_t offset = 0;
+				for(unsigned int i = 0; i < element.properties_.size(); i++){
+					if(element.properties_[i].name_ == names[k]){
+						position_[k].offset_ = binary ? offset : i;
+						position_[k].type_ = element.properties_[i].type_;
+					}
+					offset += ply_type_size[element.properties_[i].type_];
+				}
+				if(position_[k].type_ == PLY_NONE){
+					return false;
+				}
+			}
+		}
+		else if(element.name_ == "face" && !face_element){
+			face_element = &element;
+			face_line_ = line;
+			face_count_ = element.count_;
+			// the index list, with only scalars around it
+			int list = -1;
+			size_t offset = 0;
+			face_post_ = 0;
+			for(unsigned int i = 0; i < element.properties_.size(); i++){
+				const PlyProperty &property = element.properties_[i];
+				if(property.list_ && list < 0 && (property.name_ == "vertex_indices" || property.name_ == "vertex_index")){
+					list = i;
+					face_list_.offset_ = binary ? offset : i;
+					face_list_.type_ = property.count_type_;
+					index_type_ = property.type_;
+				}
+				else if(property.list_){
+					return false;
+				}
+				else if(list < 0){
+					offset += ply_type_size[property.type_];
+				}
+				else{
+					face_post_ += ply_type_size[property.type_];
+				}
+			}
+			if(list < 0 || index_type_ == PLY_FLOAT32 || index_type_ == PLY_FLOAT64){
+				return false;
+			}
+		}
+		line += element.count_;
+	}
+	if(!vertex_element){
+		return false;
+	}
+
+	if(!binary){
+		// every record is a line: count lines per block, then what the vertex and face lines hold
+		splitText(body, file_.size());
+		forBlocks([this](int b){ countBlock(b); });
+		size_t first_line = 0;
+		for(unsigned int b = 0; b < blocks_.size(); b++){
+			blocks_[b].first_line_ = first_line;
+			first_line += blocks_[b].records_;
+		}
+		failed_ = false;
+		forBlocks([this](int b){ countPlyTriangles(b); });
+		sumBlocks();
+		return !failed_ && vertices_ == vertex_count_;
+	}
+
+	// binary: walk the elements to find where the vertices and faces are
+	size_t offset = body;
+	for(unsigned int e = 0; e < elements.size(); e++){
+		const PlyElement &element = elements[e];
+		if(&element == vertex_element){
+			vertex_begin_ = offset;
+			if(offset + element.count_ * vertex_stride_ > file_.size()){
+				return false;
+			}
+			for(size_t first = 0; first < element.count_; first += PARSER_BLOCK_RECORDS){
+				Block block;
+				memset(&block, 0, sizeof(block));
+				block.kind_ = BLOCK_VERTICES;
+				block.records_ = std::min(size_t(PARSER_BLOCK_RECORDS), element.count_ - first);
+				block.begin_ = offset + first * vertex_stride_;
+				block.vertices_ = block.records_;
+				blocks_.push_back(block);
+			}
+			offset += element.count_ * vertex_stride_;
+		}
+		else if(&element == face_element){
+			// if the rest of the file is exactly as long as it would be with only triangles, faces are at fixed
+			// offsets and get cut in blocks right away (checking the counts while parsing), otherwise walk them
+			size_t triangle_size = face_list_.offset_ + ply_type_size[face_list_.type_] + 3 * ply_type_size[index_type_] + face_post_;
+			size_t rest = 0;
+			bool fixed = true;
+			for(unsigned int f = e + 1; f < elements.size(); f++){
+				fixed = fixed && !elements[f].hasLists();
+				rest += elements[f].count_ * elements[f].recordSize();
+			}
+			if(fixed && offset + element.count_ * triangle_size + rest == file_.size()){
+				for(size_t first = 0; first < element.count_; first += PARSER_BLOCK_RECORDS){
+					Block block;
+					memset(&block, 0, sizeof(block));
+					block.kind_ = BLOCK_FACES;
+					block.records_ = std::min(size_t(PARSER_BLOCK_RECORDS), element.count_ - first);
+					block.begin_ = offset + first * triangle_size;
+					block.faces_ = block.records_;
+					blocks_.push_back(block);
+				}
+				offset += element.count_ * triangle_size;
+			}
+			else if(!walkFaces(element, offset)){
+				return false;
+			}
+		}
+		else if(!element.hasLists()){
+			offset += element.count_ * element.recordSize();
+		}
+		else{
+			// other elements with lists have to be walked to skip them
+			for(size_t r = 0; r < element.count_; r++){
+				size_t size = record_size(element, data + offset, end);
+				if(!size){
+					return false;
+				}
+				offset += size;
+			}
+		}
+		if(offset > file_.size()){
+			return false;
+		}
+	}
+	sumBlocks();
+	return true;
+}
+
+/**
+ * Walk the face records of a binary PLY file one by one (they hold polygons of any size), cutting them in blocks and
+ * counting their triangles on the way
+ *
+ * @param element: the face element
+ * @param offset: where the face records start, gets set to where they end
+ * @return false if the records run past the end of the file
+ */
+bool MeshParser::walkFaces(const PlyElement &element, size_t &offset){
+	const char* data = file_.data();
+	const char* end = data + file_.size();
+	size_t count_size = ply_type_size[face_list_.type_];
+	size_t index_size = ply_type_size[index_type_];
+	for(size_t first = 0; first < element.count_; first += PARSER_BLOCK_RECORDS){
+		Block block;
+		memset(&block, 0, sizeof(block));
+		block.kind_ = BLOCK_FACES;
+		block.records_ = std::min(size_t(PARSER_BLOCK_RECORDS), element.count_ - first);
+		block.begin_ = offset;
+		for(size_t r = 0; r < block.records_; r++){
+			const char* p = data + offset;
+			if(p + face_list_.offset_ + count_size > end){
+				return false;
+			}
+			int n = read_index(p + face_list_.offset_, face_list_.type_);
+			if(n < 0){
+				return false;
+			}
+			block.faces_ += std::max(n - 2, 0);
+			offset += face_list_.offset_ + count_size + n * index_size + face_post_;
+		}
+		if(data + offset > end){
+			return false;
+		}
+		blocks_.push_back(block);
+	}
+	return true;
+}
+
+/**
+ * The vertex positions inside the file mapping, if the file is binary PLY with vertex records of exactly three
+ * (aligned) floats: those can be used as they are, without parsing or copying
+ */
+const trimesh::point* MeshParser::mappedVertices() const{
+	if(format_ != PARSE_PLY_BINARY || vertex_stride_ != sizeof(trimesh::point)){
+		return 0;
+	}
+	for(int k = 0; k < 3; k++){
+		if(position_[k].type_ != PLY_FLOAT32 || position_[k].offset_ != k * sizeof(float)){
+			return 0;
+		}
+	}
+	const char* vertices = file_.data() + vertex_begin_;
+	if(size_t(vertices) % sizeof(float) != 0){
+		return 0;
+	}
+	return reinterpret_cast<const trimesh::point*>(vertices);
+}
+
+/**
+ * Parse the file straight into the final vertex and face arrays, every block in parallel
+ *
+ * @param vertices: room for vertices() positions (0: don't parse positions, when using mappedVertices)
+ * @param faces: room for faces() faces
+ * @return false if the file turned out to be broken (bad numbers or vertex indices)
+ */
+bool MeshParser::parse(trimesh::point* vertices, trimesh::TriMesh::Face* faces){
+	if(format_ == PARSE_NONE){
+		return false;
+	}
+	failed_ = false;
+	forBlocks([this, vertices, faces](int b){ parseBlock(b, vertices, faces); });
+	return !failed_;
+}
+
+void MeshParser::parseBlock(int b, trimesh::point* vertices, trimesh::TriMesh::Face* faces){
+	const Block &block = blocks_[b];
+	if(format_ == PARSE_OBJ){
+		parseObj(block, vertices, faces);
+	}
+	else if(format_ == PARSE_PLY_ASCII){
+		parsePlyAscii(block, vertices, faces);
+	}
+	else if(block.kind_ == BLOCK_VERTICES){
+		if(vertices){
+			parsePlyVertices(block, vertices);
+		}
+	}
+	else{
+		parsePlyFaces(block, faces);
+	}
+}
+
+/**
+ * Add a polygon as a fan of triangles
+ *
+ * @param indices: the vertex indices of the polygon
+ * @param n: the number of vertices
+ * @param faces: where the next face goes, gets moved past the new ones
+ */
+void MeshParser::addPolygon(const int* indices, int n, trimesh::TriMesh::Face* &faces){
+	for(int k = 2; k < n; k++){
+		*faces++ = trimesh::TriMesh::Face(indices[0], indices[k-1], indices[k]);
+	}
+}
+
+/**
+ * Parse an OBJ block: "v x y z" lines and "f i j k ..." lines (indices may be "i/t/n", or negative to count back
+ * from the last vertex), everything else gets skipped
+ */
+void MeshParser::parseObj(const Block &block, trimesh::point* vertices, trimesh::TriMesh::Face* faces){
+	const char* data = file_.data();
+	const char* p = data + block.begin_;
+	const char* end = data + block.end_;
+	size_t vertex = block.first_vertex_;
+	trimesh::TriMesh::Face* face = faces + block.first_face_;
+	std::vector<int> polygon;
+	while(p < end){
+		p = skip_spaces(p, end);
+		if(p + 1 < end && is_space(p[1])){
+			if(p[0] == 'v'){
+				trimesh::point v;
+				const char* q = p + 1;
+				for(int k = 0; k < 3 && q; k++){
+					q = parse_float(q, end, v[k]);
+				}
+				if(!q){
+					failed_ = true;
+					return;
+				}
+				if(vertices){
+					vertices[vertex] = v;
+				}
+				vertex++;
+			}
+			else if(p[0] == 'f'){
+				polygon.clear();
+				const char* q = skip_spaces(p + 1, end);
+				while(!at_line_end(q, end)){
+					int index;
+					if(!parse_int(q, end, index)){
+						failed_ = true;
+						return;
+					}
+					index = index < 0 ? int(vertex) + index : index - 1;
+					if(index < 0 || size_t(index) >= vertices_){
+						failed_ = true;
+						return;
+					}
+					polygon.push_back(index);
+					q = skip_spaces(skip_token(q, end), end);
+				}
+				if(polygon.size() >= 3){
+					addPolygon(&polygon[0], polygon.size(), face);
+				}
+			}
+		}
+		p = next_line(p, end);
+	}
+}
+
+/**
+ * Parse an ASCII PLY block: vertex lines and face lines, by line number
+ */
+void MeshParser::parsePlyAscii(const Block &block, trimesh::point* vertices, trimesh::TriMesh::Face* faces){
+	const char* data = file_.data();
+	const char* p = data + block.begin_;
+	const char* end = data + block.end_;
+	size_t vertex = block.first_vertex_;
+	trimesh::TriMesh::Face* face = faces + block.first_face_;
+	std::vector<int> polygon;
+	for(size_t line = block.first_line_; p < end; line++){
+		if(line >= vertex_line_ && line < vertex_line_ + vertex_count_){
+			if(vertices){
+				const char* q = p;
+				for(size_t t = 0; t < vertex_stride_ && q; t++){
+					int k = t == position_[0].offset_ ? 0 : t == position_[1].offset_ ? 1 : t == position_[2].offset_ ? 2 : -1;
+					q = k >= 0 ? parse_float(q, end, vertices[vertex][k]) : skip_token(skip_spaces(q, end), end);
+				}
+				if(!q){
+					failed_ = true;
+					return;
+				}
+			}
+			vertex++;
+		}
+		else if(line >= face_line_ && line < face_line_ + face_count_){
+			const char* q = p;
+			for(size_t t = 0; t < face_list_.offset_; t++){
+				q = skip_token(skip_spaces(q, end), end);
+			}
+			int n = 0;
+			q = parse_int(q, end, n);
+			polygon.resize(std::max(n, 0));
+			for(int k = 0; k < n && q; k++){
+				q = parse_int(q, end, polygon[k]);
+				if(q && (polygon[k] < 0 || size_t(polygon[k]) >= vertices_)){
+					q = 0;
+				}
+			}
+			if(!q){
+				failed_ = true;
+				return;
+			}
+			if(n >= 3){
+				addPolygon(&polygon[0], n, face);
+			}
+		}
+		p = next_line(p, end);
+	}
+}
+
+/**
+ * Decode a block of binary PLY vertex records: a plain copy if they're laid out like our positions
+ */
+void MeshParser::parsePlyVertices(const Block &block, trimesh::point* vertices){
+	const char* records = file_.data() + block.begin_;
+	trimesh::point* out = vertices + block.first_vertex_;
+	if(mappedVertices()){
+		memcpy(out, records, block.records_ * sizeof(trimesh::point));
+		return;
+	}
+	for(size_t r = 0; r < block.records_; r++){
+		const char* record = records + r * vertex_stride_;
+		for(int k = 0; k < 3; k++){
+			out[r][k] = float(read_value(record + position_[k].offset_, position_[k].type_));
+		}
+	}
+}
+
+/**
+ * Decode a block of binary PLY face records
+ */
+void MeshParser::parsePlyFaces(const Block &block, trimesh::TriMesh::Face* faces){
+	const char* p = file_.data() + block.begin_;
+	trimesh::TriMesh::Face* face = faces + block.first_face_;
+	trimesh::TriMesh::Face* end = face + block.faces_;
+	size_t count_size = ply_type_size[face_list_.type_];
+	size_t index_size = ply_type_size[index_type_];
+	std::vector<int> polygon;
+	for(size_t r = 0; r < block.records_; r++){
+		int n = read_index(p + face_list_.offset_, face_list_.type_);
+		const char* indices = p + face_list_.offset_ + count_size;
+		polygon.resize(std::max(n, 0));
+		for(int k = 0; k < n; k++){
+			polygon[k] = read_index(indices + k * index_size, index_type_);
+			if(polygon[k] < 0 || size_t(polygon[k]) >= vertices_){
+				failed_ = true;
+				return;
+			}
+		}
+		// (blocks cut at fixed offsets assumed triangles)
+		if(face + std::max(n - 2, 0) > end){
+			failed_ = true;
+			return;
+		}
+		if(n >= 3){
+			addPolygon(&polygon[0], n, face);
+		}
+		p = indices + n * index_size + face_post_;
+	}
+	if(face != end){
+		failed_ = true;
+	}
+}
+
+/**
+ * Read a mesh file into a new TriMesh: OBJ and PLY files with the parallel parser, anything it can't handle with
+ * TriMesh::read
+ *
+ * @param filename: the mesh file
+ * @return the mesh, or 0 if the file can't be read
+ */
+trimesh::TriMesh* MeshParser::read(const char* filename){
+	trimesh::timestamp start = trimesh::now();
+	MeshParser parser;
+	if(parser.open(filename)){
+		trimesh::TriMesh* mesh = new trimesh::TriMesh();
+		mesh->vertices.resize(parser.vertices());
+		mesh->faces.resize(parser.faces());
+		if(parser.parse(mesh->vertices.empty() ? 0 : &mesh->vertices[0], mesh->faces.empty() ? 0 : &mesh->faces[0])){
+			std::cout << "Parsed " << filename << ": " << mesh->vertices.size() << " vertices, " << mesh->faces.size() << " faces ("
+					<< int(1000.0f * (trimesh::now() - start)) << " ms)" << std::endl;
+			return mesh;
+		}
+		delete mesh;
+		std::cout << "Could not parse " << filename << ", falling back to TriMesh2" << std::endl;
+	}
+	return trimesh::TriMesh::read(filename);
+}
@@ -0,0 +1,111 @@
+/*
+ * Definition of a MeshParser, a parallel loader for OBJ and PLY meshes.
+ *
+ * The file gets memory-mapped and cut in blocks, which get parsed in parallel. For text files (OBJ, ASCII PLY),
+ * blocks end at line boundaries: a first pass counts the vertices and (triangulated) faces in every block, a prefix
+ * sum over those gives every block the place its vertices and faces go, and a second pass parses every block straight
+ * into the final arrays. Numbers get parsed by hand, without iostreams or locales.
+ *
+ * Binary little-endian PLY needs no counting pass: records have a fixed size, so blocks are ranges of vertices and
+ * faces. When the file stores positions exactly like we do (three floats per vertex and nothing else), they can be
+ * used straight from the mapping (see mappedVertices), or get copied in one go. Faces with a triangle count per record
+ * get decoded in parallel too.
+ *
+ * Polygons get triangulated as fans, like TriMesh2 does. Files we can't parse (other formats, big-endian PLY, vertex
+ * elements with lists, broken files) are left to TriMesh::read.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef MESHPARSER_H_
+#define MESHPARSER_H_
+
+#include "trimesh_compat.h"
+#include <vector>
+#include <string>
+#include <atomic>
+#include "MappedFile.h"
+
+// bytes of text, or number of binary records, per block
+#define PARSER_BLOCK_BYTES (1 << 20)
+#define PARSER_BLOCK_RECORDS (1 << 16)
+
+struct PlyElement;
+
+class MeshParser{
+private:
+	enum Format { PARSE_NONE, PARSE_OBJ, PARSE_PLY_ASCII, PARSE_PLY_BINARY };
+	enum BlockKind { BLOCK_TEXT, BLOCK_VERTICES, BLOCK_FACES };
+	// a block of the file, and where its vertices and faces go
+	struct Block{
+		BlockKind kind_;
+		size_t begin_; // byte offsets
+		size_t end_;
+		size_t first_line_; // (text) line number of the first line, counted from the first line after the header
+		size_t records_; // (binary) number of vertex or face records
+		size_t first_vertex_;
+		size_t vertices_;
+		size_t first_face_;
+		size_t faces_; // triangles
+	};
+	// how to find what we need in a PLY record: the byte offset (binary) or token index (ASCII), and the type
+	struct PlyField{
+		size_t offset_;
+		int type_;
+	};
+
+	MappedFile file_;
+	Format format_;
+	std::vector<Block> blocks_;
+	size_t vertices_;
+	size_t faces_;
+	std::atomic<bool> failed_;
+	// PLY layout
+	size_t vertex_line_; // (ASCII) the first line of vertices and faces
+	size_t face_line_;
+	size_t vertex_begin_; // (binary) byte offset of the vertex records
+	size_t vertex_stride_; // (binary) size of a vertex record, or (ASCII) number of tokens
+	PlyField position_[3];
+	size_t vertex_count_; // number of vertex and face records
+	size_t face_count_;
+	PlyField face_list_; // the vertex index list: byte offset or token index of its count, and its count type
+	int index_type_; // type of the vertex indices
+	size_t face_post_; // (binary) bytes after the index list
+
+	bool openObj();
+	bool openPly();
+	void splitText(size_t begin, size_t end);
+	bool walkFaces(const PlyElement &element, size_t &offset);
+	void countBlock(int b);
+	void countPlyTriangles(int b);
+	void parseBlock(int b, trimesh::point* vertices, trimesh::TriMesh::Face* faces);
+	void parseObj(const Block &block, trimesh::point* vertices, trimesh::TriMesh::Face* faces);
+	void parsePlyAscii(const Block &block, trimesh::point* vertices, trimesh::TriMesh::Face* faces);
+	void parsePlyVertices(const Block &block, trimesh::point* vertices);
+	void parsePlyFaces(const Block &block, trimesh::TriMesh::Face* faces);
+	void addPolygon(const int* indices, int n, trimesh::TriMesh::Face* &faces);
+	template <class Body> void forBlocks(const Body &body);
+	void sumBlocks();
+
+	// no copies: the mapping is owned by this object
+	MeshParser(const MeshParser&);
+	MeshParser& operator=(const MeshParser&);
+
+public:
+	MeshParser();
+	// map a file, work out its layout and count its vertices and faces (false if we can't parse it)
+	bool open(const char* filename);
+	void close();
+	// number of vertices and (triangulated) faces
+	size_t vertices() const;
+	size_t faces() const;
+	// the vertex positions inside the mapping, if the file stores them exactly like we do (0 otherwise)
+	const trimesh::point* mappedVertices() const;
+	// parse the file into arrays with room for vertices() and faces() elements (vertices can be 0 to skip them)
+	bool parse(trimesh::point* vertices, trimesh::TriMesh::Face* faces);
+
+	// read a mesh file: with the parallel parser if we can, otherwise with TriMesh::read (0 if it can't be read)
+	static trimesh::TriMesh* read(const char* filename);
+};
+
+#endif /* MESHPARSER_H_ */
@@ -0,0 +1,302 @@
+/*
+ * Implementation of a ThreadPool, a persistent set of worker threads which run Tasks by work stealing.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "ThreadPool.h"
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// the pool and worker index of the current thread (no pool: not a worker)
+static thread_local ThreadPool* current_pool = 0;
+static thread_local int current_worker = -1;
+// how many tasks the current thread is running inside each other (tasks waiting for loops run other tasks)
+static thread_local int current_depth = 0;
+
+ThreadPool* ThreadPool::default_ = 0;
+
+Task::Task(): dependencies_(0), pending_(0), group_(0){
+}
+
+Task::~Task(){
+}
+
+/**
+ * Make a task depend on this one: it only becomes ready when this one (and its other dependencies) have run
+ *
+ * @param t: the task which has to wait for this one
+ */
+void Task::precede(Task* t){
+	successors_.push_back(t);
+	t->dependencies_++;
+	t->pending_ = t->dependencies_;
+}
+
+/**
+ * Make the task wait for all its dependencies again, before relaunching the graph it is in
+ */
+void Task::reset(){
+	pending_.store(dependencies_, std::memory_order_relaxed);
+}
+
+ThreadPool::WorkQueue::WorkQueue(): ring_(64), head_(0), size_(0){
+}
+
+/**
+ * Add a task at the back of the queue. The ring only grows when it is full.
+ */
+void ThreadPool::WorkQueue::push(Task* t){
+	std::lock_guard<std::mutex> lock(mutex_);
+	if(size_ == ring_.size()){
+		std::vector<Task*> grown(2 * ring_.size());
+		for(size_t i = 0; i < size_; i++){
+			grown[i] = ring_[(head_ + i) % ring_.size()];
+		}
+		ring_.swap(grown);
+		head_ = 0;
+	}
+	ring_[(head_ + size_) % ring_.size()] = t;
+	size_++;
+}
+
+/**
+ * Take the most recently added task (for the owner of the queue)
+ */
+Task* ThreadPool::WorkQueue::pop(){
+	std::lock_guard<std::mutex> lock(mutex_);
+	if(size_ == 0){
+		return 0;
+	}
+	size_--;
+	return ring_[(head_ + size_) % ring_.size()];
+}
+
+/**
+ * Take the oldest task (for other threads)
+ */
+Task* ThreadPool::WorkQueue::steal(){
+	std::lock_guard<std::mutex> lock(mutex_);
+	if(size_ == 0){
+		return 0;
+	}
+	Task* t = ring_[head_];
+	head_ = (head_ + 1) % ring_.size();
+	size_--;
+	return t;
+}
+
+/**
+ * Constructor: start the worker threads, which sleep until there are tasks
+ *
+ * @param threads: the number of workers (0: one less than the number of hardware threads, since the thread waiting
+ * for the tasks helps too)
+ * @param pin: pin every worker to a core of its own (leaving the first core to the GL thread)
+ */
+ThreadPool::ThreadPool(int threads, bool pin): workers_(threads > 0 ? threads : std::max(1, int(std::thread::hardware_concurrency()) - 1)),
+		pinned_(pin), queued_(0), sleeping_(0), quit_(false), busy_(workers_ + 1){
+	// (the queues and counters are complete before any worker starts looking at them)
+	for(int i = 0; i <= workers_; i++){
+		queues_.push_back(new WorkQueue());
+		busy_[i] = 0;
+	}
+	window_start_ = std::chrono::steady_clock::now();
+	for(int i = 0; i < workers_; i++){
+		threads_.push_back(std::thread(&ThreadPool::run, this, i));
+	}
+}
+
+/**
+ * Destructor: stop the workers (tasks still queued don't run)
+ */
+ThreadPool::~ThreadPool(){
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex_);
+		quit_ = true;
+	}
+	sleep_cv_.notify_all();
+	for(unsigned int i = 0; i < threads_.size(); i++){
+		threads_[i].join();
+	}
+	for(unsigned int i = 0; i < queues_.size(); i++){
+		delete queues_[i];
+	}
+}
+
+int ThreadPool::threads() const{
+	return workers_;
+}
+
+bool ThreadPool::pinned() const{
+	return pinned_;
+}
+
+void ThreadPool::setDefault(ThreadPool* pool){
+	default_ = pool;
+}
+
+ThreadPool* ThreadPool::getDefault(){
+	return default_;
+}
+
+/**
+ * The queue (and utilization slot) of the current thread: its own for a worker, the shared one otherwise
+ */
+int ThreadPool::slot() const{
+	return current_pool == this ? current_worker : workers_;
+}
+
+/**
+ * Pin the current thread (a worker) to a core of its own. Core 0 is left to the GL thread; with more workers than
+ * cores, they wrap around.
+ *
+ * @param worker: the index of the worker
+ */
+void ThreadPool::pin(int worker){
+	int cores = std::max(1, int(std::thread::hardware_concurrency()));
+	int core = (worker + 1) % cores;
+#ifdef _WIN32
+	SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core);
+#else
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(core, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
+/**
+ * Report how busy every worker has been since the last call, and start a new measurement window
+ *
+ * @param busy: filled with the fraction of time each worker spent running tasks, plus (in the last entry) the total
+ * time threads outside the pool spent helping, relative to the window
+ */
+void ThreadPool::utilization(std::vector<float> &busy){
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	double window = double(std::chrono::duration_cast<std::chrono::nanoseconds>(now - window_start_).count());
+	window_start_ = now;
+	busy.resize(busy_.size());
+	for(unsigned int i = 0; i < busy_.size(); i++){
+		busy[i] = window > 0.0 ? float(busy_[i].exchange(0) / window) : 0.0f;
+	}
+}
+
+/**
+ * Make a task ready to run. Its dependencies (if any) should have run, or it has to be reset.
+ *
+ * @param t: the task
+ */
+void ThreadPool::launch(Task* t){
+	push(t);
+}
+
+/**
+ * Queue a ready task: on the current worker's own queue, or on the shared one from outside the pool. Wakes up a
+ * sleeping worker, if there is one.
+ */
+void ThreadPool::push(Task* t){
+	queues_[slot()]->push(t);
+	queued_++;
+	if(sleeping_.load() > 0){
+		std::lock_guard<std::mutex> lock(sleep_mutex_);
+		sleep_cv_.notify_one();
+	}
+}
+
+/**
+ * Find a task to run: from the worker's own queue first, then by stealing from the others (starting at the next one,
+ * so thieves spread out).
+ *
+ * @param worker: the index of the worker looking for work (the number of workers for threads outside the pool)
+ */
+Task* ThreadPool::find(int worker){
+	int n = queues_.size();
+	Task* t = worker < workers_ ? queues_[worker]->pop() : 0;
+	for(int i = 1; !t && i <= n; i++){
+		t = queues_[(worker + i) % n]->steal();
+	}
+	if(t){
+		queued_--;
+	}
+	return t;
+}
+
+/**
+ * Run a task, make its successors whose dependencies have all run ready, and count it as done in its group
+ *
+ * Only the outermost task a thread runs gets timed, so a task which helps with other tasks while it waits for a loop
+ * isn't counted twice.
+ *
+ * @param t: the task
+ * @param worker: the utilization slot of the thread running it
+ */
+void ThreadPool::execute(Task* t, int worker){
+	if(current_depth++ == 0){
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		t->run();
+		busy_[worker] += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+	else{
+		t->run();
+	}
+	current_depth--;
+	for(unsigned int i = 0; i < t->successors_.size(); i++){
+		Task* s = t->successors_[i];
+		if(s->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1){
+			push(s);
+		}
+	}
+	if(t->group_){
+		t->group_->fetch_sub(1, std::memory_order_release);
+	}
+}
+
+/**
+ * Help running tasks until the given counter (typically a task group) drops to zero
+ *
+ * @param counter: the counter to wait for
+ */
+void ThreadPool::wait(std::atomic<int>& counter){
+	int worker = slot();
+	while(counter.load(std::memory_order_acquire) > 0){
+		Task* t = find(worker);
+		if(t){
+			execute(t, worker);
+		}
+		else{
+			std::this_thread::yield();
+		}
+	}
+}
+
+/**
+ * Worker main loop: run tasks, sleep when there are none
+ */
+void ThreadPool::run(int worker){
+	current_pool = this;
+	current_worker = worker;
+	Tracer::nameThread("worker", worker);
+	if(pinned_){
+		pin(worker);
+	}
+	while(true){
+		Task* t = find(worker);
+		if(t){
+			execute(t, worker);
+			continue;
+		}
+		// nothing to do: sleep until something gets queued (checked under the lock, so no wakeup gets lost)
+		std::unique_lock<std::mutex> lock(sleep_mutex_);
+		sleeping_++;
+		sleep_cv_.wait(lock, [this]{ return queued_.load() > 0 || quit_; });
+		sleeping_--;
+		if(quit_){
+			return;
+		}
+	}
+}
@@ -0,0 +1,225 @@
+/*
+ * Definition of a ThreadPool, a persistent set of worker threads which run Tasks by work stealing.
+ *
+ * Every worker has its own queue: tasks a worker makes ready go to the back of its own queue, and it takes its next
+ * task from there too (most recently readied first, while its data is still in cache). A worker without work steals
+ * the oldest task of another queue. Threads which aren't workers (the GL thread, the ExtractionWorker) launch tasks
+ * in a shared queue, and help running tasks while they wait for them.
+ *
+ * Tasks form a graph: a task becomes ready when all tasks it depends on have run. Tasks are meant to be built once
+ * and relaunched every frame, so launching and running them doesn't allocate any memory (once the queues have grown
+ * to the size they need).
+ *
+ * Loops over vertices or faces use parallel_for: the range gets cut in chunks, and the calling thread plus every
+ * worker which picks up the loop claim chunks until they run out, so uneven chunks balance themselves out. Loops can
+ * be nested in tasks (or in other loops): a thread waiting for a loop helps with whatever is queued. On NUMA machines,
+ * the range is split in a block per node, and threads claim chunks from their own node's block first (see numa.h).
+ *
+ * Workers can be pinned to a core each, and the pool measures how busy every worker is.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include "numa.h"
+#include "Tracer.h"
+
+// default number of iterations a parallel_for thread claims at once
+#define PARALLEL_CHUNK 1024
+
+// how to run a parallel loop: the chunk size, and the number of threads working on it (the calling one included,
+// 0: all workers)
+struct KernelConfig{
+	int chunk_;
+	int threads_;
+	KernelConfig(int chunk = PARALLEL_CHUNK, int threads = 0): chunk_(chunk), threads_(threads){}
+};
+
+class Task{
+public:
+	// the tasks which can only run after this one
+	std::vector<Task*> successors_;
+	// number of tasks this one depends on, and how many of those haven't run yet
+	int dependencies_;
+	std::atomic<int> pending_;
+	// counter of unfinished tasks in this task's group, decreased when it has run (can be null)
+	std::atomic<int>* group_;
+
+	Task();
+	virtual ~Task();
+	// the work
+	virtual void run() = 0;
+	// make a task depend on this one
+	void precede(Task* t);
+	// make the task wait for all its dependencies again
+	void reset();
+};
+
+class ThreadPool{
+private:
+	// a worker's queue of ready tasks: the owner works at the back, thieves take from the front
+	class WorkQueue{
+	private:
+		std::mutex mutex_;
+		std::vector<Task*> ring_;
+		size_t head_;
+		size_t size_;
+	public:
+		WorkQueue();
+		void push(Task* t);
+		Task* pop();
+		Task* steal();
+	};
+
+	std::vector<std::thread> threads_;
+	int workers_;
+	bool pinned_;
+	// one queue per worker, plus a shared one for threads outside the pool
+	std::vector<WorkQueue*> queues_;
+	std::atomic<int> queued_;
+	// sleeping workers
+	std::mutex sleep_mutex_;
+	std::condition_variable sleep_cv_;
+	std::atomic<int> sleeping_;
+	bool quit_;
+	// time every worker (and, in the last slot, all threads outside the pool) spent running tasks, in nanoseconds,
+	// since the start of the measurement window
+	std::vector< std::atomic<long long> > busy_;
+	std::chrono::steady_clock::time_point window_start_;
+
+	// the pool parallel_for uses
+	static ThreadPool* default_;
+
+	void run(int worker);
+	int slot() const;
+	Task* find(int worker);
+	void execute(Task* t, int worker);
+	void push(Task* t);
+	void pin(int worker);
+
+public:
+	// constructor: start the given number of workers (0: one less than the number of hardware threads), optionally
+	// pinning every one of them to a core of its own
+	ThreadPool(int threads = 0, bool pin = false);
+	~ThreadPool();
+	// number of worker threads
+	int threads() const;
+	// are the workers pinned to cores?
+	bool pinned() const;
+	// make a task ready (all its dependencies must have run)
+	void launch(Task* t);
+	// run tasks until the counter drops to zero
+	void wait(std::atomic<int>& counter);
+	// run body(i) for every i in [begin, end), in chunks, on the calling thread and (some of) the workers
+	template <class Body> void parallelFor(int begin, int end, int chunk, const Body &body, int threads = 0);
+	// the fraction of time every worker (and the threads outside the pool, in the last entry) spent running tasks
+	// since the last call, which starts a new measurement window
+	void utilization(std::vector<float> &busy);
+
+	// the pool parallel_for runs on (none: loops run serially)
+	static void setDefault(ThreadPool* pool);
+	static ThreadPool* getDefault();
+};
+
+/**
+ * A parallel loop as a task: every thread which runs it claims chunks of the range until there are none left.
+ * The range is split in a block per NUMA node: a thread works on its own node's block first, then helps with the
+ * others. The same task gets launched once per helping worker.
+ */
+template <class Body>
+class ForTask: public Task{
+public:
+	std::atomic<int> next_[NUMA_MAX_NODES];
+	int end_[NUMA_MAX_NODES];
+	int blocks_;
+	int chunk_;
+	const Body &body_;
+	ForTask(int begin, int end, int chunk, int blocks, const Body &body): blocks_(blocks), chunk_(chunk), body_(body){
+		for(int b = 0; b < blocks_; b++){
+			next_[b] = numa_block_start(begin, end, b, blocks_);
+			end_[b] = numa_block_start(begin, end, b + 1, blocks_);
+		}
+	}
+	virtual void run(){
+		TraceScope trace("parallel loop");
+		int home = blocks_ > 1 ? numa_current_node() % blocks_ : 0;
+		for(int k = 0; k < blocks_; k++){
+			int b = (home + k) % blocks_;
+			int from;
+			while((from = next_[b].fetch_add(chunk_, std::memory_order_relaxed)) < end_[b]){
+				int to = std::min(from + chunk_, end_[b]);
+				for(int i = from; i < to; i++){
+					body_(i);
+				}
+			}
+		}
+	}
+};
+
+/**
+ * Run a loop body for every index in a range, in chunks: on the calling thread, and on as many workers as there are
+ * chunks left (up to all of them, or up to the given thread count). Returns when the whole range is done.
+ * Doesn't allocate memory.
+ *
+ * @param begin: the first index
+ * @param end: one past the last index
+ * @param chunk: the number of indices a thread claims at once
+ * @param body: the loop body, called with every index
+ * @param threads: the maximal number of threads working on the loop, the calling one included (0: no limit)
+ */
+template <class Body>
+void ThreadPool::parallelFor(int begin, int end, int chunk, const Body &body, int threads){
+	chunk = std::max(chunk, 1);
+	int chunks = (end - begin + chunk - 1) / chunk;
+	int helpers = std::min(chunks - 1, threads > 0 ? std::min(threads - 1, workers_) : workers_);
+	if(helpers <= 0){
+		for(int i = begin; i < end; i++){
+			body(i);
+		}
+		return;
+	}
+	// split in NUMA node blocks only if every node gets a few chunks
+	int blocks = chunks >= 4 * numa_nodes() ? numa_nodes() : 1;
+	ForTask<Body> task(begin, end, chunk, blocks, body);
+	std::atomic<int> unfinished(helpers);
+	task.group_ = &unfinished;
+	for(int i = 0; i < helpers; i++){
+		launch(&task);
+	}
+	// the calling thread works on the loop too, then waits until every helper has let go of it
+	task.run();
+	wait(unfinished);
+}
+
+/**
+ * Run a loop body for every index in a range on the default pool, or serially if there is none
+ *
+ * @param begin: the first index
+ * @param end: one past the last index
+ * @param chunk: the number of indices a thread claims at once
+ * @param body: the loop body, called with every index
+ * @param threads: the maximal number of threads working on the loop, the calling one included (0: no limit)
+ */
+template <class Body>
+void parallel_for(int begin, int end, int chunk, const Body &body, int threads = 0){
+	ThreadPool* pool = ThreadPool::getDefault();
+	if(pool){
+		pool->parallelFor(begin, end, chunk, body, threads);
+	}
+	else{
+		for(int i = begin; i < end; i++){
+			body(i);
+		}
+	}
+}
+
+#endif /* THREADPOOL_H_ */
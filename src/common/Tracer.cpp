@@ -0,0 +1,165 @@
+/*
+ * Implementation of a Tracer, which records a timeline of what every thread does, for the Chrome trace viewer.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "Tracer.h"
+#include <cstdio>
+#include <cstring>
+
+std::atomic<bool> Tracer::enabled_(false);
+std::atomic<unsigned int> Tracer::generation_(0);
+long long Tracer::start_ = 0;
+std::mutex Tracer::mutex_;
+std::vector<Tracer::Buffer*> Tracer::buffers_;
+
+// the calling thread's buffer (none until it records), and its name
+static thread_local void* current_buffer = 0;
+static thread_local char current_name[32] = "";
+
+Tracer::Buffer::Buffer(): events_(TRACE_BUFFER_EVENTS), count_(0), generation_(0), dropped_(0), id_(0){
+	name_[0] = 0;
+}
+
+/**
+ * Give the calling thread a buffer (buffers live until the program ends, so a trace can still be written after the
+ * thread which recorded it is gone)
+ */
+Tracer::Buffer* Tracer::registerThread(){
+	Buffer* buffer = new Buffer();
+	strncpy(buffer->name_, current_name, sizeof(buffer->name_) - 1);
+	buffer->name_[sizeof(buffer->name_) - 1] = 0;
+	std::lock_guard<std::mutex> lock(mutex_);
+	buffer->id_ = buffers_.size();
+	buffers_.push_back(buffer);
+	current_buffer = buffer;
+	return buffer;
+}
+
+/**
+ * Start a new trace: threads drop the events of the previous one when they record their first new event
+ */
+void Tracer::start(){
+	start_ = now();
+	generation_.fetch_add(1, std::memory_order_release);
+	enabled_.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::stop(){
+	enabled_.store(false, std::memory_order_relaxed);
+}
+
+/**
+ * Record an event in the calling thread's buffer. Only the owning thread writes to a buffer, so this doesn't lock.
+ *
+ * @param name: the name of the event
+ * @param begin: when it began (see now)
+ * @param end: when it ended
+ */
+void Tracer::record(const char* name, long long begin, long long end){
+	Buffer* buffer = static_cast<Buffer*>(current_buffer);
+	if(!buffer){
+		buffer = registerThread();
+	}
+	unsigned int generation = generation_.load(std::memory_order_acquire);
+	if(buffer->generation_.load(std::memory_order_relaxed) != generation){
+		buffer->count_.store(0, std::memory_order_relaxed);
+		buffer->dropped_.store(0, std::memory_order_relaxed);
+		buffer->generation_.store(generation, std::memory_order_release);
+	}
+	unsigned int n = buffer->count_.load(std::memory_order_relaxed);
+	if(n == buffer->events_.size()){
+		buffer->dropped_.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	Event &e = buffer->events_[n];
+	e.name_ = name;
+	e.begin_ = begin;
+	e.end_ = end;
+	// publish the event to the thread writing the trace
+	buffer->count_.store(n + 1, std::memory_order_release);
+}
+
+/**
+ * Name the calling thread, as it shows in traces. Call when the thread starts, before it records anything.
+ *
+ * @param name: the name
+ * @param index: a number to append to it (none if negative), for threads of a pool
+ */
+void Tracer::nameThread(const char* name, int index){
+	if(index >= 0){
+		snprintf(current_name, sizeof(current_name), "%s %d", name, index);
+	}
+	else{
+		snprintf(current_name, sizeof(current_name), "%s", name);
+	}
+}
+
+/**
+ * Write a JSON string
+ */
+static void write_string(FILE* f, const char* s){
+	fputc('"', f);
+	for(; *s; s++){
+		if(*s == '"' || *s == '\\'){
+			fputc('\\', f);
+		}
+		if((unsigned char) *s >= 0x20){
+			fputc(*s, f);
+		}
+	}
+	fputc('"', f);
+}
+
+/**
+ * Write the events of the current trace in the Chrome trace event format: a complete event per recorded event, times
+ * in microseconds since the trace started, plus the names of the threads. Threads may go on recording meanwhile: what
+ * they record after their events got collected doesn't make it into the file.
+ *
+ * @param filename: the file to write
+ * @return false if it couldn't be written
+ */
+bool Tracer::write(const char* filename){
+	FILE* f = fopen(filename, "w");
+	if(!f){
+		return false;
+	}
+	std::vector<Buffer*> buffers;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		buffers = buffers_;
+	}
+	unsigned int generation = generation_.load(std::memory_order_acquire);
+	unsigned int events = 0, dropped = 0;
+	fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	bool first = true;
+	for(unsigned int b = 0; b < buffers.size(); b++){
+		Buffer* buffer = buffers[b];
+		if(buffer->generation_.load(std::memory_order_acquire) != generation){
+			continue; // nothing recorded in this trace
+		}
+		unsigned int n = buffer->count_.load(std::memory_order_acquire);
+		if(buffer->name_[0]){
+			fprintf(f, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": ", first ? "" : ",\n", buffer->id_);
+			write_string(f, buffer->name_);
+			fprintf(f, "}}");
+			first = false;
+		}
+		for(unsigned int i = 0; i < n; i++){
+			const Event &e = buffer->events_[i];
+			fprintf(f, "%s{\"name\": ", first ? "" : ",\n");
+			write_string(f, e.name_);
+			fprintf(f, ", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}", buffer->id_,
+					(e.begin_ - start_) / 1000.0, (e.end_ - e.begin_) / 1000.0);
+			first = false;
+		}
+		events += n;
+		dropped += buffer->dropped_.load(std::memory_order_relaxed);
+	}
+	fprintf(f, "\n]}\n");
+	if(dropped){
+		printf("Trace buffers were full: dropped %u of %u events \n", dropped, events + dropped);
+	}
+	return fclose(f) == 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * Definition of a Tracer, which records a timeline of what every thread does, for the Chrome trace viewer (or Perfetto).
+ *
+ * Stages mark themselves with a TraceScope, which records a (complete) event with their begin and end time when it
+ * goes out of scope. Every thread records in a buffer of its own, which only it writes to: recording doesn't lock, and
+ * doesn't allocate either, except for the buffer itself, on the first event a thread records. A full buffer drops
+ * further events (and counts them).
+ *
+ * Tracing is off by default: a TraceScope then costs a single branch. Starting a trace starts a new generation: every
+ * thread empties its buffer when it records its first event of the new generation, so old events never get mixed in.
+ * Writing a trace (from one thread, while a trace runs or after it stopped) writes the events of the current generation.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef TRACER_H_
+#define TRACER_H_
+
+#include <atomic>
+#include <vector>
+#include <mutex>
+#include <chrono>
+
+// number of events a thread can record per trace
+#define TRACE_BUFFER_EVENTS (1 << 16)
+
+class Tracer{
+private:
+	struct Event{
+		const char* name_; // (must live until the trace is written: a literal, or the name of a profiler section)
+		long long begin_; // nanoseconds
+		long long end_;
+	};
+	// the events of a thread
+	struct Buffer{
+		std::vector<Event> events_;
+		std::atomic<unsigned int> count_;
+		std::atomic<unsigned int> generation_;
+		std::atomic<unsigned int> dropped_;
+		int id_;
+		char name_[32];
+		Buffer();
+	};
+
+	static std::atomic<bool> enabled_;
+	static std::atomic<unsigned int> generation_;
+	static long long start_; // when the current trace started
+	static std::mutex mutex_; // guards the buffer list
+	static std::vector<Buffer*> buffers_;
+
+	static Buffer* registerThread();
+
+public:
+	// is a trace running?
+	static bool enabled(){
+		return enabled_.load(std::memory_order_relaxed);
+	}
+	// the clock events get timed with, in nanoseconds
+	static long long now(){
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+	// start a new trace, or stop recording (the events stay, until the next trace starts)
+	static void start();
+	static void stop();
+	// record an event on the calling thread
+	static void record(const char* name, long long begin, long long end);
+	// name the calling thread in traces (index >= 0 gets appended)
+	static void nameThread(const char* name, int index = -1);
+	// write the events of the current trace as Chrome trace event JSON
+	static bool write(const char* filename);
+};
+
+/**
+ * A traced scope: records an event from its construction to its destruction, if a trace is running.
+ * The name has to live until the trace is written.
+ */
+class TraceScope{
+private:
+	const char* name_;
+	long long begin_;
+public:
+	TraceScope(const char* name): name_(0){
+		if(Tracer::enabled()){
+			name_ = name;
+			begin_ = Tracer::now();
+		}
+	}
+	~TraceScope(){
+		if(name_){
+			Tracer::record(name_, begin_, Tracer::now());
+		}
+	}
+};
+
+#endif /* TRACER_H_ */
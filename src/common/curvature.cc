@@ -0,0 +1,600 @@
+/*
+ * Implementation of the parallel estimation of principal curvatures and curvature derivatives.
+ * The per-face math follows TriMesh2's TriMesh_pointareas.cc and TriMesh_curvature.cc.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "curvature.h"
+#include "lineqn.h"
+#include "ThreadPool.h"
+#include <stdint.h>
+#include <algorithm>
+
+// faces which can't get one of the 64 regular colors end up in this last color, which is processed serially
+static const int OVERFLOW_COLOR = 64;
+
+/**
+ * Greedily color the faces of a mesh, so that faces of the same color don't share any vertex.
+ *
+ * @param *mesh: the mesh
+ * @param &coloring: the resulting face coloring
+ */
+void color_faces(const trimesh::TriMesh* mesh, FaceColoring &coloring){
+	int nv = mesh->vertices.size(), nf = mesh->faces.size();
+	// colors already used by faces around every vertex
+	std::vector<uint64_t> used(nv, 0);
+	std::vector<unsigned char> color(nf);
+	std::vector<int> count(OVERFLOW_COLOR + 1, 0);
+	for(int i = 0; i < nf; i++){
+		const trimesh::TriMesh::Face &f = mesh->faces[i];
+		uint64_t taken = used[f[0]] | used[f[1]] | used[f[2]];
+		int c = 0;
+		while(c < OVERFLOW_COLOR && (taken & (uint64_t(1) << c))){
+			c++;
+		}
+		if(c < OVERFLOW_COLOR){
+			uint64_t bit = uint64_t(1) << c;
+			used[f[0]] |= bit;
+			used[f[1]] |= bit;
+			used[f[2]] |= bit;
+		}
+		color[i] = (unsigned char) c;
+		count[c]++;
+	}
+	// counting sort of the faces by color
+	coloring.start_.assign(OVERFLOW_COLOR + 2, 0);
+	for(int c = 0; c <= OVERFLOW_COLOR; c++){
+		coloring.start_[c+1] = coloring.start_[c] + count[c];
+	}
+	std::vector<int> next(coloring.start_.begin(), coloring.start_.end() - 1);
+	coloring.faces_.resize(nf);
+	for(int i = 0; i < nf; i++){
+		coloring.faces_[next[color[i]]++] = i;
+	}
+}
+
+/**
+ * Rotate a coordinate system to be perpendicular to the given normal
+ */
+static void rot_coord_sys(const trimesh::vec &old_u, const trimesh::vec &old_v, const trimesh::vec &new_norm, trimesh::vec &new_u, trimesh::vec &new_v)
+{
+	new_u = old_u;
+	new_v = old_v;
+	trimesh::vec old_norm = old_u CROSS old_v;
+	float ndot = old_norm DOT new_norm;
+	if (unlikely(ndot <= -1.0f)) {
+		new_u = -new_u;
+		new_v = -new_v;
+		return;
+	}
+	trimesh::vec perp_old = new_norm - ndot * old_norm;
+	trimesh::vec dperp = 1.0f / (1 + ndot) * (old_norm + new_norm);
+	new_u -= dperp * (new_u DOT perp_old);
+	new_v -= dperp * (new_v DOT perp_old);
+}
+
+/**
+ * Reproject a curvature tensor from the basis spanned by old_u and old_v (which are assumed to be unit-length
+ * and perpendicular) to the new_u, new_v basis.
+ */
+static void proj_curv(const trimesh::vec &old_u, const trimesh::vec &old_v, float old_ku, float old_kuv, float old_kv,
+		const trimesh::vec &new_u, const trimesh::vec &new_v, float &new_ku, float &new_kuv, float &new_kv)
+{
+	trimesh::vec r_new_u, r_new_v;
+	rot_coord_sys(new_u, new_v, old_u CROSS old_v, r_new_u, r_new_v);
+
+	float u1 = r_new_u DOT old_u;
+	float v1 = r_new_u DOT old_v;
+	float u2 = r_new_v DOT old_u;
+	float v2 = r_new_v DOT old_v;
+	new_ku  = old_ku * u1*u1 + old_kuv * (2.0f  * u1*v1) + old_kv * v1*v1;
+	new_kuv = old_ku * u1*u2 + old_kuv * (u1*v2 + u2*v1) + old_kv * v1*v2;
+	new_kv  = old_ku * u2*u2 + old_kuv * (2.0f  * u2*v2) + old_kv * v2*v2;
+}
+
+/**
+ * Like proj_curv, but for the curvature derivative tensor
+ */
+static void proj_dcurv(const trimesh::vec &old_u, const trimesh::vec &old_v, const trimesh::Vec<4,float> &old_dcurv,
+		const trimesh::vec &new_u, const trimesh::vec &new_v, trimesh::Vec<4,float> &new_dcurv)
+{
+	trimesh::vec r_new_u, r_new_v;
+	rot_coord_sys(new_u, new_v, old_u CROSS old_v, r_new_u, r_new_v);
+
+	float u1 = r_new_u DOT old_u;
+	float v1 = r_new_u DOT old_v;
+	float u2 = r_new_v DOT old_u;
+	float v2 = r_new_v DOT old_v;
+
+	new_dcurv[0] = old_dcurv[0]*u1*u1*u1 + old_dcurv[1]*3.0f*u1*u1*v1 + old_dcurv[2]*3.0f*u1*v1*v1 + old_dcurv[3]*v1*v1*v1;
+	new_dcurv[1] = old_dcurv[0]*u1*u1*u2 + old_dcurv[1]*(u1*u1*v2 + 2.0f*u2*u1*v1) + old_dcurv[2]*(u2*v1*v1 + 2.0f*u1*v1*v2) + old_dcurv[3]*v1*v1*v2;
+	new_dcurv[2] = old_dcurv[0]*u1*u2*u2 + old_dcurv[1]*(u2*u2*v1 + 2.0f*u1*u2*v2) + old_dcurv[2]*(u1*v2*v2 + 2.0f*u2*v2*v1) + old_dcurv[3]*v1*v2*v2;
+	new_dcurv[3] = old_dcurv[0]*u2*u2*u2 + old_dcurv[1]*3.0f*u2*u2*v2 + old_dcurv[2]*3.0f*u2*v2*v2 + old_dcurv[3]*v2*v2*v2;
+}
+
+/**
+ * Given a curvature tensor, find principal directions and curvatures.
+ * Makes sure that pdir1 and pdir2 are perpendicular to normal.
+ */
+static void diagonalize_curv(const trimesh::vec &old_u, const trimesh::vec &old_v, float ku, float kuv, float kv,
+		const trimesh::vec &new_norm, trimesh::vec &pdir1, trimesh::vec &pdir2, float &k1, float &k2)
+{
+	trimesh::vec r_old_u, r_old_v;
+	rot_coord_sys(old_u, old_v, new_norm, r_old_u, r_old_v);
+
+	float c = 1, s = 0, tt = 0;
+	if (likely(kuv != 0.0f)) {
+		// Jacobi rotation to diagonalize
+		float h = 0.5f * (kv - ku) / kuv;
+		tt = (h < 0.0f) ? 1.0f / (h - sqrt(1.0f + h*h)) : 1.0f / (h + sqrt(1.0f + h*h));
+		c = 1.0f / sqrt(1.0f + tt*tt);
+		s = tt * c;
+	}
+
+	k1 = ku - tt * kuv;
+	k2 = kv + tt * kuv;
+
+	if (fabs(k1) >= fabs(k2)) {
+		pdir1 = c*r_old_u - s*r_old_v;
+	} else {
+		std::swap(k1, k2);
+		pdir1 = s*r_old_u + c*r_old_v;
+	}
+	pdir2 = new_norm CROSS pdir1;
+}
+
+/**
+ * Set up the edges and the N-T-B coordinate system of a face
+ */
+static inline void face_frame(const trimesh::TriMesh* mesh, int i, trimesh::vec e[3], trimesh::vec &t, trimesh::vec &b)
+{
+	const trimesh::TriMesh::Face &f = mesh->faces[i];
+	e[0] = mesh->vertices[f[2]] - mesh->vertices[f[1]];
+	e[1] = mesh->vertices[f[0]] - mesh->vertices[f[2]];
+	e[2] = mesh->vertices[f[1]] - mesh->vertices[f[0]];
+	t = e[0];
+	trimesh::normalize(t);
+	trimesh::vec n = e[0] CROSS e[1];
+	b = n CROSS t;
+	trimesh::normalize(b);
+}
+
+/**
+ * Run a per-face kernel over all faces, one color at a time. Within a color, no two faces share a vertex,
+ * so the kernel can accumulate into its vertices without synchronization.
+ */
+template <class Kernel>
+static void for_each_face_colored(const FaceColoring &coloring, Kernel kernel)
+{
+	for(int c = 0; c < coloring.colors(); c++){
+		int begin = coloring.start_[c], end = coloring.start_[c+1];
+		if(c == OVERFLOW_COLOR){
+			for(int k = begin; k < end; k++){
+				kernel(coloring.faces_[k]);
+			}
+			continue;
+		}
+		parallel_for(begin, end, PARALLEL_CHUNK, [&](int k){
+			kernel(coloring.faces_[k]);
+		});
+	}
+}
+
+/**
+ * Compute the area of the corners of a face
+ */
+static void face_cornerareas(const trimesh::TriMesh* mesh, int i, trimesh::vec &cornerareas)
+{
+	const trimesh::TriMesh::Face &f = mesh->faces[i];
+	// Edges
+	trimesh::vec e[3] = { mesh->vertices[f[2]] - mesh->vertices[f[1]],
+			mesh->vertices[f[0]] - mesh->vertices[f[2]],
+			mesh->vertices[f[1]] - mesh->vertices[f[0]] };
+	// Compute corner weights
+	float area = 0.5f * trimesh::len(e[0] CROSS e[1]);
+	float l2[3] = { trimesh::len2(e[0]), trimesh::len2(e[1]), trimesh::len2(e[2]) };
+	float ew[3] = { l2[0] * (l2[1] + l2[2] - l2[0]),
+			l2[1] * (l2[2] + l2[0] - l2[1]),
+			l2[2] * (l2[0] + l2[1] - l2[2]) };
+	if (ew[0] <= 0.0f) {
+		cornerareas[1] = -0.25f * l2[2] * area / (e[0] DOT e[2]);
+		cornerareas[2] = -0.25f * l2[1] * area / (e[0] DOT e[1]);
+		cornerareas[0] = area - cornerareas[1] - cornerareas[2];
+	} else if (ew[1] <= 0.0f) {
+		cornerareas[2] = -0.25f * l2[0] * area / (e[1] DOT e[0]);
+		cornerareas[0] = -0.25f * l2[2] * area / (e[1] DOT e[2]);
+		cornerareas[1] = area - cornerareas[2] - cornerareas[0];
+	} else if (ew[2] <= 0.0f) {
+		cornerareas[0] = -0.25f * l2[1] * area / (e[2] DOT e[1]);
+		cornerareas[1] = -0.25f * l2[0] * area / (e[2] DOT e[0]);
+		cornerareas[2] = area - cornerareas[0] - cornerareas[1];
+	} else {
+		float ewscale = 0.5f * area / (ew[0] + ew[1] + ew[2]);
+		for (int j = 0; j < 3; j++){
+			cornerareas[j] = ewscale * (ew[(j+1)%3] + ew[(j+2)%3]);
+		}
+	}
+}
+
+/**
+ * Compute the area of every face corner and the voronoi area around every vertex
+ *
+ * @param *mesh: the mesh (cornerareas and pointareas will be filled)
+ * @param &coloring: a face coloring of the mesh
+ */
+void compute_pointareas(trimesh::TriMesh* mesh, const FaceColoring &coloring){
+	int nv = mesh->vertices.size(), nf = mesh->faces.size();
+	mesh->pointareas.clear();
+	mesh->pointareas.resize(nv);
+	mesh->cornerareas.clear();
+	mesh->cornerareas.resize(nf);
+	std::vector<float> &pointareas = mesh->pointareas;
+	std::vector<trimesh::vec> &cornerareas = mesh->cornerareas;
+	for_each_face_colored(coloring, [&](int i){
+		const trimesh::TriMesh::Face &f = mesh->faces[i];
+		face_cornerareas(mesh, i, cornerareas[i]);
+		pointareas[f[0]] += cornerareas[i][0];
+		pointareas[f[1]] += cornerareas[i][1];
+		pointareas[f[2]] += cornerareas[i][2];
+	});
+}
+
+/**
+ * Estimate the curvature tensor of a face, in its own t-b coordinate system, from the variation of normals along its
+ * edges
+ *
+ * @return false if the least squares fit fails
+ */
+static bool face_curvature(const trimesh::TriMesh* mesh, int i, trimesh::vec &t, trimesh::vec &b, float m[3])
+{
+	const trimesh::TriMesh::Face &f = mesh->faces[i];
+	trimesh::vec e[3];
+	face_frame(mesh, i, e, t, b);
+	m[0] = m[1] = m[2] = 0;
+	float w[3][3] = { {0,0,0}, {0,0,0}, {0,0,0} };
+	for (int j = 0; j < 3; j++) {
+		float u = e[j] DOT t;
+		float v = e[j] DOT b;
+		w[0][0] += u*u;
+		w[0][1] += u*v;
+		w[2][2] += v*v;
+		trimesh::vec dn = mesh->normals[f[(j+2)%3]] - mesh->normals[f[(j+1)%3]];
+		float dnu = dn DOT t;
+		float dnv = dn DOT b;
+		m[0] += dnu*u;
+		m[1] += dnu*v + dnv*u;
+		m[2] += dnv*v;
+	}
+	w[1][1] = w[0][0] + w[2][2];
+	w[1][2] = w[0][1];
+	// Least squares solution
+	float diag[3];
+	if (!trimesh::ldltdc<float,3>(w, diag)) {
+		return false;
+	}
+	trimesh::ldltsl<float,3>(w, diag, m, m);
+	return true;
+}
+
+/**
+ * Estimate the curvature derivative tensor of a face, in its own t-b coordinate system, from the variation of the
+ * curvatures of its vertices along its edges
+ *
+ * @return false if the least squares fit fails
+ */
+static bool face_dcurv(const trimesh::TriMesh* mesh, int i, trimesh::vec &t, trimesh::vec &b, trimesh::Vec<4,float> &face_dcurv)
+{
+	const trimesh::TriMesh::Face &f = mesh->faces[i];
+	trimesh::vec e[3];
+	face_frame(mesh, i, e, t, b);
+	// Project curvature tensor from each vertex into this face's coordinate system
+	trimesh::vec fcurv[3];
+	for (int j = 0; j < 3; j++) {
+		int vj = f[j];
+		proj_curv(mesh->pdir1[vj], mesh->pdir2[vj], mesh->curv1[vj], 0, mesh->curv2[vj], t, b, fcurv[j][0], fcurv[j][1], fcurv[j][2]);
+	}
+	// Estimate dcurv based on variation of curvature along edges
+	float m[4] = { 0, 0, 0, 0 };
+	float w[4][4] = { {0,0,0,0}, {0,0,0,0}, {0,0,0,0}, {0,0,0,0} };
+	for (int j = 0; j < 3; j++) {
+		// Variation of curvature along each edge
+		trimesh::vec dfcurv = fcurv[(j+2)%3] - fcurv[(j+1)%3];
+		float u = e[j] DOT t;
+		float v = e[j] DOT b;
+		float u2 = u*u, v2 = v*v, uv = u*v;
+		w[0][0] += u2;
+		w[0][1] += uv;
+		w[3][3] += v2;
+		m[0] += u*dfcurv[0];
+		m[1] += v*dfcurv[0] + 2.0f*u*dfcurv[1];
+		m[2] += 2.0f*v*dfcurv[1] + u*dfcurv[2];
+		m[3] += v*dfcurv[2];
+	}
+	w[1][1] = 2.0f * w[0][0] + w[3][3];
+	w[1][2] = 2.0f * w[0][1];
+	w[2][2] = w[0][0] + 2.0f * w[3][3];
+	w[2][3] = w[0][1];
+	// Least squares solution
+	float d[4];
+	if (!trimesh::ldltdc<float,4>(w, d)) {
+		return false;
+	}
+	trimesh::ldltsl<float,4>(w, d, m, m);
+	face_dcurv = trimesh::Vec<4,float>(m);
+	return true;
+}
+
+/**
+ * Compute principal curvatures and directions for every vertex
+ *
+ * @param *mesh: the mesh, which should have normals (curv1, curv2, pdir1, pdir2 and the point areas will be filled)
+ * @param &coloring: a face coloring of the mesh
+ */
+void compute_curvatures(trimesh::TriMesh* mesh, const FaceColoring &coloring){
+	compute_pointareas(mesh, coloring);
+	// Resize the arrays we'll be using
+	int nv = mesh->vertices.size(), nf = mesh->faces.size();
+	std::vector<float> &curv1 = mesh->curv1, &curv2 = mesh->curv2;
+	std::vector<trimesh::vec> &pdir1 = mesh->pdir1, &pdir2 = mesh->pdir2;
+	curv1.clear(); curv1.resize(nv); curv2.clear(); curv2.resize(nv);
+	pdir1.clear(); pdir1.resize(nv); pdir2.clear(); pdir2.resize(nv);
+	std::vector<float> curv12(nv);
+
+	// Set up an initial coordinate system per vertex (serial, so the last face wins, just like in TriMesh2)
+	for (int i = 0; i < nf; i++) {
+		const trimesh::TriMesh::Face &f = mesh->faces[i];
+		pdir1[f[0]] = mesh->vertices[f[1]] - mesh->vertices[f[0]];
+		pdir1[f[1]] = mesh->vertices[f[2]] - mesh->vertices[f[1]];
+		pdir1[f[2]] = mesh->vertices[f[0]] - mesh->vertices[f[2]];
+	}
+	parallel_for(0, nv, PARALLEL_CHUNK, [&](int i){
+		pdir1[i] = pdir1[i] CROSS mesh->normals[i];
+		trimesh::normalize(pdir1[i]);
+		pdir2[i] = mesh->normals[i] CROSS pdir1[i];
+	});
+
+	// Compute curvature per-face, push it out to the vertices
+	for_each_face_colored(coloring, [&](int i){
+		const trimesh::TriMesh::Face &f = mesh->faces[i];
+		trimesh::vec t, b;
+		float m[3];
+		if (!face_curvature(mesh, i, t, b, m)) {
+			return;
+		}
+		// Push it back out to the vertices
+		for (int j = 0; j < 3; j++) {
+			int vj = f[j];
+			float c1, c12, c2;
+			proj_curv(t, b, m[0], m[1], m[2], pdir1[vj], pdir2[vj], c1, c12, c2);
+			float wt = mesh->cornerareas[i][j] / mesh->pointareas[vj];
+			curv1[vj]  += wt * c1;
+			curv12[vj] += wt * c12;
+			curv2[vj]  += wt * c2;
+		}
+	});
+
+	// Compute principal directions and curvatures at each vertex
+	parallel_for(0, nv, PARALLEL_CHUNK, [&](int i){
+		diagonalize_curv(pdir1[i], pdir2[i], curv1[i], curv12[i], curv2[i], mesh->normals[i], pdir1[i], pdir2[i], curv1[i], curv2[i]);
+	});
+}
+
+/**
+ * Compute the derivatives of curvature for every vertex
+ *
+ * @param *mesh: the mesh, which should have curvatures and point areas (dcurv will be filled)
+ * @param &coloring: a face coloring of the mesh
+ */
+void compute_dcurv(trimesh::TriMesh* mesh, const FaceColoring &coloring){
+	int nv = mesh->vertices.size();
+	std::vector< trimesh::Vec<4,float> > &dcurv = mesh->dcurv;
+	dcurv.clear();
+	dcurv.resize(nv);
+
+	// Compute dcurv per-face, push it out to the vertices
+	for_each_face_colored(coloring, [&](int i){
+		const trimesh::TriMesh::Face &f = mesh->faces[i];
+		trimesh::vec t, b;
+		trimesh::Vec<4,float> fdcurv;
+		if (!face_dcurv(mesh, i, t, b, fdcurv)) {
+			return;
+		}
+		// Push it back out to each vertex
+		for (int j = 0; j < 3; j++) {
+			int vj = f[j];
+			trimesh::Vec<4,float> this_vert_dcurv;
+			proj_dcurv(t, b, fdcurv, mesh->pdir1[vj], mesh->pdir2[vj], this_vert_dcurv);
+			float wt = mesh->cornerareas[i][j] / mesh->pointareas[vj];
+			dcurv[vj] += wt * this_vert_dcurv;
+		}
+	});
+}
+
+/**
+ * Build the vertex to face adjacency of a mesh (the faces around every vertex end up in increasing order)
+ *
+ * @param *mesh: the mesh
+ * @param &adjacency: the resulting adjacency
+ */
+void build_vertex_faces(const trimesh::TriMesh* mesh, VertexFaces &adjacency){
+	int nv = mesh->vertices.size(), nf = mesh->faces.size();
+	adjacency.start_.assign(nv + 1, 0);
+	for(int i = 0; i < nf; i++){
+		for(int j = 0; j < 3; j++){
+			adjacency.start_[mesh->faces[i][j] + 1]++;
+		}
+	}
+	for(int v = 0; v < nv; v++){
+		adjacency.start_[v+1] += adjacency.start_[v];
+	}
+	std::vector<int> next(adjacency.start_.begin(), adjacency.start_.end() - 1);
+	adjacency.faces_.resize(3 * nf);
+	for(int i = 0; i < nf; i++){
+		for(int j = 0; j < 3; j++){
+			adjacency.faces_[next[mesh->faces[i][j]]++] = i;
+		}
+	}
+}
+
+static void sort_unique(std::vector<int> &v){
+	std::sort(v.begin(), v.end());
+	v.erase(std::unique(v.begin(), v.end()), v.end());
+}
+
+// the faces around some vertices
+static void faces_around(const VertexFaces &adjacency, const std::vector<int> &vertices, std::vector<int> &faces){
+	faces.clear();
+	for(unsigned int k = 0; k < vertices.size(); k++){
+		int v = vertices[k];
+		faces.insert(faces.end(), adjacency.faces_.begin() + adjacency.start_[v], adjacency.faces_.begin() + adjacency.start_[v+1]);
+	}
+	sort_unique(faces);
+}
+
+// the vertices of some faces
+static void vertices_of(const trimesh::TriMesh* mesh, const std::vector<int> &faces, std::vector<int> &vertices){
+	vertices.clear();
+	for(unsigned int k = 0; k < faces.size(); k++){
+		const trimesh::TriMesh::Face &f = mesh->faces[faces[k]];
+		vertices.push_back(f[0]);
+		vertices.push_back(f[1]);
+		vertices.push_back(f[2]);
+	}
+	sort_unique(vertices);
+}
+
+// the corner of a face at one of its vertices
+static inline int corner_of(const trimesh::TriMesh::Face &f, int v){
+	return f[0] == v ? 0 : (f[1] == v ? 1 : 2);
+}
+
+/**
+ * Find the region an edit of some vertices affects. Every estimate reaches one ring further than what it is built
+ * from: the faces around the moved vertices change shape, so the normals and point areas of their vertices change,
+ * so the curvatures of the vertices one ring further change, and the curvature derivatives one more ring further.
+ *
+ * @param *mesh: the mesh
+ * @param &adjacency: its vertex to face adjacency
+ * @param &moved: the vertices which moved
+ * @param &region: the resulting region (all lists sorted)
+ */
+void find_curvature_region(const trimesh::TriMesh* mesh, const VertexFaces &adjacency, const std::vector<int> &moved, CurvatureRegion &region){
+	std::vector<int> faces;
+	faces_around(adjacency, moved, region.faces_);
+	vertices_of(mesh, region.faces_, region.normals_);
+	faces_around(adjacency, region.normals_, faces);
+	vertices_of(mesh, faces, region.curvatures_);
+	faces_around(adjacency, region.curvatures_, faces);
+	vertices_of(mesh, faces, region.dcurv_);
+}
+
+/**
+ * Recompute the normals of some vertices, from the faces around them, weighted like TriMesh2's need_normals() does
+ *
+ * @param *mesh: the mesh, which should have normals
+ * @param &adjacency: its vertex to face adjacency
+ * @param &vertices: the vertices to update
+ */
+void update_normals(trimesh::TriMesh* mesh, const VertexFaces &adjacency, const std::vector<int> &vertices){
+	parallel_for(0, int(vertices.size()), PARALLEL_CHUNK, [&](int k){
+		int v = vertices[k];
+		trimesh::vec normal(0.0f, 0.0f, 0.0f);
+		for(int a = adjacency.start_[v]; a < adjacency.start_[v+1]; a++){
+			const trimesh::TriMesh::Face &f = mesh->faces[adjacency.faces_[a]];
+			// edges 0-1, 1-2 and 2-0: a corner is weighted by the squared lengths of the two edges at it
+			trimesh::vec e[3] = { mesh->vertices[f[0]] - mesh->vertices[f[1]],
+					mesh->vertices[f[1]] - mesh->vertices[f[2]],
+					mesh->vertices[f[2]] - mesh->vertices[f[0]] };
+			float l2[3] = { trimesh::len2(e[0]), trimesh::len2(e[1]), trimesh::len2(e[2]) };
+			if (!l2[0] || !l2[1] || !l2[2]) {
+				continue;
+			}
+			int j = corner_of(f, v);
+			normal += (e[0] CROSS e[1]) * (1.0f / (l2[j] * l2[(j+2)%3]));
+		}
+		trimesh::normalize(normal);
+		mesh->normals[v] = normal;
+	});
+}
+
+/**
+ * Recompute the corner areas, point areas, principal curvatures and directions in the region of an edit, with the
+ * normals already updated (see update_normals). Every vertex gathers the estimates of the faces around it, so vertices
+ * can be updated in parallel without coloring; faces shared by several vertices get estimated more than once.
+ *
+ * @param *mesh: the mesh, which should have curvatures, point areas and normals
+ * @param &adjacency: its vertex to face adjacency
+ * @param &region: the region of the edit (see find_curvature_region)
+ */
+void update_curvatures(trimesh::TriMesh* mesh, const VertexFaces &adjacency, const CurvatureRegion &region){
+	parallel_for(0, int(region.faces_.size()), PARALLEL_CHUNK, [&](int k){
+		face_cornerareas(mesh, region.faces_[k], mesh->cornerareas[region.faces_[k]]);
+	});
+	parallel_for(0, int(region.normals_.size()), PARALLEL_CHUNK, [&](int k){
+		int v = region.normals_[k];
+		float area = 0.0f;
+		for(int a = adjacency.start_[v]; a < adjacency.start_[v+1]; a++){
+			int i = adjacency.faces_[a];
+			area += mesh->cornerareas[i][corner_of(mesh->faces[i], v)];
+		}
+		mesh->pointareas[v] = area;
+	});
+	parallel_for(0, int(region.curvatures_.size()), PARALLEL_CHUNK, [&](int k){
+		int v = region.curvatures_[k];
+		if(adjacency.start_[v] == adjacency.start_[v+1]){
+			return;
+		}
+		// the initial coordinate system comes from the last face around the vertex, like in compute_curvatures
+		int last = adjacency.faces_[adjacency.start_[v+1] - 1];
+		const trimesh::TriMesh::Face &lf = mesh->faces[last];
+		trimesh::vec pdir1 = mesh->vertices[lf[(corner_of(lf, v)+1)%3]] - mesh->vertices[v];
+		pdir1 = pdir1 CROSS mesh->normals[v];
+		trimesh::normalize(pdir1);
+		trimesh::vec pdir2 = mesh->normals[v] CROSS pdir1;
+		float curv1 = 0.0f, curv12 = 0.0f, curv2 = 0.0f;
+		for(int a = adjacency.start_[v]; a < adjacency.start_[v+1]; a++){
+			int i = adjacency.faces_[a];
+			trimesh::vec t, b;
+			float m[3];
+			if (!face_curvature(mesh, i, t, b, m)) {
+				continue;
+			}
+			float c1, c12, c2;
+			proj_curv(t, b, m[0], m[1], m[2], pdir1, pdir2, c1, c12, c2);
+			float wt = mesh->cornerareas[i][corner_of(mesh->faces[i], v)] / mesh->pointareas[v];
+			curv1  += wt * c1;
+			curv12 += wt * c12;
+			curv2  += wt * c2;
+		}
+		diagonalize_curv(pdir1, pdir2, curv1, curv12, curv2, mesh->normals[v], mesh->pdir1[v], mesh->pdir2[v], mesh->curv1[v], mesh->curv2[v]);
+	});
+}
+
+/**
+ * Recompute the curvature derivatives in the region of an edit, with the curvatures already updated (see
+ * update_curvatures)
+ *
+ * @param *mesh: the mesh, which should have curvature derivatives, curvatures and point areas
+ * @param &adjacency: its vertex to face adjacency
+ * @param &region: the region of the edit (see find_curvature_region)
+ */
+void update_dcurv(trimesh::TriMesh* mesh, const VertexFaces &adjacency, const CurvatureRegion &region){
+	parallel_for(0, int(region.dcurv_.size()), PARALLEL_CHUNK, [&](int k){
+		int v = region.dcurv_[k];
+		trimesh::Vec<4,float> dcurv(0.0f, 0.0f, 0.0f, 0.0f);
+		for(int a = adjacency.start_[v]; a < adjacency.start_[v+1]; a++){
+			int i = adjacency.faces_[a];
+			trimesh::vec t, b;
+			trimesh::Vec<4,float> fdcurv;
+			if (!face_dcurv(mesh, i, t, b, fdcurv)) {
+				continue;
+			}
+			trimesh::Vec<4,float> this_vert_dcurv;
+			proj_dcurv(t, b, fdcurv, mesh->pdir1[v], mesh->pdir2[v], this_vert_dcurv);
+			float wt = mesh->cornerareas[i][corner_of(mesh->faces[i], v)] / mesh->pointareas[v];
+			dcurv += wt * this_vert_dcurv;
+		}
+		mesh->dcurv[v] = dcurv;
+	});
+}
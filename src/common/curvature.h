@@ -0,0 +1,57 @@
+/*
+ * Parallel estimation of principal curvatures and curvature derivatives.
+ *
+ * These compute the same quantities as TriMesh2's need_pointareas(), need_curvatures() and need_dcurv()
+ * (Rusinkiewicz, "Estimating Curvatures and Their Derivatives on Triangle Meshes", 3DPVT 2004), and store them in the
+ * same TriMesh fields, but run multi-threaded. Both curvature passes are per-face estimates accumulated into the
+ * vertices: faces get colored so that no two faces of the same color share a vertex, and every color is processed
+ * in parallel without write conflicts. The per-vertex diagonalization runs as a separate parallel pass.
+ *
+ * Results match TriMesh2 up to floating-point summation order.
+ *
+ * After some vertices of a mesh move, the update_ functions recompute all of these only in the region the edit
+ * affects (see find_curvature_region), at a cost proportional to the size of the edit: every vertex in the region
+ * gathers the estimates of the faces around it, from a vertex to face adjacency.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef CURVATURE_H_
+#define CURVATURE_H_
+
+#include "trimesh_compat.h"
+#include <vector>
+
+// faces grouped by color: faces_[start_[c]] ... faces_[start_[c+1]-1] don't share any vertices
+struct FaceColoring{
+	std::vector<int> faces_;
+	std::vector<int> start_;
+	int colors() const { return int(start_.size()) - 1; }
+};
+
+// vertex to face adjacency: the faces around vertex v are faces_[start_[v]] ... faces_[start_[v+1]-1]
+struct VertexFaces{
+	std::vector<int> faces_;
+	std::vector<int> start_;
+};
+
+// the region an edit of some vertices affects, as sorted lists
+struct CurvatureRegion{
+	std::vector<int> faces_; // faces around the moved vertices: their shape changes
+	std::vector<int> normals_; // vertices of those faces: their normals and point areas change
+	std::vector<int> curvatures_; // one ring further: their curvatures change
+	std::vector<int> dcurv_; // one more ring further: their curvature derivatives change
+};
+
+void color_faces(const trimesh::TriMesh* mesh, FaceColoring &coloring);
+void compute_pointareas(trimesh::TriMesh* mesh, const FaceColoring &coloring);
+void compute_curvatures(trimesh::TriMesh* mesh, const FaceColoring &coloring);
+void compute_dcurv(trimesh::TriMesh* mesh, const FaceColoring &coloring);
+
+void build_vertex_faces(const trimesh::TriMesh* mesh, VertexFaces &adjacency);
+void find_curvature_region(const trimesh::TriMesh* mesh, const VertexFaces &adjacency, const std::vector<int> &moved, CurvatureRegion &region);
+void update_normals(trimesh::TriMesh* mesh, const VertexFaces &adjacency, const std::vector<int> &vertices);
+void update_curvatures(trimesh::TriMesh* mesh, const VertexFaces &adjacency, const CurvatureRegion &region);
+void update_dcurv(trimesh::TriMesh* mesh, const VertexFaces &adjacency, const CurvatureRegion &region);
+
+#endif /* CURVATURE_H_ */
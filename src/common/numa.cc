@@ -0,0 +1,165 @@
+/*
+ * NUMA-aware placement of per-vertex data.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "numa.h"
+#include <algorithm>
+#include <thread>
+#include <cstdio>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sched.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
+
+// memory policies and flags for mbind (from numaif.h, so we don't depend on libnuma)
+#define NUMA_MPOL_BIND 2
+#define NUMA_MPOL_INTERLEAVE 3
+#define NUMA_MPOL_MF_MOVE (1 << 1)
+
+static NumaPolicy policy = NUMA_PARTITION;
+
+/**
+ * The machine's NUMA topology: the number of nodes, and the node of every cpu. Read once.
+ */
+struct NumaTopology{
+	int nodes_;
+	std::vector<int> cpu_node_;
+	NumaTopology(): nodes_(1){
+		int cpus = std::max(1, int(std::thread::hardware_concurrency()));
+		cpu_node_.assign(cpus, 0);
+#ifdef _WIN32
+		ULONG highest = 0;
+		if(GetNumaHighestNodeNumber(&highest)){
+			nodes_ = int(highest) + 1;
+		}
+		for(int c = 0; c < cpus && c < 64; c++){
+			UCHAR node = 0;
+			if(GetNumaProcessorNode(UCHAR(c), &node) && node != 0xff){
+				cpu_node_[c] = node;
+			}
+		}
+#elif defined(__linux__)
+		char path[128];
+		for(int n = 1; ; n++){
+			snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", n);
+			if(access(path, F_OK) != 0){
+				break;
+			}
+			nodes_ = n + 1;
+		}
+		for(int c = 0; nodes_ > 1 && c < cpus; c++){
+			for(int n = 0; n < nodes_; n++){
+				snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/node%d", c, n);
+				if(access(path, F_OK) == 0){
+					cpu_node_[c] = n;
+					break;
+				}
+			}
+		}
+#endif
+		nodes_ = std::min(nodes_, NUMA_MAX_NODES);
+		for(int c = 0; c < cpus; c++){
+			cpu_node_[c] = std::min(cpu_node_[c], nodes_ - 1);
+		}
+	}
+};
+
+static const NumaTopology& topology(){
+	static NumaTopology t;
+	return t;
+}
+
+int numa_nodes(){
+	return topology().nodes_;
+}
+
+int numa_cpu_node(int cpu){
+	const NumaTopology &t = topology();
+	return cpu >= 0 && cpu < int(t.cpu_node_.size()) ? t.cpu_node_[cpu] : 0;
+}
+
+/**
+ * The NUMA node of the cpu the calling thread runs on right now (pin threads for this to stay meaningful)
+ */
+int numa_current_node(){
+	if(numa_nodes() == 1){
+		return 0;
+	}
+#ifdef _WIN32
+	return numa_cpu_node(int(GetCurrentProcessorNumber()));
+#elif defined(__linux__)
+	return numa_cpu_node(sched_getcpu());
+#else
+	return 0;
+#endif
+}
+
+void numa_set_policy(NumaPolicy p){
+	policy = p;
+}
+
+NumaPolicy numa_policy(){
+	return policy;
+}
+
+/**
+ * The first index of a node's block, when splitting a range in equal contiguous blocks over a number of nodes
+ *
+ * @param begin: the start of the range
+ * @param end: the end of the range
+ * @param node: the node (nodes gives the end of the range)
+ * @param nodes: the number of nodes
+ */
+int numa_block_start(int begin, int end, int node, int nodes){
+	return begin + int((long long)(end - begin) * node / nodes);
+}
+
+#if defined(__linux__) && defined(SYS_mbind)
+/**
+ * Set the memory policy of the whole pages within a memory range, migrating pages which are already there
+ */
+static void bind_range(char* from, char* to, int mode, unsigned long nodemask){
+	static const size_t page = size_t(sysconf(_SC_PAGESIZE));
+	char* first = (char*)((size_t(from) + page - 1) / page * page);
+	char* last = (char*)(size_t(to) / page * page);
+	if(last > first){
+		syscall(SYS_mbind, first, size_t(last - first), mode, &nodemask, sizeof(nodemask) * 8, NUMA_MPOL_MF_MOVE);
+	}
+}
+#endif
+
+/**
+ * Place an array of per-vertex data according to the NUMA policy: split in a block per node (matching the split of
+ * the per-vertex passes), or interleaved over all nodes. Pages which have been touched get migrated, untouched pages
+ * will get allocated on their node when they're first touched.
+ * Only does something on Linux machines with several NUMA nodes: elsewhere, first touch is all we have.
+ *
+ * @param data: the array
+ * @param count: the number of elements
+ * @param element_size: the size of an element, in bytes
+ */
+void numa_place(void* data, size_t count, size_t element_size){
+	int nodes = numa_nodes();
+	if(nodes == 1 || policy == NUMA_OFF || count == 0){
+		return;
+	}
+#if defined(__linux__) && defined(SYS_mbind)
+	char* bytes = static_cast<char*>(data);
+	if(policy == NUMA_INTERLEAVE){
+		bind_range(bytes, bytes + count * element_size, NUMA_MPOL_INTERLEAVE, (1ul << nodes) - 1);
+		return;
+	}
+	for(int n = 0; n < nodes; n++){
+		size_t from = numa_block_start(0, int(count), n, nodes);
+		size_t to = numa_block_start(0, int(count), n + 1, nodes);
+		bind_range(bytes + from * element_size, bytes + to * element_size, NUMA_MPOL_BIND, 1ul << n);
+	}
+#endif
+}
@@ -0,0 +1,52 @@
+/*
+ * NUMA-aware placement of per-vertex data.
+ *
+ * On machines with several NUMA nodes (sockets), memory lives on the node of the thread which first touched it, and
+ * threads on other nodes pay for every access. The per-vertex passes split their range in one contiguous block per
+ * node, and the threads of a node work on their own block first (see ThreadPool::parallelFor). Per-vertex arrays get
+ * placed to match:
+ *  - NUMA_PARTITION: block k of every per-vertex array lives on node k. Fresh (per-frame) buffers get first-touched
+ *    by the threads which will process them, data which already exists gets its pages migrated.
+ *  - NUMA_INTERLEAVE: pages get spread round-robin over all nodes, which balances bandwidth without assuming anything
+ *    about which thread processes what.
+ *  - NUMA_OFF: leave everything where the OS put it.
+ * On single-node machines, or where the OS doesn't support it, placement does nothing.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef NUMA_H_
+#define NUMA_H_
+
+#include <cstddef>
+#include <vector>
+
+// the most NUMA nodes we split work over
+#define NUMA_MAX_NODES 8
+
+enum NumaPolicy { NUMA_OFF, NUMA_PARTITION, NUMA_INTERLEAVE };
+
+// number of NUMA nodes (1 on non-NUMA machines)
+int numa_nodes();
+// the NUMA node of a cpu, and of the cpu the calling thread runs on
+int numa_cpu_node(int cpu);
+int numa_current_node();
+// the placement policy for per-vertex data
+void numa_set_policy(NumaPolicy policy);
+NumaPolicy numa_policy();
+// the first index of a node's block, when splitting [begin, end) in blocks over some number of nodes
+int numa_block_start(int begin, int end, int node, int nodes);
+// place an array of per-vertex data (count elements of the given size) according to the policy
+void numa_place(void* data, size_t count, size_t element_size);
+
+/**
+ * Place the contents of a vector of per-vertex data according to the NUMA policy
+ */
+template <class T, class A>
+void numa_place(std::vector<T, A> &v){
+	if(!v.empty()){
+		numa_place(&v[0], v.size(), sizeof(T));
+	}
+}
+
+#endif /* NUMA_H_ */
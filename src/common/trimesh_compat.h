@@ -0,0 +1,34 @@
+/*
+ * The viewers build against two versions of TriMesh2: the cpu viewer and sc_viewer against one which declares
+ * everything in namespace trimesh, the gpu viewers against an older one which declares everything in the global
+ * namespace. The code they share (this directory) names TriMesh2 through namespace trimesh: when building against the
+ * older version, define TRIMESH_GLOBAL_NAMESPACE, and those names refer to the global ones.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef TRIMESH_COMPAT_H_
+#define TRIMESH_COMPAT_H_
+
+#include "TriMesh.h"
+
+#ifdef TRIMESH_GLOBAL_NAMESPACE
+#include "lineqn.h"
+#include "timestamp.h"
+
+namespace trimesh{
+	using ::TriMesh;
+	using ::Vec;
+	using ::vec;
+	using ::point;
+	using ::len;
+	using ::len2;
+	using ::normalize;
+	using ::ldltdc;
+	using ::ldltsl;
+	using ::timestamp;
+	using ::now;
+}
+#endif
+
+#endif /* TRIMESH_COMPAT_H_ */
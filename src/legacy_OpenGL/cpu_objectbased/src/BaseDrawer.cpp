@@ -15,26 +15,24 @@ BaseDrawer::BaseDrawer(): Drawer(true){
 }
 
 /**
- * Draw the given model, given the current camera position
+ * Draw the given model. The base geometry is view-independent, so there are no segments to submit.
  *
  * @param: Model* : the model to be drawn
- * @param: camera_position: the current camera position, in 3d-coordinates
+ * @param: segments: unused
  */
-void BaseDrawer::draw(Model* m, trimesh::vec camera_position)
+void BaseDrawer::submit(Model* m, const SegmentBuffer& segments)
 {
-	if(isVisible()){
-		// setup vertex and array pointers
-		glBindBufferARB(GL_ARRAY_BUFFER_ARB, m->vbo_positions_);
-		glEnableClientState(GL_VERTEX_ARRAY); // enable vertices
-		glVertexPointer(3, GL_FLOAT,0,0);
-		glBindBufferARB(GL_ARRAY_BUFFER_ARB, m->vbo_normals_);
-		glEnableClientState(GL_NORMAL_ARRAY); // enable vertices
-		glNormalPointer(GL_FLOAT,0,0);
-		glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
-		// draw the mesh_ using triangle strips
-		glColor3f(1,1,1);
-		draw_tstrips(m->mesh_);
-	}
+	// setup vertex and array pointers
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB, m->data_->vbo_positions_);
+	glEnableClientState(GL_VERTEX_ARRAY); // enable vertices
+	glVertexPointer(3, GL_FLOAT,0,0);
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB, m->data_->vbo_normals_);
+	glEnableClientState(GL_NORMAL_ARRAY); // enable vertices
+	glNormalPointer(GL_FLOAT,0,0);
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+	// draw the mesh_ using triangle strips
+	glColor3f(1,1,1);
+	draw_tstrips(m->mesh_);
 }
 
 /**
@@ -52,3 +50,14 @@ void BaseDrawer::draw_tstrips(const trimesh::TriMesh *themesh)
 		t += striplen;
 	}
 }
+
+const char* BaseDrawer::name(){
+	return "base";
+}
+
+/**
+ * Mesh properties this drawer needs: vertex normals and triangle strips for the VBO draw
+ */
+unsigned int BaseDrawer::requirements(){
+	return MESH_NORMALS | MESH_TSTRIPS;
+}
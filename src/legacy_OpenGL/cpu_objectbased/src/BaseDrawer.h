@@ -16,7 +16,9 @@ private:
 	void draw_tstrips(const trimesh::TriMesh* mesh);
 public:
 	BaseDrawer();
-	virtual void draw(Model* m, trimesh::vec camera_position);
+	virtual void submit(Model* m, const SegmentBuffer& segments);
+	virtual unsigned int requirements();
+	virtual const char* name();
 };
 
 #endif /* BASEDRAWER_H_ */
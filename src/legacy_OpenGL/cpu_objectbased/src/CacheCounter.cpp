@@ -0,0 +1,94 @@
+/*
+ * Implementation of a CacheCounter, using perf_event_open on Linux.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "CacheCounter.h"
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+
+/**
+ * Open a hardware counter for this process (all threads it creates from now on included)
+ *
+ * @param config: which hardware event to count
+ * @param group: the fd of the group leader, or -1 to start a new group
+ * @return the counter's fd, or -1 if it couldn't be opened
+ */
+static int open_counter(uint64_t config, int group){
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = config;
+	attr.disabled = group == -1 ? 1 : 0;
+	attr.inherit = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return int(syscall(__NR_perf_event_open, &attr, 0, -1, group, 0));
+}
+
+/**
+ * Read a counter
+ */
+static uint64_t read_counter(int fd){
+	uint64_t value = 0;
+	if(read(fd, &value, sizeof(value)) != sizeof(value)){
+		return 0;
+	}
+	return value;
+}
+#endif
+
+CacheCounter::CacheCounter(): references_fd_(-1), misses_fd_(-1), references_(0), misses_(0){
+#ifdef __linux__
+	references_fd_ = open_counter(PERF_COUNT_HW_CACHE_REFERENCES, -1);
+	if(references_fd_ != -1){
+		misses_fd_ = open_counter(PERF_COUNT_HW_CACHE_MISSES, references_fd_);
+		if(misses_fd_ == -1){
+			close(references_fd_);
+			references_fd_ = -1;
+		}
+	}
+#endif
+}
+
+CacheCounter::~CacheCounter(){
+#ifdef __linux__
+	if(misses_fd_ != -1){
+		close(misses_fd_);
+	}
+	if(references_fd_ != -1){
+		close(references_fd_);
+	}
+#endif
+}
+
+bool CacheCounter::available() const{
+	return misses_fd_ != -1;
+}
+
+void CacheCounter::start(){
+	references_ = 0;
+	misses_ = 0;
+#ifdef __linux__
+	if(available()){
+		ioctl(references_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(references_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+#endif
+}
+
+void CacheCounter::stop(){
+#ifdef __linux__
+	if(available()){
+		ioctl(references_fd_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+		references_ = read_counter(references_fd_);
+		misses_ = read_counter(misses_fd_);
+	}
+#endif
+}
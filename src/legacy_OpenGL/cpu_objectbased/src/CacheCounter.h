@@ -0,0 +1,39 @@
+/*
+ * Definition of a CacheCounter, which counts last-level cache references and misses between start() and stop(),
+ * using the hardware performance counters (Linux perf events). Counting covers the creating thread and every thread
+ * it spawns afterwards, so create the counter before any worker threads (thread pool, extraction worker) get started.
+ *
+ * Where hardware counters aren't available (other platforms, or a kernel which doesn't allow access to them),
+ * available() returns false and all counts stay zero.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef CACHECOUNTER_H_
+#define CACHECOUNTER_H_
+
+#include <stdint.h>
+
+class CacheCounter{
+private:
+	int references_fd_;
+	int misses_fd_;
+	uint64_t references_;
+	uint64_t misses_;
+	// non-copyable
+	CacheCounter(const CacheCounter&);
+	CacheCounter& operator=(const CacheCounter&);
+public:
+	CacheCounter();
+	~CacheCounter();
+	// can we count anything?
+	bool available() const;
+	// reset the counts and start counting
+	void start();
+	// stop counting, the counts are available afterwards
+	void stop();
+	uint64_t references() const { return references_; }
+	uint64_t misses() const { return misses_; }
+};
+
+#endif /* CACHECOUNTER_H_ */
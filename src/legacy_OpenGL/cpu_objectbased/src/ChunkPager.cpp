@@ -0,0 +1,171 @@
+/*
+ * Implementation of a ChunkPager, which keeps the chunks of out-of-core meshes in memory on demand.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "ChunkPager.h"
+#include <algorithm>
+
+/**
+ * Constructor: a pager without stores
+ *
+ * @param budget: the most memory resident chunks can take, in bytes
+ * @param drawers: the drawer stack every resident chunk's model gets
+ */
+ChunkPager::ChunkPager(size_t budget, const std::vector<Drawer*> &drawers): drawers_(drawers), budget_(budget), resident_bytes_(0), frame_(0){
+	// planning runs every frame, and shouldn't allocate
+	loads_.reserve(CHUNK_LOADS_PER_FRAME);
+}
+
+ChunkPager::~ChunkPager(){
+	for(unsigned int c = 0; c < chunks_.size(); c++){
+		if(chunks_[c].model_){
+			evict(c);
+		}
+	}
+	for(unsigned int s = 0; s < stores_.size(); s++){
+		delete stores_[s];
+	}
+}
+
+/**
+ * Add the chunks of a store to the ones we page. None of them is resident yet.
+ *
+ * @param store: an open chunk store, we take ownership
+ */
+void ChunkPager::addStore(ChunkStore* store){
+	stores_.push_back(store);
+	for(int i = 0; i < store->chunks(); i++){
+		const ChunkRecord &record = store->chunk(i);
+		Chunk chunk;
+		chunk.store_ = store;
+		chunk.index_ = i;
+		chunk.bytes_ = size_t(record.nv) * CHUNK_RESIDENT_BYTES_PER_VERTEX + size_t(record.nf) * CHUNK_RESIDENT_BYTES_PER_FACE;
+		chunk.distance_ = 0.0f;
+		chunk.wanted_ = 0;
+		chunk.data_ = 0;
+		chunk.model_ = 0;
+		order_.push_back(chunks_.size());
+		chunks_.push_back(chunk);
+	}
+}
+
+int ChunkPager::stores() const{
+	return stores_.size();
+}
+
+const ChunkStore* ChunkPager::store(int s) const{
+	return stores_[s];
+}
+
+/**
+ * Decide which chunks we want in memory for a camera position: the nearest ones which fit in the budget together.
+ * Doesn't load anything yet (see apply).
+ *
+ * @param camera_position: the camera position, in world coordinates (chunks are placed at the origin)
+ * @return whether some chunks we want aren't resident
+ */
+bool ChunkPager::plan(trimesh::vec camera_position){
+	frame_++;
+	for(unsigned int c = 0; c < chunks_.size(); c++){
+		const ChunkRecord &record = chunks_[c].store_->chunk(chunks_[c].index_);
+		trimesh::point center(record.bsphere[0], record.bsphere[1], record.bsphere[2]);
+		// distance to the nearest point of the chunk's bounding sphere (0 inside it)
+		chunks_[c].distance_ = std::max(0.0f, dist(camera_position, center) - record.bsphere[3]);
+	}
+	const std::vector<Chunk> &chunks = chunks_;
+	std::sort(order_.begin(), order_.end(), [&chunks](int a, int b){ return chunks[a].distance_ < chunks[b].distance_; });
+	loads_.clear();
+	size_t wanted_bytes = 0;
+	for(unsigned int k = 0; k < order_.size(); k++){
+		Chunk &chunk = chunks_[order_[k]];
+		if(wanted_bytes + chunk.bytes_ > budget_){
+			break;
+		}
+		wanted_bytes += chunk.bytes_;
+		chunk.wanted_ = frame_;
+		if(!chunk.model_ && loads_.size() < CHUNK_LOADS_PER_FRAME){
+			loads_.push_back(order_[k]);
+		}
+	}
+	return !loads_.empty();
+}
+
+/**
+ * Load the chunks the last plan asked for, nearest first, evicting chunks we don't want anymore to make room.
+ * Creates and deletes models, so no extraction may be running.
+ */
+void ChunkPager::apply(){
+	for(unsigned int i = 0; i < loads_.size(); i++){
+		if(makeRoom(chunks_[loads_[i]].bytes_)){
+			load(loads_[i]);
+		}
+	}
+	loads_.clear();
+	models_.clear();
+	for(unsigned int c = 0; c < chunks_.size(); c++){
+		if(chunks_[c].model_){
+			models_.push_back(chunks_[c].model_);
+		}
+	}
+}
+
+/**
+ * Evict resident chunks which the last plan doesn't want, least recently wanted first, until some number of bytes
+ * fits in the budget
+ *
+ * @param bytes: the number of bytes to make room for
+ * @return whether they fit
+ */
+bool ChunkPager::makeRoom(size_t bytes){
+	while(resident_bytes_ + bytes > budget_){
+		int victim = -1;
+		for(unsigned int c = 0; c < chunks_.size(); c++){
+			if(chunks_[c].model_ && chunks_[c].wanted_ != frame_ && (victim < 0 || chunks_[c].wanted_ < chunks_[victim].wanted_)){
+				victim = c;
+			}
+		}
+		if(victim < 0){
+			return false;
+		}
+		evict(victim);
+	}
+	return true;
+}
+
+/**
+ * Load a chunk from its store: its mesh data (with the normals, curvatures and derivatives from the store) and a
+ * model with the drawer stack, which builds whatever else the drawers need
+ */
+void ChunkPager::load(int c){
+	Chunk &chunk = chunks_[c];
+	trimesh::TriMesh* mesh = chunk.store_->loadChunk(chunk.index_);
+	// (lines only get extracted from the chunk's own faces: its halo's lines are its neighbours')
+	chunk.data_ = new MeshData(mesh, MESH_NORMALS | MESH_CURVATURES | MESH_DCURV | MESH_FEATURE_SIZE, chunk.store_->featureSize(),
+			chunk.store_->chunk(chunk.index_).owned_faces);
+	chunk.model_ = new Model(chunk.data_);
+	for(unsigned int i = 0; i < drawers_.size(); i++){
+		chunk.model_->pushDrawer(drawers_[i]);
+	}
+	// (all chunks share their statistics)
+	chunk.model_->profile("chunks");
+	resident_bytes_ += chunk.bytes_;
+}
+
+void ChunkPager::evict(int c){
+	Chunk &chunk = chunks_[c];
+	delete chunk.model_;
+	delete chunk.data_;
+	chunk.model_ = 0;
+	chunk.data_ = 0;
+	resident_bytes_ -= chunk.bytes_;
+}
+
+const std::vector<Model*>& ChunkPager::models() const{
+	return models_;
+}
+
+size_t ChunkPager::residentBytes() const{
+	return resident_bytes_;
+}
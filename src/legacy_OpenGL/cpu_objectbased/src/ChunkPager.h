@@ -0,0 +1,80 @@
+/*
+ * Definition of a ChunkPager, which keeps the chunks of out-of-core meshes (see ChunkStore.h) in memory on demand.
+ *
+ * Every frame, the chunks of all stores get ranked by their distance to the camera, and the nearest ones which fit in
+ * the memory budget are the ones we want in memory. Those which aren't get loaded (a few per frame, nearest first,
+ * so paging never stalls a frame for long), every one as MeshData and a Model with the viewer's drawer stack. When a
+ * load doesn't fit, resident chunks we no longer want get evicted, least recently wanted first. Chunks stay resident
+ * while there's room, so moving back and forth doesn't reload them.
+ *
+ * Loading and evicting chunks creates and deletes Models: the caller has to make sure no extraction is running, so
+ * planning (which only ranks) and applying the plan are separate steps.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef CHUNKPAGER_H_
+#define CHUNKPAGER_H_
+
+#include "ChunkStore.h"
+#include "MeshData.h"
+#include "Model.h"
+#include "Drawer.h"
+#include <vector>
+
+// estimated memory of a resident chunk: the mesh with its attributes, connectivity, face normals and the
+// view-dependent buffers, per vertex and per face
+#define CHUNK_RESIDENT_BYTES_PER_VERTEX 128
+#define CHUNK_RESIDENT_BYTES_PER_FACE 64
+// the most chunks to load in one frame
+#define CHUNK_LOADS_PER_FRAME 2
+
+class ChunkPager{
+private:
+	struct Chunk{
+		ChunkStore* store_;
+		int index_;
+		size_t bytes_;
+		float distance_;
+		// the frame this chunk was last wanted in
+		unsigned long long wanted_;
+		MeshData* data_;
+		Model* model_;
+	};
+
+	std::vector<ChunkStore*> stores_;
+	std::vector<Chunk> chunks_;
+	// chunk indices, nearest first
+	std::vector<int> order_;
+	// chunks to load, nearest first
+	std::vector<int> loads_;
+	std::vector<Drawer*> drawers_;
+	std::vector<Model*> models_;
+	size_t budget_;
+	size_t resident_bytes_;
+	unsigned long long frame_;
+
+	void load(int c);
+	void evict(int c);
+	bool makeRoom(size_t bytes);
+
+public:
+	// constructor: a pager for the given memory budget (in bytes), giving resident chunks the given drawer stack
+	ChunkPager(size_t budget, const std::vector<Drawer*> &drawers);
+	~ChunkPager();
+	// page the chunks of a store, we take ownership
+	void addStore(ChunkStore* store);
+	// the stores
+	int stores() const;
+	const ChunkStore* store(int s) const;
+	// rank the chunks for a camera position (in world coordinates), returns whether there are chunks to load
+	bool plan(trimesh::vec camera_position);
+	// load the chunks the last plan wants (evicting others to make room)
+	void apply();
+	// the models of the resident chunks
+	const std::vector<Model*>& models() const;
+	// estimated memory of the resident chunks, in bytes
+	size_t residentBytes() const;
+};
+
+#endif /* CHUNKPAGER_H_ */
@@ -0,0 +1,164 @@
+/*
+ * Implementation of a ChunkStore, the on-disk store of a mesh which gets preprocessed and viewed out of core.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "ChunkStore.h"
+#include <cstring>
+#include <cstddef>
+#include <iostream>
+
+/**
+ * Returns the filename of the chunk store sidecar for a given mesh file
+ *
+ * @param mesh_filename: the source mesh file
+ */
+std::string chunk_store_filename(const char* mesh_filename){
+	return std::string(mesh_filename) + ".scchunks";
+}
+
+/**
+ * Returns the byte size of a chunk array
+ *
+ * @param array: the ChunkArray
+ * @param nv: the number of vertices in the chunk
+ * @param nf: the number of faces in the chunk
+ */
+uint64_t chunk_array_bytes(int array, uint64_t nv, uint64_t nf){
+	switch(array){
+	case CHUNK_POSITIONS: case CHUNK_NORMALS: case CHUNK_PDIR1: case CHUNK_PDIR2: return nv * sizeof(trimesh::vec);
+	case CHUNK_CURV1: case CHUNK_CURV2: return nv * sizeof(float);
+	case CHUNK_DCURV: return nv * sizeof(trimesh::Vec<4,float>);
+	case CHUNK_FACES: return nf * sizeof(trimesh::TriMesh::Face);
+	}
+	return 0;
+}
+
+ChunkStore::ChunkStore(): header_(0), chunks_(0){
+}
+
+/**
+ * Map the chunk store of a mesh file, if there is a complete one built from the current version of the file
+ *
+ * @param mesh_filename: the source mesh file
+ * @param source: size and modification time of the source mesh file, gets the content hash the store recorded
+ * @return true if a valid store was found
+ */
+bool ChunkStore::open(const char* mesh_filename, MeshSource &source){
+	close();
+	if(!file_.open(chunk_store_filename(mesh_filename).c_str()) || file_.size() < sizeof(ChunkStoreHeader)){
+		file_.close();
+		return false;
+	}
+	const ChunkStoreHeader* header = reinterpret_cast<const ChunkStoreHeader*>(file_.data());
+	// (the magic gets written last, so an interrupted build never looks complete)
+	if(memcmp(header->magic, CHUNK_STORE_MAGIC, 8) != 0 || header->version != CHUNK_STORE_VERSION || header->header_size != sizeof(ChunkStoreHeader)){
+		std::cout << "Chunk store is incomplete or has an unknown format, rebuilding" << std::endl;
+		file_.close();
+		return false;
+	}
+	bool restamp;
+	if(!mesh_source_unchanged(mesh_filename, source, header->source_hash, header->source_size, header->source_mtime, restamp)){
+		std::cout << "Chunk store is out of date, rebuilding" << std::endl;
+		file_.close();
+		return false;
+	}
+	if(header->table_offset + header->chunks * sizeof(ChunkRecord) > file_.size()){
+		std::cout << "Chunk store is truncated, rebuilding" << std::endl;
+		file_.close();
+		return false;
+	}
+	const ChunkRecord* chunks = reinterpret_cast<const ChunkRecord*>(file_.data() + header->table_offset);
+	for(uint32_t c = 0; c < header->chunks; c++){
+		for(int a = 0; a < CHUNK_ARRAY_COUNT; a++){
+			if(chunks[c].offset[a] + chunk_array_bytes(a, chunks[c].nv, chunks[c].nf) > file_.size()){
+				std::cout << "Chunk store is truncated, rebuilding" << std::endl;
+				file_.close();
+				return false;
+			}
+		}
+	}
+	header_ = header;
+	chunks_ = chunks;
+	// the source was only touched: record its new modification time (unmapped), so the next run doesn't hash it again
+	if(restamp){
+		std::string filename = chunk_store_filename(mesh_filename);
+		file_.close();
+		restamp_cache_file(filename, offsetof(ChunkStoreHeader, source_mtime), source.mtime);
+		if(!file_.open(filename.c_str())){
+			close();
+			return false;
+		}
+		header_ = reinterpret_cast<const ChunkStoreHeader*>(file_.data());
+		chunks_ = reinterpret_cast<const ChunkRecord*>(file_.data() + header_->table_offset);
+	}
+	return true;
+}
+
+void ChunkStore::close(){
+	file_.close();
+	header_ = 0;
+	chunks_ = 0;
+}
+
+int ChunkStore::chunks() const{
+	return header_ ? int(header_->chunks) : 0;
+}
+
+const ChunkRecord& ChunkStore::chunk(int c) const{
+	return chunks_[c];
+}
+
+trimesh::TriMesh::BSphere ChunkStore::bsphere() const{
+	trimesh::TriMesh::BSphere bsphere;
+	bsphere.center = trimesh::point(header_->bsphere[0], header_->bsphere[1], header_->bsphere[2]);
+	bsphere.r = header_->bsphere[3];
+	bsphere.valid = true;
+	return bsphere;
+}
+
+float ChunkStore::featureSize() const{
+	return header_->feature_size;
+}
+
+uint64_t ChunkStore::vertices() const{
+	return header_->nv;
+}
+
+uint64_t ChunkStore::faces() const{
+	return header_->nf;
+}
+
+/**
+ * Copy a chunk array out of the mapped store into a mesh vector
+ */
+template <class T>
+static void load_array(const MappedFile &file, const ChunkRecord &chunk, int a, std::vector<T> &v){
+	const T* begin = reinterpret_cast<const T*>(file.data() + chunk.offset[a]);
+	v.assign(begin, begin + chunk_array_bytes(a, chunk.nv, chunk.nf) / sizeof(T));
+}
+
+/**
+ * Read a chunk into a new mesh: its positions and faces, and the normals, principal curvatures and directions and
+ * curvature derivatives computed for the whole mesh. Only touches the pages of the store holding this chunk.
+ *
+ * @param c: the chunk
+ * @return the mesh of the chunk (the caller takes ownership)
+ */
+trimesh::TriMesh* ChunkStore::loadChunk(int c) const{
+	const ChunkRecord &chunk = chunks_[c];
+	trimesh::TriMesh* mesh = new trimesh::TriMesh();
+	load_array(file_, chunk, CHUNK_POSITIONS, mesh->vertices);
+	load_array(file_, chunk, CHUNK_NORMALS, mesh->normals);
+	load_array(file_, chunk, CHUNK_PDIR1, mesh->pdir1);
+	load_array(file_, chunk, CHUNK_PDIR2, mesh->pdir2);
+	load_array(file_, chunk, CHUNK_CURV1, mesh->curv1);
+	load_array(file_, chunk, CHUNK_CURV2, mesh->curv2);
+	load_array(file_, chunk, CHUNK_DCURV, mesh->dcurv);
+	load_array(file_, chunk, CHUNK_FACES, mesh->faces);
+	mesh->bsphere.center = trimesh::point(chunk.bsphere[0], chunk.bsphere[1], chunk.bsphere[2]);
+	mesh->bsphere.r = chunk.bsphere[3];
+	mesh->bsphere.valid = true;
+	return mesh;
+}
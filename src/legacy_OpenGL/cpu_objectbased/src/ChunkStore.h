@@ -0,0 +1,89 @@
+/*
+ * Definition of a ChunkStore, the on-disk store of a mesh which gets preprocessed and viewed out of core.
+ *
+ * Meshes too large to hold in memory get cut in spatially compact chunks, which are preprocessed one at a time (see
+ * chunk_preprocess.h) into a sidecar file next to the mesh (<mesh>.scchunks): a header, a table of chunks, then for
+ * every chunk a mesh of its own: positions, normals, principal directions and curvatures, curvature derivatives and
+ * faces (with local vertex indices). Besides its own faces, every chunk holds the ring of faces around them (its halo),
+ * so the connectivity of its own faces is complete and every chunk can be drawn on its own.
+ *
+ * Like the mesh cache, every array starts on a 64-byte boundary so the store can be memory-mapped and chunks get read
+ * straight from the mapping, and the store is keyed by a content hash of the source mesh file.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef CHUNKSTORE_H_
+#define CHUNKSTORE_H_
+
+#include <TriMesh.h>
+#include <string>
+#include <stdint.h>
+#include "MappedFile.h"
+#include "mesh_cache.h"
+
+#define CHUNK_STORE_VERSION 2
+#define CHUNK_STORE_MAGIC "SCCHUNK"
+#define CHUNK_STORE_ALIGNMENT 64
+
+enum ChunkArray{
+	CHUNK_POSITIONS, CHUNK_NORMALS, CHUNK_PDIR1, CHUNK_PDIR2, CHUNK_CURV1, CHUNK_CURV2, CHUNK_DCURV, CHUNK_FACES,
+	CHUNK_ARRAY_COUNT
+};
+
+struct ChunkStoreHeader{
+	char magic[8]; // "SCCHUNK"
+	uint32_t version;
+	uint32_t header_size;
+	uint64_t source_hash; // content hash of the source mesh file
+	uint64_t source_size; // size of the source mesh file
+	uint64_t source_mtime; // modification time of the source mesh file
+	uint64_t nv; // number of vertices of the whole mesh
+	uint64_t nf; // number of faces of the whole mesh
+	uint32_t chunks; // number of chunks
+	float feature_size; // feature size of the whole mesh
+	float bsphere[4]; // bounding sphere center and radius of the whole mesh
+	uint64_t table_offset; // byte offset of the chunk table (an array of ChunkRecords)
+};
+
+struct ChunkRecord{
+	float bsphere[4]; // bounding sphere center and radius of the chunk
+	uint32_t nv; // number of vertices in the chunk's mesh
+	uint32_t nf; // number of faces in the chunk's mesh, halo included
+	uint32_t owned_faces; // the chunk's own faces come first, its halo after those
+	uint32_t padding;
+	uint64_t offset[CHUNK_ARRAY_COUNT]; // byte offset of each array from the start of the file
+};
+
+class ChunkStore{
+private:
+	MappedFile file_;
+	const ChunkStoreHeader* header_;
+	const ChunkRecord* chunks_;
+
+public:
+	ChunkStore();
+	// map the store of a mesh file, if there is one for the given content hash
+	bool open(const char* mesh_filename, MeshSource &source);
+	void close();
+	// number of chunks
+	int chunks() const;
+	// the table entry of a chunk
+	const ChunkRecord& chunk(int c) const;
+	// bounding sphere of the whole mesh
+	trimesh::TriMesh::BSphere bsphere() const;
+	// feature size of the whole mesh
+	float featureSize() const;
+	// number of vertices and faces of the whole mesh
+	uint64_t vertices() const;
+	uint64_t faces() const;
+	// read a chunk into a new mesh, with its normals, curvatures and curvature derivatives
+	trimesh::TriMesh* loadChunk(int c) const;
+};
+
+// the filename of the store of a mesh file
+std::string chunk_store_filename(const char* mesh_filename);
+// the byte size of a chunk array with the given number of vertices and faces
+uint64_t chunk_array_bytes(int array, uint64_t nv, uint64_t nf);
+
+#endif /* CHUNKSTORE_H_ */
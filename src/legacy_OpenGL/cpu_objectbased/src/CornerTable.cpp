@@ -0,0 +1,79 @@
+/*
+ * Implementation of a CornerTable.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "CornerTable.h"
+#include "ThreadPool.h"
+#include <algorithm>
+
+/**
+ * Build the corner table of a mesh: match up corners across their opposite edges, using a flat bucket per lowest
+ * edge vertex (no sorting, no per-vertex vectors). Edges shared by more than two faces, or by two faces with
+ * inconsistent orientation, count as boundary edges.
+ *
+ * @param *mesh: the mesh
+ */
+void CornerTable::build(const trimesh::TriMesh* mesh){
+	const std::vector<trimesh::TriMesh::Face> &faces = mesh->faces;
+	int nv = mesh->vertices.size();
+	int nc = 3 * int(faces.size());
+
+	// bucket corners by the lowest vertex of their opposite edge (counting sort into a flat array)
+	std::vector<int32_t> start(nv + 1, 0);
+	for(int c = 0; c < nc; c++){
+		int a = vertex(faces, next(c));
+		int b = vertex(faces, prev(c));
+		start[std::min(a, b) + 1]++;
+	}
+	for(int v = 0; v < nv; v++){
+		start[v + 1] += start[v];
+	}
+	std::vector<int32_t> bucket(nc);
+	std::vector<int32_t> fill(start.begin(), start.end() - 1);
+	for(int c = 0; c < nc; c++){
+		int a = vertex(faces, next(c));
+		int b = vertex(faces, prev(c));
+		bucket[fill[std::min(a, b)]++] = c;
+	}
+
+	// within a bucket, corners facing the same edge are opposite
+	opposite_.assign(nc, -1);
+	parallel_for(0, nv, PARALLEL_CHUNK, [&](int v){
+		for(int i = start[v]; i < start[v + 1]; i++){
+			int c = bucket[i];
+			int a = vertex(faces, next(c));
+			int b = vertex(faces, prev(c));
+			int match = -1;
+			int count = 0;
+			for(int j = start[v]; j < start[v + 1]; j++){
+				int d = bucket[j];
+				if(d == c){
+					continue;
+				}
+				int da = vertex(faces, next(d));
+				int db = vertex(faces, prev(d));
+				if((da == a && db == b) || (da == b && db == a)){
+					// consistently oriented neighbours traverse the shared edge in opposite directions
+					match = (da == b && db == a) ? d : -2;
+					count++;
+				}
+			}
+			opposite_[c] = (count == 1 && match >= 0) ? match : -1;
+		}
+	});
+
+	// a corner for every vertex: on boundary vertices, pick the one we can swing around the most faces from
+	vertex_corner_.assign(nv, -1);
+	for(int c = 0; c < nc; c++){
+		int v = vertex(faces, c);
+		if(vertex_corner_[v] < 0 || opposite_[prev(c)] < 0){
+			vertex_corner_[v] = c;
+		}
+	}
+}
+
+size_t CornerTable::bytes() const{
+	return (opposite_.size() + vertex_corner_.size()) * sizeof(int32_t);
+}
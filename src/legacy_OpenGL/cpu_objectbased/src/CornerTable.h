@@ -0,0 +1,46 @@
+/*
+ * Definition of a CornerTable, compact connectivity for a triangle mesh (Rossignac's corner table).
+ *
+ * Corner c is corner c % 3 of face c / 3; its vertex is the mesh's faces[c / 3][c % 3], so the face array doubles as
+ * the vertex table. On top of that we keep two flat arrays of 32-bit indices:
+ *  - opposite_: for every corner, the corner facing it across the edge opposite to it (-1 on boundary and
+ *    non-manifold edges). The face on the other side of that edge is opposite(c) / 3;
+ *  - vertex_corner_: for every vertex, one of its corners (-1 for isolated vertices).
+ * That's 16 bytes per face (about 2 corner indices per vertex) instead of TriMesh2's across_edge (12 bytes per face)
+ * plus adjacentfaces and neighbors (a heap-allocated vector per vertex each).
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef CORNERTABLE_H_
+#define CORNERTABLE_H_
+
+#include <TriMesh.h>
+#include <vector>
+#include <stdint.h>
+
+class CornerTable{
+public:
+	std::vector<int32_t> opposite_;
+	std::vector<int32_t> vertex_corner_;
+
+	// build the connectivity of a mesh
+	void build(const trimesh::TriMesh* mesh);
+	// memory used, in bytes
+	size_t bytes() const;
+
+	// corner navigation
+	static int face(int c) { return c / 3; }
+	static int next(int c) { return (c % 3 == 2) ? c - 2 : c + 1; }
+	static int prev(int c) { return (c % 3 == 0) ? c + 2 : c - 1; }
+	static int vertex(const std::vector<trimesh::TriMesh::Face> &faces, int c) { return faces[c / 3][c % 3]; }
+	int opposite(int c) const { return opposite_[c]; }
+	// the face across the edge opposite to corner c (-1 if there is none)
+	int acrossFace(int c) const { return opposite_[c] < 0 ? -1 : opposite_[c] / 3; }
+	// the next corner around the vertex of corner c (-1 when we hit a boundary)
+	int swing(int c) const { int o = opposite_[next(c)]; return o < 0 ? -1 : next(o); }
+	// one corner of vertex v
+	int corner(int v) const { return vertex_corner_[v]; }
+};
+
+#endif /* CORNERTABLE_H_ */
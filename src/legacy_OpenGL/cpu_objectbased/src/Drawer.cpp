@@ -6,15 +6,96 @@
 
 #include "Drawer.h"
 
-Drawer::Drawer(bool isvisible): visible_(isvisible){
+Drawer::Drawer(bool isvisible): visible_(isvisible), suppressed_(false){
 
 }
 
+/**
+ * Default preparation step: compute no per-vertex view-dependent data.
+ *
+ * @param Model* : the model
+ * @param camera_position: the camera position for which to extract, in 3d-coordinates
+ */
+void Drawer::prepare(Model* m, trimesh::vec camera_position){
+}
+
+/**
+ * Default preparation step for a range of vertices: compute no per-vertex view-dependent data.
+ *
+ * @param Model* : the model
+ * @param camera_position: the camera position for which to extract, in 3d-coordinates
+ * @param begin: the first vertex
+ * @param end: one past the last vertex
+ */
+void Drawer::prepareVertices(Model* m, trimesh::vec camera_position, unsigned int begin, unsigned int end){
+}
+
+/**
+ * Default extraction step: drawers which only submit static data have nothing to extract.
+ *
+ * @param Model* : the model
+ * @param camera_position: the camera position for which to extract, in 3d-coordinates
+ * @param segments: the buffer to fill
+ */
+void Drawer::extract(Model* m, trimesh::vec camera_position, SegmentBuffer& segments){
+	segments.clear();
+}
+
+/**
+ * Default extraction step for a range of faces (after prepare, adding to the buffer): nothing to extract.
+ *
+ * @param Model* : the model
+ * @param camera_position: the camera position for which to extract, in 3d-coordinates
+ * @param begin: the first face
+ * @param end: one past the last face
+ * @param segments: the buffer to add to
+ */
+void Drawer::extractFaces(Model* m, trimesh::vec camera_position, unsigned int begin, unsigned int end, SegmentBuffer& segments){
+}
+
+/**
+ * Does this drawer draw silhouettes (contours)? Those get extracted first.
+ */
+bool Drawer::silhouettes(){
+	return false;
+}
+
+/**
+ * Upper bound on the number of segment vertices this drawer extracts per mesh face, used to size segment buffers.
+ */
+unsigned int Drawer::segmentVerticesPerFace(){
+	return 0;
+}
+
+/**
+ * A short name for this kind of drawer, to report its statistics under (see Profiler).
+ */
+const char* Drawer::name(){
+	return "drawer";
+}
+
+/**
+ * The mesh properties (a mask of MeshProperty values) this drawer needs, built by the Model when the drawer gets pushed.
+ */
+unsigned int Drawer::requirements(){
+	return 0;
+}
+
 void Drawer::toggleVisibility(){
-	visible_ = !visible_;
+	visible_.store(!visible_.load());
 }
 
-bool Drawer::isVisible(){
-	return visible_;
+/**
+ * Hide the drawer (or show it again) without touching its visibility toggle
+ */
+void Drawer::setSuppressed(bool suppressed){
+	suppressed_ = suppressed;
 }
 
+bool Drawer::isSuppressed(){
+	return suppressed_;
+}
+
+bool Drawer::isVisible(){
+	return visible_ && !suppressed_;
+}
@@ -2,7 +2,17 @@
  * A virtual class defining a Drawer class, which is an abstract class defining a component
  * that can draw something on the screen, given a certain Model.
  *
- * In its current form, it only forces Drawers to supply a draw method which takes a model and a camera position.
+ * Drawing is split in two phases:
+ *  - extract: compute whatever the drawer needs (e.g. line segments) into a SegmentBuffer. This does not touch
+ *    OpenGL, so it can run on a worker thread.
+ *    The per-vertex view-dependent data it needs can be computed up front, in a separate prepare step, so the
+ *    extraction of several drawers on the same model can run concurrently.
+ *    Line drawers can also extract a range of faces at a time, adding to what's in the buffer (see extractFaces), so
+ *    a Model can extract progressively, the clusters of faces likely to show lines first, preparing the per-vertex
+ *    data of a range of vertices at a time as well (see prepareVertices).
+ *  - submit: push the contents of a SegmentBuffer (or static model data) to OpenGL. This has to run on the GL thread.
+ *
+ * A drawer reports which mesh properties it needs (see MeshProperty), so a Model only builds what its drawers use.
  *
  *      Author: Jeroen Baert
  */
@@ -11,14 +21,28 @@
 #define DRAWER_H_
 
 #include "Model.h"
+#include "SegmentBuffer.h"
+#include <atomic>
 
 class Drawer{
 protected:
-	bool visible_;
+	// (both set on the GL thread while extractions read them on other threads)
+	std::atomic<bool> visible_;
+	std::atomic<bool> suppressed_; // hidden for the sake of the frame rate (see QualityGovernor), whatever visible_ says
 	Drawer(bool isvisible);
 public:
-	virtual void draw(Model* m, trimesh::vec camera_position) = 0;
+	virtual void prepare(Model* m, trimesh::vec camera_position);
+	virtual void prepareVertices(Model* m, trimesh::vec camera_position, unsigned int begin, unsigned int end);
+	virtual void extract(Model* m, trimesh::vec camera_position, SegmentBuffer& segments);
+	virtual void extractFaces(Model* m, trimesh::vec camera_position, unsigned int begin, unsigned int end, SegmentBuffer& segments);
+	virtual bool silhouettes();
+	virtual void submit(Model* m, const SegmentBuffer& segments) = 0;
+	virtual unsigned int segmentVerticesPerFace();
+	virtual unsigned int requirements();
+	virtual const char* name();
 	void toggleVisibility();
+	void setSuppressed(bool suppressed);
+	bool isSuppressed();
 	bool isVisible();
 };
 
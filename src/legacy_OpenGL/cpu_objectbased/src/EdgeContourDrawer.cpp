@@ -21,66 +21,125 @@ EdgeContourDrawer::EdgeContourDrawer(trimesh::vec color = trimesh::vec(0,0,0), f
 }
 
 /**
- * Draw the edge contours for a given model and camera position
+ * Extract the edge contours for a given model and camera position
  *
  * @param Model* : the model
- * @param camera_position: the current camera position, given in 3d-coordinates
+ * @param camera_position: the camera position, given in 3d-coordinates
+ * @param segments: the buffer to store the contour edges in
  */
-void EdgeContourDrawer::draw(Model* m, trimesh::vec camera_position)
+void EdgeContourDrawer::extract(Model* m, trimesh::vec camera_position, SegmentBuffer& segments)
 {
-	if(isVisible()){
-		// setup OpenGL for nice linedrawing
-		glPolygonOffset(5.0f, 30.0f);
-		glEnable(GL_LINE_SMOOTH); // line anti-aliasing
-		glDisable(GL_LIGHTING);
-		glEnable(GL_POLYGON_OFFSET_FILL);
-		// set color and linewidth_
-		glLineWidth(linewidth_);
-		glColor3f(linecolor_[0],linecolor_[1],linecolor_[2]);
-		// find contour edges
-		find_edges(m,camera_position);
-		// flush draw buffer to draw found lines
-		flushDrawBuffer();
-	}
+	segments.clear();
+	// find contour edges
+	find_edges(m,camera_position,0,m->data_->line_faces_,segments);
+}
+
+/**
+ * Extract the edge contours on a range of faces, adding them to the buffer
+ *
+ * @param Model* : the model
+ * @param camera_position: the camera position, given in 3d-coordinates
+ * @param begin: the first face
+ * @param end: one past the last face
+ * @param segments: the buffer to add the contour edges to
+ */
+void EdgeContourDrawer::extractFaces(Model* m, trimesh::vec camera_position, unsigned int begin, unsigned int end, SegmentBuffer& segments)
+{
+	find_edges(m,camera_position,begin,end,segments);
 }
 
 /**
- * Finds the contour edges for a given model and camera position and buffers them
+ * Draw previously extracted edge contours
  *
  * @param Model* : the model
- * @param camera_position: the current camera position, given in 3d-coordinates
+ * @param segments: the extracted contour edges
  */
-void EdgeContourDrawer::find_edges(Model* m, trimesh::vec camera_position)
+void EdgeContourDrawer::submit(Model* m, const SegmentBuffer& segments)
+{
+	// setup OpenGL for nice linedrawing
+	glPolygonOffset(5.0f, 30.0f);
+	glEnable(GL_LINE_SMOOTH); // line anti-aliasing
+	glDisable(GL_LIGHTING);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	// set color and linewidth_
+	glLineWidth(linewidth_);
+	glColor3f(linecolor_[0],linecolor_[1],linecolor_[2]);
+	// flush draw buffer to draw found lines
+	flushDrawBuffer(segments);
+}
+
+/**
+ * Finds the contour edges on a range of faces for a given model and camera position and buffers them
+ *
+ * @param Model* : the model
+ * @param camera_position: the camera position, given in 3d-coordinates
+ * @param begin: the first face
+ * @param end: one past the last face
+ * @param segments: the buffer to store the contour edges in
+ */
+void EdgeContourDrawer::find_edges(Model* m, trimesh::vec camera_position, unsigned int begin, unsigned int end, SegmentBuffer& segments)
 {
 	// some aliases to write readable code
 	const std::vector<trimesh::TriMesh::Face> &faces = m->mesh_->faces;
 	const std::vector<trimesh::point> &vertices = m->mesh_->vertices;
-	const std::vector<trimesh::TriMesh::Face> &edge = m->mesh_->across_edge;
+	const CornerTable &corners = m->data_->corners_;
+	const ExtractionQuality &quality = m->quality_;
+	unsigned int crossings = 0;
 
-	// for every face
-	for(unsigned int i =0; i < faces.size(); i++){
+	// for every face (or every stride_ one)
+	for(unsigned int i = quality.first(begin); i < end; i += quality.stride_){
 		if(to_camera(m,i,camera_position)){
+			// the faces across the edges opposite to each corner
+			int across0 = corners.acrossFace(3*i);
+			int across1 = corners.acrossFace(3*i+1);
+			int across2 = corners.acrossFace(3*i+2);
 			// check for broken edge map (=holes in the mesh, faces without neighbour)
-			if (unlikely((edge[i][0] < 0) | (edge[i][1] < 0) | (edge[i][3]< 0))){
+			if (unlikely((across0 < 0) | (across1 < 0) | (across2 < 0))){
 				continue; // edge map broken -> skip this face
 			}
 			// if edge map is not broken, add edges which are facing away
-			if (!to_camera(m,edge[i][0],camera_position)){
-				drawbuffer_vertices_.push_back(vertices[faces[i][1]]);
-				drawbuffer_vertices_.push_back(vertices[faces[i][2]]);
+			size_t before = segments.vertices_.size();
+			if (!to_camera(m,across0,camera_position)){
+				segments.vertices_.push_back(vertices[faces[i][1]]);
+				segments.vertices_.push_back(vertices[faces[i][2]]);
 			}
-			if (!to_camera(m,edge[i][1],camera_position)){
-				drawbuffer_vertices_.push_back(vertices[faces[i][0]]);
-				drawbuffer_vertices_.push_back(vertices[faces[i][2]]);
+			if (!to_camera(m,across1,camera_position)){
+				segments.vertices_.push_back(vertices[faces[i][0]]);
+				segments.vertices_.push_back(vertices[faces[i][2]]);
 			}
-			if (!to_camera(m,edge[i][2],camera_position)){
-				drawbuffer_vertices_.push_back(vertices[faces[i][0]]);
-				drawbuffer_vertices_.push_back(vertices[faces[i][1]]);
+			if (!to_camera(m,across2,camera_position)){
+				segments.vertices_.push_back(vertices[faces[i][0]]);
+				segments.vertices_.push_back(vertices[faces[i][1]]);
 			}
+			crossings += segments.vertices_.size() != before;
 		}
 	}
+	segments.candidates_ += quality.candidates(begin, end);
+	segments.crossings_ += crossings;
 }
 
 EdgeContourDrawer::~EdgeContourDrawer(){
 	// nothing to do in destructor
 }
+
+/**
+ * Upper bound on the number of segment vertices per face: each of the three edges can be a contour edge
+ */
+unsigned int EdgeContourDrawer::segmentVerticesPerFace(){
+	return 6;
+}
+
+bool EdgeContourDrawer::silhouettes(){
+	return true;
+}
+
+const char* EdgeContourDrawer::name(){
+	return "edge contours";
+}
+
+/**
+ * Mesh properties this drawer needs: face normals and the corner table
+ */
+unsigned int EdgeContourDrawer::requirements(){
+	return MESH_FACENORMALS | MESH_CONNECTIVITY;
+}
@@ -14,11 +14,17 @@
 
 class EdgeContourDrawer: public LineDrawer{
 private:
-	void find_edges(Model* m, trimesh::vec camera_position);
+	void find_edges(Model* m, trimesh::vec camera_position, unsigned int begin, unsigned int end, SegmentBuffer& segments);
 public:
 	EdgeContourDrawer(trimesh::vec color, float linewidth);
 	virtual ~EdgeContourDrawer();
-	virtual void draw(Model* m, trimesh::vec camera_position);
+	virtual void extract(Model* m, trimesh::vec camera_position, SegmentBuffer& segments);
+	virtual void extractFaces(Model* m, trimesh::vec camera_position, unsigned int begin, unsigned int end, SegmentBuffer& segments);
+	virtual bool silhouettes();
+	virtual void submit(Model* m, const SegmentBuffer& segments);
+	virtual unsigned int segmentVerticesPerFace();
+	virtual unsigned int requirements();
+	virtual const char* name();
 };
 
 #endif /* EDGECONTOURDRAWER_H_ */
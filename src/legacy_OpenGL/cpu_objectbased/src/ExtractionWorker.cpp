@@ -0,0 +1,79 @@
+/*
+ * Implementation of an ExtractionWorker, a single persistent background thread that runs one extraction job at a time.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "ExtractionWorker.h"
+#include "Tracer.h"
+
+/**
+ * Constructor: start the worker thread, which will sleep until a job is launched
+ */
+ExtractionWorker::ExtractionWorker(): busy_(false), quit_(false){
+	thread_ = std::thread(&ExtractionWorker::run, this);
+}
+
+/**
+ * Destructor: finish the current job and stop the worker thread
+ */
+ExtractionWorker::~ExtractionWorker(){
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		cv_.wait(lock, [this]{ return !busy_; });
+		quit_ = true;
+	}
+	cv_.notify_all();
+	thread_.join();
+}
+
+/**
+ * Launch a job on the worker thread. If a previous job is still running, wait for it first.
+ *
+ * @param job: the job to run
+ */
+void ExtractionWorker::launch(const std::function<void()> &job){
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		cv_.wait(lock, [this]{ return !busy_; });
+		job_ = job;
+		busy_ = true;
+	}
+	cv_.notify_all();
+}
+
+/**
+ * Block until the last launched job has finished.
+ */
+void ExtractionWorker::wait(){
+	std::unique_lock<std::mutex> lock(mutex_);
+	cv_.wait(lock, [this]{ return !busy_; });
+}
+
+/**
+ * Check whether the last launched job has finished, without blocking.
+ */
+bool ExtractionWorker::finished(){
+	std::lock_guard<std::mutex> lock(mutex_);
+	return !busy_;
+}
+
+/**
+ * Worker thread main loop
+ */
+void ExtractionWorker::run(){
+	Tracer::nameThread("extraction worker");
+	std::unique_lock<std::mutex> lock(mutex_);
+	while(true){
+		cv_.wait(lock, [this]{ return busy_ || quit_; });
+		if(quit_){
+			return;
+		}
+		// run the job without holding the lock, so the GL thread can poll us
+		lock.unlock();
+		job_();
+		lock.lock();
+		busy_ = false;
+		cv_.notify_all();
+	}
+}
@@ -0,0 +1,37 @@
+/*
+ * Definition of an ExtractionWorker, a single persistent background thread that runs one extraction job at a time.
+ * The GL thread launches a job (typically: extract the lines of every model for a given camera) and later either
+ * waits for it, or polls whether it has finished.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef EXTRACTIONWORKER_H_
+#define EXTRACTIONWORKER_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+class ExtractionWorker{
+private:
+	std::thread thread_;
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	std::function<void()> job_;
+	bool busy_;
+	bool quit_;
+	void run();
+public:
+	ExtractionWorker();
+	~ExtractionWorker();
+	// start a job on the worker thread (waits for the previous job first)
+	void launch(const std::function<void()> &job);
+	// block until the current job (if any) is done
+	void wait();
+	// has the last launched job finished?
+	bool finished();
+};
+
+#endif /* EXTRACTIONWORKER_H_ */
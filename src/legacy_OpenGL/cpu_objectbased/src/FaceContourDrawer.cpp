@@ -20,42 +20,91 @@ FaceContourDrawer::FaceContourDrawer(trimesh::vec color,float linewidth): LineDr
 }
 
 /**
- * Draws the face contours for a given model and camera position
+ * Computes the per-vertex data the face contours need: n dot v
  *
  * @param Model* : the model
- * @param camera_position: the current camera position, given in 3d-coordinates
+ * @param camera_position: the camera position, given in 3d-coordinates
  */
-void FaceContourDrawer::draw(Model* m, trimesh::vec camera_position){
-	if(isVisible()){
-		// configure OpenGL to draw nice lines
-		glPolygonOffset(5.0f, 30.0f);
-		glEnable(GL_LINE_SMOOTH);
-		glDisable(GL_LIGHTING);
-		glEnable(GL_POLYGON_OFFSET_FILL);
-		// set color and linewidth_
-		glLineWidth(linewidth_);
-		glColor3f(linecolor_[0],linecolor_[1],linecolor_[2]);
-		// we need ndotv_ information
-		m->needNdotV(camera_position);
-		// find the contour lines on the faces
-		find_facelines(m,camera_position);
-		// flush the drawbuffer to draw found lines
-		flushDrawBuffer();
-	}
+void FaceContourDrawer::prepare(Model* m, trimesh::vec camera_position){
+	m->needNdotV(camera_position);
+}
+
+/**
+ * Computes n dot v for a range of vertices
+ *
+ * @param Model* : the model
+ * @param camera_position: the camera position, given in 3d-coordinates
+ * @param begin: the first vertex
+ * @param end: one past the last vertex
+ */
+void FaceContourDrawer::prepareVertices(Model* m, trimesh::vec camera_position, unsigned int begin, unsigned int end){
+	m->computeNdotV(camera_position, begin, end);
+}
+
+/**
+ * Extracts the face contours for a given model and camera position
+ *
+ * @param Model* : the model
+ * @param camera_position: the camera position, given in 3d-coordinates
+ * @param segments: the buffer to store the contour segments in
+ */
+void FaceContourDrawer::extract(Model* m, trimesh::vec camera_position, SegmentBuffer& segments){
+	segments.clear();
+	// we need ndotv_ information
+	m->needNdotV(camera_position);
+	// find the contour lines on the faces
+	find_facelines(m,camera_position,0,m->data_->line_faces_,segments);
+}
+
+/**
+ * Extracts the face contours on a range of faces, adding them to the buffer
+ *
+ * @param Model* : the model
+ * @param camera_position: the camera position, given in 3d-coordinates
+ * @param begin: the first face
+ * @param end: one past the last face
+ * @param segments: the buffer to add the contour segments to
+ */
+void FaceContourDrawer::extractFaces(Model* m, trimesh::vec camera_position, unsigned int begin, unsigned int end, SegmentBuffer& segments){
+	find_facelines(m,camera_position,begin,end,segments);
 }
 
 /**
- * Finds the contour lines on the faces of the model and buffer them
+ * Draws previously extracted face contours
+ *
+ * @param Model* : the model
+ * @param segments: the extracted contour segments
+ */
+void FaceContourDrawer::submit(Model* m, const SegmentBuffer& segments){
+	// configure OpenGL to draw nice lines
+	glPolygonOffset(5.0f, 30.0f);
+	glEnable(GL_LINE_SMOOTH);
+	glDisable(GL_LIGHTING);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	// set color and linewidth_
+	glLineWidth(linewidth_);
+	glColor3f(linecolor_[0],linecolor_[1],linecolor_[2]);
+	// flush the drawbuffer to draw found lines
+	flushDrawBuffer(segments);
+}
+
+/**
+ * Finds the contour lines on a range of faces of the model and buffer them
  *
  * @param: Model
+ * @param begin: the first face
+ * @param end: one past the last face
+ * @param segments: the buffer to store the contour segments in
  */
-void FaceContourDrawer::find_facelines(Model* m, trimesh::vec camera_position)
+void FaceContourDrawer::find_facelines(Model* m, trimesh::vec camera_position, unsigned int begin, unsigned int end, SegmentBuffer& segments)
 {
 	// aliases for easy coding
-	const std::vector<float> &ndotv = m->ndotv_;
+	const FrameVector<float> &ndotv = m->ndotv_;
 	const std::vector<trimesh::TriMesh::Face> &faces = m->mesh_->faces;
-	// for every face
-	for(unsigned int i =0; i < m->mesh_->faces.size(); i++){
+	const ExtractionQuality &quality = m->quality_;
+	unsigned int crossings = 0;
+	// for every face (or every stride_ one)
+	for(unsigned int i = quality.first(begin); i < end; i += quality.stride_){
 			// vector point aliases
 			const int &v0 = faces[i][0];
 			const int &v1 = faces[i][1];
@@ -63,21 +112,24 @@ void FaceContourDrawer::find_facelines(Model* m, trimesh::vec camera_position)
 			// at least one corner should have different sign of ndotv_
 			if(unlikely((ndotv[v0] > 0.0f || ndotv[v1] >0.0f || ndotv[v2] >0.0f) &&
 					(ndotv[v0] <= 0.0f || ndotv[v1] <=0.0f || ndotv[v2] <=0.0f))){
+					crossings++;
 					// which corner has the different sign?
 					if((ndotv[v0] > 0.0f && ndotv[v1] <= 0.0f && ndotv[v2] <= 0.0f)||
 						(ndotv[v0] < 0.0f && ndotv[v1] >= 0.0f && ndotv[v2] >= 0.0f)){
-						construct_faceline(m,v0,v1,v2);
+						construct_faceline(m,v0,v1,v2,segments);
 					}
 					else if ((ndotv[v1] > 0.0f && ndotv[v0] <= 0.0f && ndotv[v2] <= 0.0f)||
 							(ndotv[v1] < 0.0f && ndotv[v0] >= 0.0f && ndotv[v2] >= 0.0f)){
-						construct_faceline(m,v1,v0,v2);
+						construct_faceline(m,v1,v0,v2,segments);
 					}
 					else if ((ndotv[v2] > 0.0f && ndotv[v0] <= 0.0f && ndotv[v1] <= 0.0f)||
 							(ndotv[v2] < 0.0f && ndotv[v0] >= 0.0f && ndotv[v1] >= 0.0f)){
-						construct_faceline(m,v2,v0,v1);
+						construct_faceline(m,v2,v0,v1,segments);
 					}
 			}
 	}
+	segments.candidates_ += quality.candidates(begin, end);
+	segments.crossings_ += crossings;
 }
 /**
  * Constructs a face contour line on the face defined by 3 given vertex indices.
@@ -85,8 +137,9 @@ void FaceContourDrawer::find_facelines(Model* m, trimesh::vec camera_position)
  *
  * @param Model: the model to which the vertices belong
  * @param v0,v1,v2: the vertex indices
+ * @param segments: the buffer to store the contour segment in
  */
-void FaceContourDrawer::construct_faceline(Model* m,int v0, int v1, int v2)
+void FaceContourDrawer::construct_faceline(Model* m,int v0, int v1, int v2, SegmentBuffer& segments)
 {
 	float w10 = m->ndotv_[v0]/(m->ndotv_[v0]-m->ndotv_[v1]); // linear interpolation
 	float w01 = 1.0 - w10;
@@ -94,7 +147,28 @@ void FaceContourDrawer::construct_faceline(Model* m,int v0, int v1, int v2)
 	float w02 = 1.0 - w20;
 	trimesh::vec p1 = w01 * m->mesh_->vertices[v0] + w10 * m->mesh_->vertices[v1];
 	trimesh::vec p2 = w02 * m->mesh_->vertices[v0] + w20 * m->mesh_->vertices[v2];
-	drawbuffer_vertices_.push_back(p1);
-	drawbuffer_vertices_.push_back(p2);
+	segments.vertices_.push_back(p1);
+	segments.vertices_.push_back(p2);
+}
+
+/**
+ * Upper bound on the number of segment vertices per face: one contour segment per face
+ */
+unsigned int FaceContourDrawer::segmentVerticesPerFace(){
+	return 2;
 }
 
+bool FaceContourDrawer::silhouettes(){
+	return true;
+}
+
+const char* FaceContourDrawer::name(){
+	return "face contours";
+}
+
+/**
+ * Mesh properties this drawer needs: vertex normals for n dot v
+ */
+unsigned int FaceContourDrawer::requirements(){
+	return MESH_NORMALS;
+}
@@ -12,11 +12,19 @@
 
 class FaceContourDrawer: public LineDrawer{
 private:
-	void construct_faceline(Model* m,int v0, int v1, int v2);
-	void find_facelines(Model* m, trimesh::vec camera_position);
+	void construct_faceline(Model* m,int v0, int v1, int v2, SegmentBuffer& segments);
+	void find_facelines(Model* m, trimesh::vec camera_position, unsigned int begin, unsigned int end, SegmentBuffer& segments);
 public:
 	FaceContourDrawer(trimesh::vec color,float linewidth);
-	virtual void draw(Model* m, trimesh::vec camera_position);
+	virtual void prepare(Model* m, trimesh::vec camera_position);
+	virtual void prepareVertices(Model* m, trimesh::vec camera_position, unsigned int begin, unsigned int end);
+	virtual void extract(Model* m, trimesh::vec camera_position, SegmentBuffer& segments);
+	virtual void extractFaces(Model* m, trimesh::vec camera_position, unsigned int begin, unsigned int end, SegmentBuffer& segments);
+	virtual bool silhouettes();
+	virtual void submit(Model* m, const SegmentBuffer& segments);
+	virtual unsigned int segmentVerticesPerFace();
+	virtual unsigned int requirements();
+	virtual const char* name();
 };
 
 #endif /* FACECONTOURDRAWER_H_ */
@@ -0,0 +1,105 @@
+/*
+ * Implementation of a FrameScheduler, which runs the line extraction of every model in the scene as one task graph on a
+ * ThreadPool.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "FrameScheduler.h"
+
+void FrameScheduler::VertexTask::run(){
+	model_->beginExtract(*camera_);
+	model_->extractVertexData();
+}
+
+void FrameScheduler::DrawerTask::run(){
+	model_->extractDrawer(drawer_);
+}
+
+FrameScheduler::ModelTasks::~ModelTasks(){
+	for(unsigned int i = 0; i < drawers_.size(); i++){
+		delete drawers_[i];
+	}
+}
+
+/**
+ * Constructor: a scheduler without models
+ *
+ * @param pool: the thread pool to run the extraction on
+ */
+FrameScheduler::FrameScheduler(ThreadPool* pool): pool_(pool){
+}
+
+FrameScheduler::~FrameScheduler(){
+	clear();
+}
+
+void FrameScheduler::clear(){
+	for(unsigned int i = 0; i < models_.size(); i++){
+		delete models_[i];
+	}
+	models_.clear();
+}
+
+/**
+ * Build the task graph for a list of models: per model, a vertex data task followed by a task for every drawer.
+ *
+ * @param models: the models, in the order they'll get waited for
+ */
+void FrameScheduler::build(const std::vector<Model*> &models){
+	clear();
+	for(unsigned int i = 0; i < models.size(); i++){
+		ModelTasks* tasks = new ModelTasks();
+		tasks->vertex_.model_ = models[i];
+		tasks->vertex_.camera_ = &camera_;
+		tasks->vertex_.group_ = &tasks->unfinished_;
+		for(unsigned int j = 0; j < models[i]->drawers_.size(); j++){
+			DrawerTask* d = new DrawerTask();
+			d->model_ = models[i];
+			d->drawer_ = j;
+			d->group_ = &tasks->unfinished_;
+			tasks->vertex_.precede(d);
+			tasks->drawers_.push_back(d);
+		}
+		tasks->unfinished_ = 0;
+		models_.push_back(tasks);
+	}
+}
+
+/**
+ * Launch the extraction of every model, for a given camera position. The previous launch should be done.
+ *
+ * @param camera_position: the position of the camera to extract for, in world coordinates
+ */
+void FrameScheduler::launch(trimesh::vec camera_position){
+	camera_ = camera_position;
+	for(unsigned int i = 0; i < models_.size(); i++){
+		ModelTasks* tasks = models_[i];
+		tasks->unfinished_ = 1 + tasks->drawers_.size();
+		for(unsigned int j = 0; j < tasks->drawers_.size(); j++){
+			tasks->drawers_[j]->reset();
+		}
+	}
+	// launch all roots only after resetting every task: they start running right away
+	for(unsigned int i = 0; i < models_.size(); i++){
+		pool_->launch(&models_[i]->vertex_);
+	}
+}
+
+/**
+ * Help running extraction tasks until a given model's lines are extracted
+ *
+ * @param model: the index of the model
+ */
+void FrameScheduler::wait(unsigned int model){
+	pool_->wait(models_[model]->unfinished_);
+}
+
+/**
+ * Help running extraction tasks until every model's lines are extracted
+ */
+void FrameScheduler::wait(){
+	for(unsigned int i = 0; i < models_.size(); i++){
+		wait(i);
+	}
+}
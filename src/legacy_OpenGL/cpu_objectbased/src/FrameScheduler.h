@@ -0,0 +1,64 @@
+/*
+ * Definition of a FrameScheduler, which runs the line extraction of every model in the scene as one task graph on a
+ * ThreadPool.
+ *
+ * For every model, the per-vertex data its drawers need gets computed in one task, after which every drawer's
+ * extraction is a task of its own. All models' tasks run concurrently, so a scene with many small and a few huge
+ * models keeps every core busy. The GL thread waits for the models one by one, in order, and can submit a model's
+ * lines as soon as its tasks are done, while the others are still being extracted.
+ *
+ * The graph is built once for a list of models (and their drawer stacks), then relaunched every frame.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef FRAMESCHEDULER_H_
+#define FRAMESCHEDULER_H_
+
+#include "ThreadPool.h"
+#include "Model.h"
+#include <vector>
+
+class FrameScheduler{
+private:
+	// compute a model's per-vertex view-dependent data
+	class VertexTask: public Task{
+	public:
+		Model* model_;
+		trimesh::vec* camera_;
+		virtual void run();
+	};
+	// extract the lines of one drawer of a model
+	class DrawerTask: public Task{
+	public:
+		Model* model_;
+		unsigned int drawer_;
+		virtual void run();
+	};
+	// all tasks of a model, and how many of them haven't finished yet
+	struct ModelTasks{
+		VertexTask vertex_;
+		std::vector<DrawerTask*> drawers_;
+		std::atomic<int> unfinished_;
+		~ModelTasks();
+	};
+
+	ThreadPool* pool_;
+	std::vector<ModelTasks*> models_;
+	trimesh::vec camera_;
+	void clear();
+
+public:
+	FrameScheduler(ThreadPool* pool);
+	~FrameScheduler();
+	// build the task graph for a list of models (rebuild when the models or their drawer stacks change)
+	void build(const std::vector<Model*> &models);
+	// start extracting the lines of every model, for a camera position in world coordinates
+	void launch(trimesh::vec camera_position);
+	// help extracting until the given model is done
+	void wait(unsigned int model);
+	// help extracting until every model is done
+	void wait();
+};
+
+#endif /* FRAMESCHEDULER_H_ */
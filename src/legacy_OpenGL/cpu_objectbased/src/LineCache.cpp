@@ -0,0 +1,177 @@
+/*
+ * Implementation of a LineCache, which keeps the lines of every model for the views the user looked at.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "LineCache.h"
+#include <cmath>
+
+/**
+ * Constructor: an empty cache
+ *
+ * @param budget: the memory the cached lines can take, in bytes
+ */
+LineCache::LineCache(size_t budget): budget_(budget), bytes_(0), cell_(LINE_CACHE_CELL), clock_(0), hits_(0), misses_(0){
+}
+
+LineCache::~LineCache(){
+	clear();
+}
+
+/**
+ * Size the cells camera positions get quantized to: LINE_CACHE_CELL times the scene's radius. Changing the size drops
+ * every view.
+ *
+ * @param radius: the radius of the scene's bounding sphere
+ */
+void LineCache::setScale(float radius){
+	float cell = LINE_CACHE_CELL * (radius > 0.0f ? radius : 1.0f);
+	if(cell != cell_){
+		clear();
+		cell_ = cell;
+	}
+}
+
+/**
+ * The key of a view
+ *
+ * @param camera_position: the camera position, in world coordinates
+ * @param settings: a hash of the settings the lines depend on
+ */
+LineCacheKey LineCache::key(trimesh::vec camera_position, unsigned long long settings) const{
+	LineCacheKey k;
+	for(int i = 0; i < 3; i++){
+		k.cell_[i] = int(floorf(camera_position[i] / cell_));
+	}
+	k.settings_ = settings;
+	return k;
+}
+
+LineCache::Entry* LineCache::find(const LineCacheKey &key){
+	for(unsigned int i = 0; i < entries_.size(); i++){
+		if(entries_[i]->key_ == key){
+			return entries_[i];
+		}
+	}
+	return 0;
+}
+
+/**
+ * Load the lines of a view into the models (copied into their back segments, which become the front ones), if it's
+ * cached. Doesn't allocate: the back segments have room for any set of lines (see Model::reserveSegments).
+ *
+ * @param key: the view
+ * @param models: the models (the ones the lines got stored for)
+ * @return true if the view was cached: the models' lines are ready
+ */
+bool LineCache::load(const LineCacheKey &key, std::vector<Model*> &models){
+	Entry* entry = find(key);
+	if(!entry || entry->segments_.size() != models.size()){
+		misses_++;
+		return false;
+	}
+	for(unsigned int i = 0; i < models.size(); i++){
+		models[i]->loadSegments(entry->segments_[i], entry->levels_[i]);
+	}
+	entry->used_ = ++clock_;
+	hits_++;
+	return true;
+}
+
+/**
+ * Store the models' front segments for a view (replacing what was stored for it), then drop the least recently used
+ * views until the cache is within its budget again. A view larger than the whole budget doesn't get cached.
+ *
+ * @param key: the view the models' front segments got extracted for
+ * @param models: the models
+ * @return true if storing allocated memory
+ */
+bool LineCache::store(const LineCacheKey &key, const std::vector<Model*> &models){
+	Entry* entry = find(key);
+	if(!entry){
+		entry = new Entry();
+		entry->key_ = key;
+		entry->bytes_ = 0;
+		entries_.push_back(entry);
+	}
+	bytes_ -= entry->bytes_;
+	entry->segments_.resize(models.size());
+	entry->levels_.resize(models.size());
+	size_t bytes = 0;
+	bool allocated = false;
+	for(unsigned int i = 0; i < models.size(); i++){
+		SegmentSet &set = entry->segments_[i];
+		size_t capacity = 0;
+		for(unsigned int j = 0; j < set.size(); j++){
+			capacity += set[j].vertices_.capacity() + set[j].colors_.capacity();
+		}
+		models[i]->copySegments(set, entry->levels_[i]);
+		size_t grown = 0;
+		for(unsigned int j = 0; j < set.size(); j++){
+			grown += set[j].vertices_.capacity() + set[j].colors_.capacity();
+			bytes += set[j].vertices_.capacity() * sizeof(trimesh::vec) + set[j].colors_.capacity() * sizeof(trimesh::vec4);
+		}
+		allocated = allocated || grown != capacity;
+	}
+	entry->bytes_ = bytes;
+	entry->used_ = ++clock_;
+	bytes_ += bytes;
+	// drop the least recently used views (the one just stored goes last)
+	while(bytes_ > budget_ && !entries_.empty()){
+		unsigned int oldest = 0;
+		for(unsigned int i = 1; i < entries_.size(); i++){
+			if(entries_[i]->used_ < entries_[oldest]->used_){
+				oldest = i;
+			}
+		}
+		drop(oldest);
+	}
+	return allocated;
+}
+
+/**
+ * Drop a view, and free its memory
+ */
+void LineCache::drop(unsigned int entry){
+	bytes_ -= entries_[entry]->bytes_;
+	delete entries_[entry];
+	entries_.erase(entries_.begin() + entry);
+}
+
+void LineCache::clear(){
+	while(!entries_.empty()){
+		drop(entries_.size() - 1);
+	}
+}
+
+int LineCache::entries() const{
+	return entries_.size();
+}
+
+size_t LineCache::bytes() const{
+	return bytes_;
+}
+
+float LineCache::hitRate() const{
+	return hits_ + misses_ ? float(hits_) / (hits_ + misses_) : 0.0f;
+}
+
+/**
+ * Hash settings into a settings value (FNV-1a): hash every setting the lines depend on, one after the other
+ *
+ * @param hash: the value so far (0 to start)
+ * @param data: the setting
+ * @param size: its size in bytes
+ * @return the new value
+ */
+unsigned long long LineCache::settings(unsigned long long hash, const void* data, size_t size){
+	if(hash == 0){
+		hash = 14695981039346656037ULL;
+	}
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for(size_t i = 0; i < size; i++){
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+	}
+	return hash;
+}
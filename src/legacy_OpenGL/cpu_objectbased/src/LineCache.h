@@ -0,0 +1,82 @@
+/*
+ * Definition of a LineCache, which keeps the lines of every model for the views the user looked at, so returning to
+ * one of them draws right away, without computing any per-vertex data or extracting anything.
+ *
+ * Views are keyed by the camera position, quantized to cells of a small fraction of the scene's size, plus a hash of
+ * everything else the lines depend on (which drawers are visible, their parameters, the viewport, ...), which the
+ * viewer computes (see settings). An entry holds a copy of the front segments of every model in the scene, and the
+ * level of detail they came from. Loading an entry copies it into the models' back segments and swaps them in.
+ *
+ * The cache holds at most a budget of memory: when storing a view takes it over budget, the least recently used views
+ * get dropped (with their memory). Storing allocates, loading doesn't.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef LINECACHE_H_
+#define LINECACHE_H_
+
+#include "Model.h"
+#include "SegmentBuffer.h"
+#include <TriMesh.h>
+#include <vector>
+
+// default memory budget, in MB
+#define LINE_CACHE_MB 64
+// size of the cells camera positions get quantized to, relative to the scene's bounding sphere radius
+#define LINE_CACHE_CELL 1e-4f
+
+// a view: the cell the camera is in, and a hash of the settings the lines depend on
+struct LineCacheKey{
+	int cell_[3];
+	unsigned long long settings_;
+	bool operator==(const LineCacheKey &other) const{
+		return cell_[0] == other.cell_[0] && cell_[1] == other.cell_[1] && cell_[2] == other.cell_[2] && settings_ == other.settings_;
+	}
+};
+
+class LineCache{
+private:
+	struct Entry{
+		LineCacheKey key_;
+		std::vector<SegmentSet> segments_; // the front segments of every model
+		std::vector<int> levels_; // and the level of detail they came from
+		unsigned long long used_; // when it got used last (see clock_)
+		size_t bytes_;
+	};
+
+	std::vector<Entry*> entries_;
+	size_t budget_; // bytes
+	size_t bytes_;
+	float cell_;
+	unsigned long long clock_; // counts loads and stores
+	int hits_;
+	int misses_;
+
+	Entry* find(const LineCacheKey &key);
+	void drop(unsigned int entry);
+
+public:
+	// constructor: an empty cache holding at most a budget of bytes
+	LineCache(size_t budget);
+	~LineCache();
+	// size the cells of the camera positions, for a scene with a bounding sphere of this radius
+	void setScale(float radius);
+	// the key of a view: a camera position (in world coordinates) and settings (see settings)
+	LineCacheKey key(trimesh::vec camera_position, unsigned long long settings) const;
+	// make the lines of a cached view the models' front segments, returns false if the view isn't cached
+	bool load(const LineCacheKey &key, std::vector<Model*> &models);
+	// cache the models' front segments for a view (returns whether that allocated memory)
+	bool store(const LineCacheKey &key, const std::vector<Model*> &models);
+	// drop every view (when the models change)
+	void clear();
+	// number of views, memory used (in bytes), and the fraction of loads which found their view
+	int entries() const;
+	size_t bytes() const;
+	float hitRate() const;
+
+	// hash some settings the lines depend on into a settings value (start from 0)
+	static unsigned long long settings(unsigned long long hash, const void* data, size_t size);
+};
+
+#endif /* LINECACHE_H_ */
@@ -20,26 +20,26 @@ LineDrawer::LineDrawer(trimesh::vec color, float linewidth): Drawer(true), linec
 }
 
 /**
- * Flush the drawbuffers to the OpenGL Draw buffer to display the computed lines, then clear them.
+ * Flush a segment buffer to the OpenGL Draw buffer to display the computed lines.
+ * The segment buffer is left untouched: it belongs to the model and gets cleared by the next extraction.
+ *
+ * @param segments: the extracted segments
  */
-void LineDrawer::flushDrawBuffer()
+void LineDrawer::flushDrawBuffer(const SegmentBuffer& segments)
 {
 	// if we've got some lines to draw ...
-	if(!drawbuffer_vertices_.empty()){
+	if(!segments.empty()){
 		glEnableClientState(GL_VERTEX_ARRAY);
-		glVertexPointer(3, GL_FLOAT, sizeof(drawbuffer_vertices_[0]),&drawbuffer_vertices_[0][0]);
+		glVertexPointer(3, GL_FLOAT, sizeof(segments.vertices_[0]),&segments.vertices_[0][0]);
 		// if per-line colors were defined
-		if(!drawbuffer_colors_.empty()){
+		if(!segments.colors_.empty()){
 			glEnableClientState(GL_COLOR_ARRAY);
-			glColorPointer(4, GL_FLOAT, sizeof(drawbuffer_colors_[0]),&drawbuffer_colors_[0][0]);
+			glColorPointer(4, GL_FLOAT, sizeof(segments.colors_[0]),&segments.colors_[0][0]);
 		}
 		// push lines to GPU
-		glDrawArrays(GL_LINES, 0, drawbuffer_vertices_.size());
+		glDrawArrays(GL_LINES, 0, segments.vertices_.size());
 		glDisableClientState(GL_VERTEX_ARRAY);
 		glDisableClientState(GL_COLOR_ARRAY);
-		// clear the buffers
-		drawbuffer_vertices_.clear();
-		drawbuffer_colors_.clear();
 	}
 }
 
@@ -15,12 +15,9 @@ protected:
 	// line properties
 	trimesh::vec linecolor_;
 	float linewidth_;
-	// buffers
-	std::vector<trimesh::vec> drawbuffer_vertices_;
-	std::vector<trimesh::vec4> drawbuffer_colors_;
 
 	LineDrawer(trimesh::vec color, float linewidth);
-	void flushDrawBuffer();
+	void flushDrawBuffer(const SegmentBuffer& segments);
 
 public:
 	trimesh::vec getLineColor();
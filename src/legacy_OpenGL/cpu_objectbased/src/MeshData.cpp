@@ -0,0 +1,716 @@
+/*
+ * Implementation of the MeshData class, the shared view-independent data of a mesh.
+ *
+ * Author: Jeroen Baert
+ */
+
+#include "MeshData.h"
+#include "mesh_info.h"
+#include "vertex_info.h"
+#include "mesh_cache.h"
+#include "curvature.h"
+#include "mesh_reorder.h"
+#include "simplify.h"
+#include "numa.h"
+#include "MeshParser.h"
+#include "Tracer.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+/**
+ * Constructor: read a mesh (or its cached preprocessed version). Everything else is built on demand, when a drawer
+ * requiring it gets pushed onto a Model using this data.
+ * @param filename : the filesystem location of the file containing mesh_ data
+ * @param source_order : keep the vertices and faces in the order of the file: a preprocessed version which got
+ * reordered (see reorder) gets skipped, and left for the runs which can use it
+ */
+MeshData::MeshData(const char* filename, bool source_order): available_(0), filename_(filename), cache_dirty_(false), compact_(false), edited_(false),
+		preprocessing_time_(0.0f), vbo_normals_(0), feature_size_(0.0f), line_faces_(0)
+{
+	// if there's an up-to-date preprocessed version of this mesh, use it
+	bool found = stat_mesh_file(filename, source_);
+	bool reordered = source_order && found && (cached_mesh_properties(filename) & MESH_REORDERED);
+	if(reordered){
+		std::cout << "Mesh cache " << mesh_cache_filename(filename) << " is reordered, reading the mesh in its own order" << std::endl;
+	}
+	trimesh::TriMesh* mesh = new trimesh::TriMesh();
+	if(found && !reordered && read_mesh_cache(filename, source_, mesh, facenormals_, corners_, feature_size_, available_)){
+		std::cout << "Loaded preprocessed mesh from " << mesh_cache_filename(filename) << std::endl;
+	}
+	else{
+		delete mesh;
+		// read mesh_ from file
+		TraceScope trace("read mesh");
+		mesh = MeshParser::read(filename);
+		mesh->need_bsphere();
+		cache_dirty_ = found && !reordered;
+	}
+	mutable_mesh_ = mesh;
+	mesh_ = mesh;
+	line_faces_ = mesh->faces.size();
+	setupVBOs();
+}
+
+/**
+ * Constructor for a level of detail: data for a (simplified) mesh which doesn't come from a file, so it has no cache.
+ * @param mesh : the mesh, we take ownership
+ */
+MeshData::MeshData(trimesh::TriMesh* mesh): mutable_mesh_(mesh), available_(0), cache_dirty_(false), compact_(false), edited_(false),
+		mesh_(mesh), preprocessing_time_(0.0f), vbo_normals_(0), feature_size_(0.0f), line_faces_(mesh->faces.size())
+{
+	mesh->need_bsphere();
+	setupVBOs();
+}
+
+/**
+ * Constructor for a mesh which already has some properties (normals, curvatures, ...), computed elsewhere: a chunk of
+ * an out-of-core mesh. Like a level of detail, it has no cache of its own.
+ * @param mesh : the mesh, we take ownership
+ * @param properties : a mask of the MeshProperty values the mesh already has
+ * @param feature_size : the feature size, if properties has MESH_FEATURE_SIZE
+ * @param owned_faces : the number of faces lines get extracted from: the chunk's own ones, which come first (the
+ * others are its halo, only there for the properties of the vertices along its border)
+ */
+MeshData::MeshData(trimesh::TriMesh* mesh, unsigned int properties, float feature_size, unsigned int owned_faces): mutable_mesh_(mesh),
+		available_(properties), cache_dirty_(false), compact_(false), edited_(false), mesh_(mesh), preprocessing_time_(0.0f), vbo_normals_(0),
+		feature_size_(feature_size), line_faces_(std::min(owned_faces, (unsigned int) mesh->faces.size()))
+{
+	mesh->need_bsphere();
+	setupVBOs();
+}
+
+MeshData::~MeshData(){
+	for(unsigned int i = 0; i < levels_.size(); i++){
+		delete levels_[i];
+	}
+	glDeleteBuffersARB(1, &vbo_positions_);
+	if(vbo_normals_){
+		glDeleteBuffersARB(1, &vbo_normals_);
+	}
+	delete mutable_mesh_;
+}
+
+/**
+ * Build the given mesh properties, resolving their dependencies and building them in dependency order.
+ * Reports the time spent in every stage.
+ *
+ * @param properties: a mask of MeshProperty values
+ */
+void MeshData::require(unsigned int properties){
+	// resolve dependencies
+	if(properties & (MESH_DCURV | MESH_FEATURE_SIZE)){
+		properties |= MESH_CURVATURES;
+	}
+	if(properties & MESH_CURVATURES){
+		properties |= MESH_NORMALS;
+	}
+	for(unsigned int i = 0; i < levels_.size(); i++){
+		levels_[i]->require(properties);
+	}
+	unsigned int missing = properties & ~available_;
+	if(!missing){
+		return;
+	}
+	// building on top of compact attributes needs the float versions
+	bool was_compact = compact_;
+	if(was_compact){
+		expand();
+	}
+	trimesh::TriMesh* mesh = mutable_mesh_;
+	trimesh::timestamp start;
+	// only used when we need both curvatures and their derivatives
+	FaceColoring coloring;
+	if(missing & MESH_NORMALS){
+		std::cout << "Computing vertex normals... ";
+		TraceScope trace("vertex normals");
+		start = trimesh::now();
+		mesh->need_normals();
+		setupNormalVBO();
+		reportStage(start);
+	}
+	if(missing & MESH_TSTRIPS){
+		std::cout << "Computing triangle strips... ";
+		TraceScope trace("triangle strips");
+		start = trimesh::now();
+		mesh->need_tstrips();
+		// TriMesh2 builds its own adjacency for this, which we don't need afterwards
+		mesh->clear_across_edge();
+		mesh->clear_adjacentfaces();
+		reportStage(start);
+	}
+	if(missing & MESH_CONNECTIVITY){
+		std::cout << "Building corner table... ";
+		TraceScope trace("corner table");
+		start = trimesh::now();
+		corners_.build(mesh_);
+		reportStage(start);
+	}
+	if(missing & MESH_FACENORMALS){
+		std::cout << "Computing face normals... ";
+		TraceScope trace("face normals");
+		start = trimesh::now();
+		computeFaceNormals(mesh_,facenormals_);
+		reportStage(start);
+	}
+	if(missing & (MESH_CURVATURES | MESH_DCURV)){
+		std::cout << "Coloring faces... ";
+		TraceScope trace("face coloring");
+		start = trimesh::now();
+		color_faces(mesh, coloring);
+		reportStage(start);
+	}
+	if(missing & MESH_CURVATURES){
+		std::cout << "Computing curvatures... ";
+		TraceScope trace("curvatures");
+		start = trimesh::now();
+		compute_curvatures(mesh, coloring);
+		reportStage(start);
+	}
+	if(missing & MESH_DCURV){
+		std::cout << "Computing curvature derivatives... ";
+		TraceScope trace("curvature derivatives");
+		start = trimesh::now();
+		// point areas are not cached, so make sure they're there when curvatures came from the cache
+		if(mesh->pointareas.size() != mesh->vertices.size()){
+			compute_pointareas(mesh, coloring);
+		}
+		compute_dcurv(mesh, coloring);
+		reportStage(start);
+	}
+	if(missing & MESH_FEATURE_SIZE){
+		std::cout << "Computing feature size... ";
+		TraceScope trace("feature size");
+		start = trimesh::now();
+		feature_size_ = computeFeatureSize(mesh_);
+		reportStage(start);
+	}
+	available_ |= missing;
+	cache_dirty_ = true;
+	if(was_compact){
+		compact();
+	}
+}
+
+/**
+ * Reorder the mesh vertices along a Morton curve and its faces by lowest vertex, so extraction gathers per-vertex data
+ * from nearby memory. Everything which was already built gets remapped, and the VBOs get uploaded again.
+ */
+void MeshData::reorder(){
+	for(unsigned int i = 0; i < levels_.size(); i++){
+		levels_[i]->reorder();
+	}
+	if(available_ & MESH_REORDERED){
+		return;
+	}
+	bool was_compact = compact_;
+	if(was_compact){
+		expand();
+	}
+	std::cout << "Reordering vertices and faces... ";
+	TraceScope trace("reorder");
+	trimesh::timestamp start = trimesh::now();
+	reorder_mesh(mutable_mesh_, facenormals_);
+	if(available_ & MESH_CONNECTIVITY){
+		corners_.build(mesh_);
+	}
+	reportStage(start);
+	if(!clusters_.empty()){
+		buildClusters();
+	}
+	glDeleteBuffersARB(1, &vbo_positions_);
+	if(available_ & MESH_NORMALS){
+		glDeleteBuffersARB(1, &vbo_normals_);
+	}
+	setupVBOs();
+	available_ |= MESH_REORDERED;
+	cache_dirty_ = true;
+	if(was_compact){
+		compact();
+	}
+}
+
+/**
+ * Replace the float normals, principal directions, curvatures and curvature derivatives by their compact (quantized)
+ * representation (see quantize.h), and report the error this introduces.
+ */
+void MeshData::compact(){
+	for(unsigned int i = 0; i < levels_.size(); i++){
+		levels_[i]->compact();
+	}
+	if(compact_){
+		return;
+	}
+	trimesh::TriMesh* mesh = mutable_mesh_;
+	size_t before = mesh->normals.size() * sizeof(trimesh::vec) + mesh->pdir1.size() * sizeof(trimesh::vec)
+			+ mesh->pdir2.size() * sizeof(trimesh::vec) + mesh->curv1.size() * sizeof(float) + mesh->curv2.size() * sizeof(float)
+			+ mesh->dcurv.size() * sizeof(mesh->dcurv[0]) + mesh->pointareas.size() * sizeof(float)
+			+ mesh->cornerareas.size() * sizeof(trimesh::vec);
+	std::cout << "Compacting vertex attributes... ";
+	TraceScope trace("compact");
+	trimesh::timestamp start = trimesh::now();
+	quantize_attributes(mesh_, quantized_);
+	reportStage(start);
+	measureQuantizationError();
+	// release the float versions (point and corner areas are only needed to build curvatures)
+	std::vector<trimesh::vec>().swap(mesh->normals);
+	std::vector<trimesh::vec>().swap(mesh->pdir1);
+	std::vector<trimesh::vec>().swap(mesh->pdir2);
+	std::vector<float>().swap(mesh->curv1);
+	std::vector<float>().swap(mesh->curv2);
+	std::vector<trimesh::Vec<4,float> >().swap(mesh->dcurv);
+	std::vector<float>().swap(mesh->pointareas);
+	std::vector<trimesh::vec>().swap(mesh->cornerareas);
+	compact_ = true;
+	size_t after = quantized_.vertices_.size() * sizeof(QuantizedVertex);
+	std::cout << "Vertex attributes: " << before / 1024 << " KB -> " << after / 1024 << " KB" << std::endl;
+}
+
+/**
+ * Decode the compact vertex attributes back into the mesh's float arrays (keeping the quantization error).
+ */
+void MeshData::expand(){
+	std::cout << "Expanding compact vertex attributes... ";
+	TraceScope trace("expand");
+	trimesh::timestamp start = trimesh::now();
+	dequantize_attributes(quantized_, mutable_mesh_);
+	std::vector<QuantizedVertex>().swap(quantized_.vertices_);
+	compact_ = false;
+	reportStage(start);
+}
+
+/**
+ * Measure the error the compact representation introduces: in the attributes themselves, and in the view-dependent
+ * quantities the lines get extracted from, for a ring of viewpoints around the model. Vertices where one of those
+ * changes sign are where a line moves to another face.
+ */
+void MeshData::measureQuantizationError(){
+	const trimesh::TriMesh* mesh = mesh_;
+	int nv = mesh->vertices.size();
+	bool curvatures = (available_ & MESH_CURVATURES) != 0;
+	bool dcurv = (available_ & MESH_DCURV) != 0;
+	float normal_error = 0.0f, pdir_error = 0.0f, curv_error = 0.0f, dcurv_error = 0.0f;
+	for (int i = 0; i < nv; i++){
+		const QuantizedVertex &qv = quantized_.vertices_[i];
+		trimesh::vec normal = decode_octahedral(qv.normal_);
+		// (angles from atan2 rather than acos: acos is too imprecise near 1 to resolve these)
+		normal_error = std::max(normal_error, float(atan2(len(normal CROSS mesh->normals[i]), normal DOT mesh->normals[i])));
+		if(curvatures){
+			trimesh::vec pdir1 = decode_octahedral(qv.pdir1_);
+			trimesh::vec pdir2 = normal CROSS pdir1;
+			// the stored pdir2 may point the other way
+			pdir_error = std::max(pdir_error, float(atan2(len(pdir1 CROSS mesh->pdir1[i]), pdir1 DOT mesh->pdir1[i])));
+			pdir_error = std::max(pdir_error, float(atan2(len(pdir2 CROSS mesh->pdir2[i]), fabs(pdir2 DOT mesh->pdir2[i]))));
+			curv_error = std::max(curv_error, float(fabs(half_to_float(qv.curv_[0]) * quantized_.curv_scale_ - mesh->curv1[i])));
+			curv_error = std::max(curv_error, float(fabs(half_to_float(qv.curv_[1]) * quantized_.curv_scale_ - mesh->curv2[i])));
+		}
+		if(dcurv){
+			float flip = ((mesh->normals[i] CROSS mesh->pdir1[i]) DOT mesh->pdir2[i]) < 0.0f ? -1.0f : 1.0f;
+			for (int j = 0; j < 4; j++){
+				float sign = (j % 2) ? flip : 1.0f;
+				dcurv_error = std::max(dcurv_error, float(fabs(sign * half_to_float(qv.dcurv_[j]) * quantized_.dcurv_scale_ - mesh->dcurv[i][j])));
+			}
+		}
+	}
+	std::cout << "Quantization error: normals " << normal_error << " rad";
+	if(curvatures){
+		std::cout << ", principal directions " << pdir_error << " rad, curvatures " << curv_error << " (scale " << quantized_.curv_scale_ << ")";
+	}
+	if(dcurv){
+		std::cout << ", derivatives " << dcurv_error << " (scale " << quantized_.dcurv_scale_ << ")";
+	}
+	std::cout << std::endl;
+
+	// view-dependent error
+	const int views = 16;
+	FrameVector<float> ndotv(nv), kr(nv), num(nv), den(nv);
+	FrameVector<float> q_ndotv(nv), q_kr(nv), q_num(nv), q_den(nv);
+	float ndotv_error = 0.0f, kr_error = 0.0f, num_error = 0.0f;
+	size_t ndotv_flips = 0, kr_flips = 0, num_flips = 0;
+	for (int v = 0; v < views; v++){
+		float angle = 2.0f * 3.14159265f * v / views;
+		trimesh::vec camera = mesh->bsphere.center + 5.0f * mesh->bsphere.r * trimesh::vec(cos(angle), 0.3f, sin(angle));
+		compute_ndotv(mesh, camera, ndotv, 0, nv);
+		compute_ndotv(mesh, quantized_, camera, q_ndotv, 0, nv);
+		if(dcurv){
+			compute_CurvDerivatives(mesh, camera, kr, num, den, 0.0f, 0, nv);
+			compute_CurvDerivatives(mesh, quantized_, camera, q_kr, q_num, q_den, 0.0f, 0, nv);
+		}
+		for (int i = 0; i < nv; i++){
+			ndotv_error = std::max(ndotv_error, float(fabs(ndotv[i] - q_ndotv[i])));
+			ndotv_flips += (ndotv[i] > 0.0f) != (q_ndotv[i] > 0.0f);
+			if(dcurv){
+				kr_error = std::max(kr_error, float(fabs(kr[i] - q_kr[i])));
+				num_error = std::max(num_error, float(fabs(num[i] - q_num[i])));
+				kr_flips += (kr[i] > 0.0f) != (q_kr[i] > 0.0f);
+				num_flips += (num[i] > 0.0f) != (q_num[i] > 0.0f);
+			}
+		}
+	}
+	double samples = double(nv) * views;
+	std::cout << "Line extraction error over " << views << " views: n dot v " << ndotv_error << " (sign changes at "
+			<< 100.0 * ndotv_flips / samples << "% of vertices)";
+	if(dcurv){
+		std::cout << ", kr " << kr_error << " (" << 100.0 * kr_flips / samples << "%), dkr " << num_error
+				<< " (" << 100.0 * num_flips / samples << "%)";
+	}
+	std::cout << std::endl;
+}
+
+/**
+ * Finish reporting a preprocessing stage
+ *
+ * @param start: when the stage started
+ */
+void MeshData::reportStage(trimesh::timestamp start){
+	float t = trimesh::now() - start;
+	preprocessing_time_ += t;
+	std::cout << "Done (" << int(1000.0f * t) << " ms)" << std::endl;
+}
+
+/**
+ * Write all mesh properties built so far to the preprocessed mesh cache, if anything was built since the mesh got loaded
+ */
+void MeshData::writeCache(){
+	if(!cache_dirty_){
+		return;
+	}
+	// the cache holds what was built on the source file, not on an edited mesh
+	if(edited_){
+		std::cout << "Mesh was edited, not writing mesh cache " << mesh_cache_filename(filename_.c_str()) << std::endl;
+		return;
+	}
+	// the cache holds full precision data only
+	if(compact_){
+		std::cout << "Mesh data is compact, not writing mesh cache " << mesh_cache_filename(filename_.c_str()) << std::endl;
+		return;
+	}
+	// (a mesh parsed from source hasn't been hashed yet)
+	uint64_t size;
+	if(source_.hash == 0 && !hash_mesh_file(filename_.c_str(), source_.hash, size)){
+		std::cout << "Could not read " << filename_ << ", not writing mesh cache" << std::endl;
+		return;
+	}
+	if(!write_mesh_cache(filename_.c_str(), source_, mesh_, facenormals_, corners_, feature_size_, available_)){
+		std::cout << "Could not write mesh cache " << mesh_cache_filename(filename_.c_str()) << std::endl;
+	}
+	cache_dirty_ = false;
+}
+
+/**
+ * Build a level of detail hierarchy: every level is simplified from the previous one to a quarter of its faces (so
+ * it suits half the screen resolution), until we reach the given minimum. Every level gets everything this mesh has
+ * built, recomputed on its own mesh (curvatures and their derivatives included), so drawers work on any level.
+ *
+ * @param min_faces: don't build levels with fewer faces than this
+ */
+void MeshData::buildLevels(int min_faces){
+	const trimesh::TriMesh* source = levels_.empty() ? mesh_ : levels_.back()->mesh_;
+	while(int(source->faces.size() / 4) >= min_faces){
+		int target = source->faces.size() / 4;
+		std::cout << "Simplifying to " << target << " faces... ";
+		TraceScope trace("simplify");
+		trimesh::timestamp start = trimesh::now();
+		trimesh::TriMesh* simplified = new trimesh::TriMesh();
+		simplify_mesh(source, target, simplified);
+		reportStage(start);
+		// stop when simplification gets stuck
+		if(simplified->faces.size() > 0.9f * source->faces.size()){
+			delete simplified;
+			break;
+		}
+		MeshData* level = new MeshData(simplified);
+		level->require(available_ & ~MESH_REORDERED);
+		if(available_ & MESH_REORDERED){
+			level->reorder();
+		}
+		if(compact_){
+			level->compact();
+		}
+		preprocessing_time_ += level->preprocessing_time_;
+		levels_.push_back(level);
+		source = simplified;
+	}
+	std::cout << "Levels of detail: " << levels() << std::endl;
+}
+
+int MeshData::levels() const{
+	return levels_.size() + 1;
+}
+
+MeshData* MeshData::level(int level){
+	return level == 0 ? this : levels_[level-1];
+}
+
+/**
+ * Place the per-vertex arrays of this mesh and its levels of detail according to the NUMA policy: split over the nodes
+ * the same way the per-vertex passes split their work, or interleaved. Preprocessing (re)allocates these arrays, so
+ * do this after the last preprocessing step.
+ */
+void MeshData::placeVertexData(){
+	for(unsigned int i = 0; i < levels_.size(); i++){
+		levels_[i]->placeVertexData();
+	}
+	trimesh::TriMesh* mesh = mutable_mesh_;
+	numa_place(mesh->vertices);
+	numa_place(mesh->normals);
+	numa_place(mesh->pdir1);
+	numa_place(mesh->pdir2);
+	numa_place(mesh->curv1);
+	numa_place(mesh->curv2);
+	numa_place(mesh->dcurv);
+	numa_place(quantized_.vertices_);
+}
+
+bool MeshData::isCompact() const{
+	return compact_;
+}
+
+/**
+ * Move some vertices, and update everything built on their positions in the region the edit affects (see
+ * find_curvature_region): face normals, vertex normals, point areas, curvatures, curvature derivatives and the VBOs.
+ * Apart from the first edit, which builds the vertex to face adjacency, this costs time proportional to the size of
+ * the edit. Connectivity and triangle strips don't depend on positions; the feature size is a statistic of the whole
+ * mesh and doesn't get updated.
+ *
+ * Updates need the float attributes: compact attributes get expanded on the first edit (call compact() again when
+ * done editing). Levels of detail are simplified from the mesh as it was loaded, so an edited mesh gets drawn at full
+ * resolution (see Model::selectLevel), and edits don't end up in the mesh cache.
+ * Models read this data while extracting, so no extraction may be running.
+ *
+ * @param vertices: the indices of the vertices to move
+ * @param positions: their new positions
+ */
+void MeshData::moveVertices(const std::vector<int> &vertices, const std::vector<trimesh::point> &positions){
+	if(vertices.empty()){
+		return;
+	}
+	if(compact_){
+		expand();
+	}
+	trimesh::TriMesh* mesh = mutable_mesh_;
+	if(vertex_faces_.start_.empty()){
+		build_vertex_faces(mesh, vertex_faces_);
+	}
+	edited_ = true;
+	for(unsigned int i = 0; i < vertices.size(); i++){
+		mesh->vertices[vertices[i]] = positions[i];
+		// the bounding sphere only grows, to keep the mesh inside it
+		mesh->bsphere.r = std::max(mesh->bsphere.r, trimesh::dist(mesh->bsphere.center, positions[i]));
+	}
+	CurvatureRegion region;
+	find_curvature_region(mesh, vertex_faces_, vertices, region);
+	if(available_ & MESH_FACENORMALS){
+		for(unsigned int k = 0; k < region.faces_.size(); k++){
+			facenormals_[region.faces_[k]] = computeFaceNormal(mesh_, region.faces_[k]);
+		}
+	}
+	if(available_ & MESH_NORMALS){
+		update_normals(mesh, vertex_faces_, region.normals_);
+	}
+	if(available_ & MESH_CURVATURES){
+		// point areas are not cached, so compute them all once when curvatures came from the cache
+		if(mesh->pointareas.size() != mesh->vertices.size()){
+			FaceColoring coloring;
+			color_faces(mesh, coloring);
+			compute_pointareas(mesh, coloring);
+		}
+		update_curvatures(mesh, vertex_faces_, region);
+	}
+	if(available_ & MESH_DCURV){
+		update_dcurv(mesh, vertex_faces_, region);
+	}
+	// (the region's vertex lists are sorted already)
+	std::vector<int> moved(vertices);
+	std::sort(moved.begin(), moved.end());
+	moved.erase(std::unique(moved.begin(), moved.end()), moved.end());
+	updateVBO(vbo_positions_, mesh->vertices, moved);
+	if(available_ & MESH_NORMALS){
+		updateVBO(vbo_normals_, mesh->normals, region.normals_);
+	}
+}
+
+bool MeshData::isEdited() const{
+	return edited_;
+}
+
+/**
+ * Show another frame of an animated sequence (see MeshSequence.h), which has the same connectivity: swap in its
+ * positions and everything built on them, and upload them. The frame gets our previous data in return, so its memory
+ * gets reused for a later frame. Everything built on the connectivity (corner table, triangle strips) stays.
+ * Like moveVertices, this counts as an edit (levels of detail and the mesh cache don't follow), and no extraction
+ * may be running.
+ *
+ * @param frame: the frame, with everything this mesh has built
+ */
+void MeshData::swapFrame(MeshFrame &frame){
+	if(compact_){
+		expand();
+	}
+	trimesh::TriMesh* mesh = mutable_mesh_;
+	mesh->vertices.swap(frame.vertices_);
+	mesh->bsphere.r = frame.radius_;
+	if(available_ & MESH_NORMALS){
+		mesh->normals.swap(frame.normals_);
+	}
+	if(available_ & MESH_FACENORMALS){
+		facenormals_.swap(frame.facenormals_);
+	}
+	if(available_ & MESH_CURVATURES){
+		mesh->pdir1.swap(frame.pdir1_);
+		mesh->pdir2.swap(frame.pdir2_);
+		mesh->curv1.swap(frame.curv1_);
+		mesh->curv2.swap(frame.curv2_);
+		mesh->pointareas.swap(frame.pointareas_);
+		mesh->cornerareas.swap(frame.cornerareas_);
+	}
+	if(available_ & MESH_DCURV){
+		mesh->dcurv.swap(frame.dcurv_);
+	}
+	if(available_ & MESH_FEATURE_SIZE){
+		feature_size_ = frame.feature_size_;
+	}
+	edited_ = true;
+	if(!clusters_.empty()){
+		buildClusters();
+	}
+	int nv = mesh->vertices.size();
+	updateVBO(vbo_positions_, mesh->vertices, 0, nv - 1);
+	if(available_ & MESH_NORMALS){
+		updateVBO(vbo_normals_, mesh->normals, 0, nv - 1);
+	}
+}
+
+unsigned int MeshData::available() const{
+	return available_;
+}
+
+/**
+ * Cut the faces lines get extracted from (see line_faces_) in clusters of CLUSTER_FACES consecutive faces, which mostly
+ * lie close together on the surface (as meshes come, and certainly after reorder), and bound the positions and face
+ * normals of every cluster, and list the vertex blocks every cluster uses. Rebuilding keeps the memory.
+ * Showing another frame of a sequence (see swapFrame) rebuilds them. Edits of a few vertices (see moveVertices) leave
+ * the bounds stale: they only steer the order of progressive extraction, not what it extracts, and the vertex blocks
+ * only depend on the connectivity.
+ */
+void MeshData::buildClusters(){
+	const std::vector<trimesh::TriMesh::Face> &faces = mesh_->faces;
+	const std::vector<trimesh::point> &vertices = mesh_->vertices;
+	int n = (line_faces_ + CLUSTER_FACES - 1) / CLUSTER_FACES;
+	clusters_.resize(n);
+	parallel_for(0, n, 1, [&](int c){
+		FaceCluster &cluster = clusters_[c];
+		cluster.begin_ = c * CLUSTER_FACES;
+		cluster.end_ = std::min(cluster.begin_ + CLUSTER_FACES, line_faces_);
+		trimesh::point lo(1e38f, 1e38f, 1e38f);
+		trimesh::point hi(-1e38f, -1e38f, -1e38f);
+		trimesh::vec sum(0.0f, 0.0f, 0.0f);
+		for(unsigned int f = cluster.begin_; f < cluster.end_; f++){
+			for(int k = 0; k < 3; k++){
+				const trimesh::point &p = vertices[faces[f][k]];
+				for(int j = 0; j < 3; j++){
+					lo[j] = std::min(lo[j], p[j]);
+					hi[j] = std::max(hi[j], p[j]);
+				}
+			}
+			// (area weighted)
+			sum += (vertices[faces[f][1]] - vertices[faces[f][0]]) CROSS (vertices[faces[f][2]] - vertices[faces[f][0]]);
+		}
+		cluster.center_ = 0.5f * (lo + hi);
+		cluster.radius_ = 0.0f;
+		float min_cos = 1.0f;
+		float length = len(sum);
+		cluster.axis_ = length > 0.0f ? sum / length : trimesh::vec(0.0f, 0.0f, 1.0f);
+		for(unsigned int f = cluster.begin_; f < cluster.end_; f++){
+			for(int k = 0; k < 3; k++){
+				cluster.radius_ = std::max(cluster.radius_, dist(cluster.center_, vertices[faces[f][k]]));
+			}
+			trimesh::vec normal = (vertices[faces[f][1]] - vertices[faces[f][0]]) CROSS (vertices[faces[f][2]] - vertices[faces[f][0]]);
+			float l = len(normal);
+			if(l > 0.0f){
+				min_cos = std::min(min_cos, (normal DOT cluster.axis_) / l);
+			}
+		}
+		cluster.spread_ = length > 0.0f ? acosf(std::max(-1.0f, min_cos)) : 3.14159265f;
+		cluster.blocks_.clear();
+		for(unsigned int f = cluster.begin_; f < cluster.end_; f++){
+			for(int k = 0; k < 3; k++){
+				cluster.blocks_.push_back(faces[f][k] / VERTEX_BLOCK);
+			}
+		}
+		std::sort(cluster.blocks_.begin(), cluster.blocks_.end());
+		cluster.blocks_.erase(std::unique(cluster.blocks_.begin(), cluster.blocks_.end()), cluster.blocks_.end());
+	});
+}
+
+/**
+ * Transfer vertex/normal info into GPU memory as STATIC_DRAW data in Vertex Buffer Objects (VBO's).
+ */
+void MeshData::setupVBOs(){
+	int bufferSize;
+	// load vertex positions into VBO buffer
+	glGenBuffersARB(1, &vbo_positions_);
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB, vbo_positions_);
+	// static draw data, we're not going to change vertex information
+	glBufferDataARB(GL_ARRAY_BUFFER_ARB, mesh_->vertices.size()*sizeof(float)*3, &(mesh_->vertices[0]), GL_STATIC_DRAW_ARB);
+	glGetBufferParameterivARB(GL_ARRAY_BUFFER_ARB, GL_BUFFER_SIZE_ARB, &bufferSize);
+	std::cout << "Vertex array loaded in VBO: " << bufferSize << " bytes\n" << std::endl;
+	// unbind buffers to prevent fudging up pointer arithmetic
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+	// normals might not be there yet
+	if(available_ & MESH_NORMALS){
+		setupNormalVBO();
+	}
+}
+
+/**
+ * Upload a range of changed vertex data into a VBO
+ *
+ * @param vbo: the VBO
+ * @param values: the vertex data
+ * @param first, last: the first and last changed vertex
+ */
+void MeshData::updateVBO(GLuint vbo, const std::vector<trimesh::vec> &values, int first, int last){
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB, vbo);
+	glBufferSubDataARB(GL_ARRAY_BUFFER_ARB, first * sizeof(trimesh::vec), (last - first + 1) * sizeof(trimesh::vec), &values[first]);
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+}
+
+/**
+ * Upload scattered changed vertex data into a VBO: one upload per run of consecutive vertices, so we upload what
+ * changed rather than everything between the first and the last changed vertex
+ *
+ * @param vbo: the VBO
+ * @param values: the vertex data
+ * @param indices: the changed vertices, sorted, without duplicates
+ */
+void MeshData::updateVBO(GLuint vbo, const std::vector<trimesh::vec> &values, const std::vector<int> &indices){
+	if(indices.empty()){
+		return;
+	}
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB, vbo);
+	unsigned int begin = 0;
+	for(unsigned int i = 1; i <= indices.size(); i++){
+		if(i == indices.size() || indices[i] != indices[i-1] + 1){
+			int first = indices[begin];
+			glBufferSubDataARB(GL_ARRAY_BUFFER_ARB, first * sizeof(trimesh::vec), (i - begin) * sizeof(trimesh::vec), &values[first]);
+			begin = i;
+		}
+	}
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+}
+
+/**
+ * Transfer normal info into GPU memory as STATIC_DRAW data in a Vertex Buffer Object.
+ */
+void MeshData::setupNormalVBO(){
+	int bufferSize;
+	glGenBuffersARB(1, &vbo_normals_);
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB, vbo_normals_);
+	// static draw data, we're not going to change vertex information
+	glBufferDataARB(GL_ARRAY_BUFFER_ARB, mesh_->normals.size()*sizeof(float)*3, &(mesh_->normals[0]), GL_STATIC_DRAW_ARB);
+	glGetBufferParameterivARB(GL_ARRAY_BUFFER_ARB, GL_BUFFER_SIZE_ARB, &bufferSize);
+	std::cout << "Normal array loaded in VBO: " << bufferSize << " bytes\n" << std::endl;
+	// unbind buffers to prevent fudging up pointer arithmetic
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+}
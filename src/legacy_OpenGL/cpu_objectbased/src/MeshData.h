@@ -0,0 +1,167 @@
+/*
+ * MeshData.h
+ *
+ * The view-independent data of a mesh: the mesh itself, everything we precompute on it, its VBOs and its levels of
+ * detail. Built once per asset, then shared (read-only) by every Model instance placing that asset in the scene.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include <TriMesh.h>
+#include "quantize.h"
+#include "CornerTable.h"
+#include "curvature.h"
+#include "ThreadPool.h"
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <GL/glew.h>
+#include "timestamp.h"
+#include "mesh_cache.h"
+
+#ifndef MESHDATA_H_
+#define MESHDATA_H_
+
+// view-independent mesh properties a Drawer can require from a Model
+enum MeshProperty{
+	MESH_NORMALS = 1, // vertex normals
+	MESH_TSTRIPS = 2, // triangle strips
+	MESH_CONNECTIVITY = 4, // corner table (see CornerTable.h)
+	MESH_CURVATURES = 8, // principal curvatures and directions (needs normals)
+	MESH_DCURV = 16, // curvature derivatives (needs curvatures)
+	MESH_FACENORMALS = 32, // face normals
+	MESH_FEATURE_SIZE = 64, // feature size (needs curvatures)
+	MESH_REORDERED = 128, // vertices and faces are in locality-optimized order (see mesh_reorder.h)
+	MESH_ALL = 255
+};
+
+// number of consecutive faces in a cluster (see MeshData::buildClusters)
+#define CLUSTER_FACES 1024
+// number of consecutive vertices in a block: progressive extraction computes view-dependent data a block at a time, for
+// the blocks the clusters it gets to use (see Model::continueProgressive)
+#define VERTEX_BLOCK 1024
+
+// a run of consecutive faces, bounded in space and in orientation, so progressive extraction can do the clusters
+// likely to show lines first
+struct FaceCluster{
+	unsigned int begin_; // faces [begin_, end_)
+	unsigned int end_;
+	trimesh::point center_; // bounding sphere
+	float radius_;
+	trimesh::vec axis_; // normal cone: every face normal is within spread_ radians of axis_
+	float spread_;
+	std::vector<unsigned int> blocks_; // the vertex blocks (see VERTEX_BLOCK) its faces use, in order
+};
+
+// everything a mesh builds on its vertex positions: one frame of an animated sequence (see MeshSequence.h)
+struct MeshFrame{
+	std::vector<trimesh::point> vertices_;
+	std::vector<trimesh::vec> normals_;
+	std::vector<trimesh::vec> pdir1_;
+	std::vector<trimesh::vec> pdir2_;
+	std::vector<float> curv1_;
+	std::vector<float> curv2_;
+	std::vector<trimesh::Vec<4,float> > dcurv_;
+	std::vector<float> pointareas_;
+	std::vector<trimesh::vec> cornerareas_;
+	std::vector<trimesh::vec> facenormals_;
+	// bounding sphere radius (around the center of the mesh's bounding sphere) and feature size
+	float radius_;
+	float feature_size_;
+	MeshFrame(): radius_(0.0f), feature_size_(0.0f){}
+};
+
+class MeshData
+{
+private:
+	// the mesh, as we can modify it while building properties
+	trimesh::TriMesh* mutable_mesh_;
+	// the mesh properties which have been built
+	unsigned int available_;
+	// the source file, and what the preprocessed mesh cache records of it
+	std::string filename_;
+	MeshSource source_;
+	bool cache_dirty_;
+	// are the vertex attributes in their compact form?
+	bool compact_;
+	// level of detail hierarchy: coarser versions of this mesh, every one with a quarter of the faces of the previous
+	std::vector<MeshData*> levels_;
+	// have vertices been moved since loading? (see moveVertices)
+	bool edited_;
+	// vertex to face adjacency, built on the first edit
+	VertexFaces vertex_faces_;
+
+	// construct a level of detail from a simplified mesh
+	MeshData(trimesh::TriMesh* mesh);
+
+	// some private helper functions
+	void setupVBOs();
+	void setupNormalVBO();
+	void updateVBO(GLuint vbo, const std::vector<trimesh::vec> &values, int first, int last);
+	void updateVBO(GLuint vbo, const std::vector<trimesh::vec> &values, const std::vector<int> &indices);
+	void reportStage(trimesh::timestamp start);
+	void expand();
+	void measureQuantizationError();
+
+public:
+	// the mesh
+	const trimesh::TriMesh* mesh_;
+	// total time spent building mesh properties, in seconds
+	float preprocessing_time_;
+
+	// vertex buffer objects for GPU storage
+	GLuint vbo_positions_;
+	GLuint vbo_normals_;
+
+	// VIEW INDEPENDENT VALUES
+	std::vector<trimesh::vec> facenormals_;
+	CornerTable corners_;
+	float feature_size_;
+	// lines get extracted from faces 0 ... line_faces_-1: all of them, except for a chunk of an out-of-core mesh,
+	// whose halo faces come last and get their lines from the neighbouring chunks (see ChunkStore.h)
+	unsigned int line_faces_;
+	// clusters of consecutive faces (see buildClusters)
+	std::vector<FaceCluster> clusters_;
+	// compact vertex attributes, replacing the mesh's normals, principal directions and curvatures after compact()
+	QuantizedAttributes quantized_;
+	// how to run the view-dependent vertex kernels on this mesh (see autotune.h)
+	KernelConfig kernel_config_;
+
+	// constructor: read a mesh (or its preprocessed version) from file, in the order of the file if asked to
+	MeshData(const char* filename, bool source_order = false);
+	// constructor: data for a mesh which comes with some properties already built (a chunk of an out-of-core mesh,
+	// see ChunkStore.h, with its own faces first), we take ownership of the mesh
+	MeshData(trimesh::TriMesh* mesh, unsigned int properties, float feature_size, unsigned int owned_faces);
+	~MeshData();
+
+	// build the given mesh properties (and whatever they depend on), if they aren't there yet
+	void require(unsigned int properties);
+	// reorder vertices and faces for memory locality (remapping everything built so far)
+	void reorder();
+	// build a level of detail hierarchy, down to (about) the given number of faces
+	void buildLevels(int min_faces);
+	// number of levels of detail (including the full resolution mesh)
+	int levels() const;
+	// the data of a level of detail (0 is this one)
+	MeshData* level(int level);
+	// replace the float vertex attributes by a compact (quantized) representation
+	void compact();
+	// are the vertex attributes in compact form?
+	bool isCompact() const;
+	// write everything built so far to the preprocessed mesh cache, if anything changed
+	void writeCache();
+	// place the per-vertex arrays according to the NUMA policy (see numa.h), after the last preprocessing step
+	void placeVertexData();
+	// move some vertices, and update what was built on their positions in the region the edit affects
+	void moveVertices(const std::vector<int> &vertices, const std::vector<trimesh::point> &positions);
+	// have vertices been moved since loading?
+	bool isEdited() const;
+	// swap in another frame of an animated sequence with the same connectivity (we get its data, it gets ours)
+	void swapFrame(MeshFrame &frame);
+	// the mesh properties which have been built (a mask of MeshProperty values)
+	unsigned int available() const;
+	// cut the faces in clusters, and bound them (again, after the mesh changed)
+	void buildClusters();
+};
+
+#endif /* MESHDATA_H_ */
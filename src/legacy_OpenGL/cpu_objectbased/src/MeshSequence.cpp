@@ -0,0 +1,228 @@
+/*
+ * Implementation of a MeshSequence, an animated mesh whose frames get prepared on a loader thread.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "MeshSequence.h"
+#include "MeshParser.h"
+#include "mesh_info.h"
+#include "timestamp.h"
+#include "Tracer.h"
+#include <cstring>
+#include <cmath>
+#include <iostream>
+
+/**
+ * Constructor: build what all frames share from the first one, and start preparing the next ones
+ *
+ * @param data: the mesh data of the first frame, with everything built that the frames need, in the order of its file
+ * (see the MeshData constructor): the other frames get matched against it in the order of theirs
+ * @param filenames: the mesh files of all frames, in order
+ * @param ring: the number of frames to prepare ahead
+ */
+MeshSequence::MeshSequence(MeshData* data, const std::vector<std::string> &filenames, int ring): data_(data), filenames_(filenames),
+		properties_(data->available()), radius_(data->mesh_->bsphere.r), fill_(0), next_(1), take_(0), frame_(0), playing_(true), quit_(false){
+	std::cout << "Building sequence connectivity... ";
+	trimesh::timestamp start = trimesh::now();
+	mesh_.faces = data->mesh_->faces;
+	mesh_.vertices.resize(data->mesh_->vertices.size());
+	center_ = data->mesh_->bsphere.center;
+	mesh_.bsphere = data->mesh_->bsphere;
+	color_faces(&mesh_, coloring_);
+	build_vertex_faces(&mesh_, adjacency_);
+	all_vertices_.resize(mesh_.vertices.size());
+	for(unsigned int i = 0; i < all_vertices_.size(); i++){
+		all_vertices_[i] = i;
+	}
+	std::cout << "Done (" << int(1000.0f * (trimesh::now() - start)) << " ms)" << std::endl;
+	// (the faces of a reordered first frame never match the others)
+	bool reordered = (properties_ & MESH_REORDERED) != 0;
+	if(reordered){
+		std::cout << "The first frame of the sequence got reordered, only showing that one" << std::endl;
+	}
+	slots_.resize(filenames_.size() > 1 && !reordered ? std::max(ring, 1) : 0);
+	for(unsigned int s = 0; s < slots_.size(); s++){
+		slots_[s].index_ = -1;
+		slots_[s].valid_ = false;
+		slots_[s].ready_ = false;
+	}
+	if(!slots_.empty()){
+		thread_ = std::thread(&MeshSequence::run, this);
+	}
+}
+
+/**
+ * Destructor: stop the loader (after the frame it is preparing)
+ */
+MeshSequence::~MeshSequence(){
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		quit_ = true;
+	}
+	cv_.notify_all();
+	if(thread_.joinable()){
+		thread_.join();
+	}
+}
+
+int MeshSequence::frames() const{
+	return filenames_.size();
+}
+
+int MeshSequence::frame() const{
+	return frame_;
+}
+
+/**
+ * Loader thread main loop: prepare the next frame in the next slot, whenever that one is free
+ */
+void MeshSequence::run(){
+	Tracer::nameThread("sequence loader");
+	std::unique_lock<std::mutex> lock(mutex_);
+	while(true){
+		cv_.wait(lock, [this]{ return quit_ || !slots_[fill_].ready_; });
+		if(quit_){
+			return;
+		}
+		Slot &slot = slots_[fill_];
+		int index = next_;
+		// prepare the frame without holding the lock, so the GL thread can poll us
+		lock.unlock();
+		slot.valid_ = load(index, slot.frame_);
+		slot.index_ = index;
+		lock.lock();
+		slot.ready_ = true;
+		fill_ = (fill_ + 1) % slots_.size();
+		next_ = (next_ + 1) % filenames_.size();
+	}
+}
+
+/**
+ * Read the positions of a frame, check its connectivity and compute everything the mesh data has built on positions.
+ * Runs on the loader thread (its parallel loops run on the thread pool, alongside the extraction).
+ *
+ * @param index: the frame
+ * @param frame: where the frame goes (its arrays get reused)
+ * @return false if the frame can't be read, or doesn't have the sequence's connectivity
+ */
+bool MeshSequence::load(int index, MeshFrame &frame){
+	TraceScope trace("load sequence frame");
+	trimesh::timestamp start = trimesh::now();
+	const char* filename = filenames_[index].c_str();
+	size_t nv = mesh_.vertices.size(), nf = mesh_.faces.size();
+	// parse the positions straight into the frame
+	MeshParser parser;
+	bool ok = parser.open(filename) && parser.vertices() == nv && parser.faces() == nf;
+	if(ok){
+		frame.vertices_.resize(nv);
+		faces_.resize(nf);
+		ok = parser.parse(&frame.vertices_[0], &faces_[0]);
+	}
+	else{
+		trimesh::TriMesh* mesh = trimesh::TriMesh::read(filename);
+		if(mesh){
+			mesh->need_faces();
+			ok = mesh->vertices.size() == nv && mesh->faces.size() == nf;
+			frame.vertices_.swap(mesh->vertices);
+			faces_.swap(mesh->faces);
+			delete mesh;
+		}
+	}
+	ok = ok && memcmp(&faces_[0], &mesh_.faces[0], nf * sizeof(trimesh::TriMesh::Face)) == 0;
+	if(!ok){
+		std::cout << "Frame " << filename << " doesn't have the faces of the first frame, skipping it" << std::endl;
+		return false;
+	}
+
+	// compute on our mesh, which has the sequence's faces: swap the frame's arrays in, and back out when done
+	mesh_.vertices.swap(frame.vertices_);
+	mesh_.normals.swap(frame.normals_);
+	mesh_.pdir1.swap(frame.pdir1_);
+	mesh_.pdir2.swap(frame.pdir2_);
+	mesh_.curv1.swap(frame.curv1_);
+	mesh_.curv2.swap(frame.curv2_);
+	mesh_.dcurv.swap(frame.dcurv_);
+	mesh_.pointareas.swap(frame.pointareas_);
+	mesh_.cornerareas.swap(frame.cornerareas_);
+	float r2 = 0.0f;
+	for(size_t i = 0; i < nv; i++){
+		r2 = std::max(r2, trimesh::dist2(mesh_.vertices[i], center_));
+	}
+	// (the bounding sphere only grows, so the camera doesn't have to follow)
+	radius_ = std::max(radius_, std::sqrt(r2));
+	mesh_.bsphere.r = radius_;
+	if(properties_ & MESH_NORMALS){
+		mesh_.normals.resize(nv);
+		update_normals(&mesh_, adjacency_, all_vertices_);
+	}
+	if(properties_ & MESH_FACENORMALS){
+		computeFaceNormals(&mesh_, frame.facenormals_);
+	}
+	if(properties_ & MESH_CURVATURES){
+		compute_curvatures(&mesh_, coloring_);
+	}
+	if(properties_ & MESH_DCURV){
+		compute_dcurv(&mesh_, coloring_);
+	}
+	if(properties_ & MESH_FEATURE_SIZE){
+		frame.feature_size_ = computeFeatureSize(&mesh_);
+	}
+	frame.radius_ = radius_;
+	mesh_.vertices.swap(frame.vertices_);
+	mesh_.normals.swap(frame.normals_);
+	mesh_.pdir1.swap(frame.pdir1_);
+	mesh_.pdir2.swap(frame.pdir2_);
+	mesh_.curv1.swap(frame.curv1_);
+	mesh_.curv2.swap(frame.curv2_);
+	mesh_.dcurv.swap(frame.dcurv_);
+	mesh_.pointareas.swap(frame.pointareas_);
+	mesh_.cornerareas.swap(frame.cornerareas_);
+	std::cout << "Prepared frame " << index << " (" << int(1000.0f * (trimesh::now() - start)) << " ms)" << std::endl;
+	return true;
+}
+
+/**
+ * Check whether the next frame has been prepared, without blocking
+ */
+bool MeshSequence::ready(){
+	if(slots_.empty() || !playing_){
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(mutex_);
+	return slots_[take_].ready_;
+}
+
+/**
+ * Show the next frame, if it has been prepared: swap its data into the mesh data, and give the slot back to the
+ * loader. Frames which didn't match the sequence's connectivity get skipped.
+ * Call on the GL thread (this uploads the VBOs), while no extraction is running.
+ *
+ * @return whether the mesh data changed
+ */
+bool MeshSequence::advance(){
+	if(!ready()){
+		return false;
+	}
+	Slot &slot = slots_[take_];
+	bool shown = slot.valid_;
+	if(shown){
+		data_->swapFrame(slot.frame_);
+		frame_ = slot.index_;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		slot.ready_ = false;
+		take_ = (take_ + 1) % slots_.size();
+	}
+	cv_.notify_all();
+	return shown;
+}
+
+void MeshSequence::togglePlaying(){
+	playing_ = !playing_;
+}
+
+bool MeshSequence::playing() const{
+	return playing_;
+}
@@ -0,0 +1,89 @@
+/*
+ * Definition of a MeshSequence, an animated mesh: a sequence of mesh files (frames) with the same connectivity.
+ *
+ * The first frame gets loaded and preprocessed as usual, as the MeshData every Model of the sequence shows. Everything
+ * built on its connectivity (corner table, triangle strips, VBO layout, the face coloring and vertex to face adjacency
+ * the per-frame passes need) is built once and reused for every frame. Per frame, only the positions get read, and
+ * whatever the mesh has built on them (normals, curvatures, curvature derivatives, ...) gets recomputed.
+ *
+ * A loader thread prepares the next frames in a small ring of slots, while the GL thread extracts and draws the
+ * current one: preparing frame N+1 overlaps with showing frame N. Showing the next frame swaps its data into the
+ * MeshData, and the slot gets the previous frame's data in return, to be reused for a later frame: memory stays
+ * bounded by the ring, and nothing gets reallocated once every slot has been used.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef MESHSEQUENCE_H_
+#define MESHSEQUENCE_H_
+
+#include "MeshData.h"
+#include "curvature.h"
+#include <TriMesh.h>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// number of frames prepared ahead of the one on screen
+#define SEQUENCE_RING_FRAMES 2
+
+class MeshSequence{
+private:
+	// a frame in the ring: the loader owns it until it's ready, then the GL thread does until it gets shown
+	struct Slot{
+		MeshFrame frame_;
+		int index_;
+		bool valid_; // does the frame have the sequence's connectivity?
+		bool ready_;
+	};
+
+	MeshData* data_;
+	std::vector<std::string> filenames_;
+	unsigned int properties_;
+	// the connectivity of the sequence, and what gets built on it once
+	trimesh::TriMesh mesh_;
+	FaceColoring coloring_;
+	VertexFaces adjacency_;
+	std::vector<int> all_vertices_;
+	trimesh::point center_;
+	float radius_;
+	// the faces of a frame being read, to check them against the sequence's
+	std::vector<trimesh::TriMesh::Face> faces_;
+
+	std::vector<Slot> slots_;
+	int fill_; // the slot the loader fills next, with frame next_
+	int next_;
+	int take_; // the slot the GL thread shows next
+	int frame_; // the frame on screen
+	bool playing_;
+	std::thread thread_;
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	bool quit_;
+
+	void run();
+	bool load(int index, MeshFrame &frame);
+
+	// no copies: the loader thread refers to this object
+	MeshSequence(const MeshSequence&);
+	MeshSequence& operator=(const MeshSequence&);
+
+public:
+	// constructor: a sequence of frames, the first of which is loaded in the given mesh data, starts the loader
+	MeshSequence(MeshData* data, const std::vector<std::string> &filenames, int ring = SEQUENCE_RING_FRAMES);
+	~MeshSequence();
+	// number of frames, and the frame on screen
+	int frames() const;
+	int frame() const;
+	// is the next frame prepared?
+	bool ready();
+	// show the next frame in the mesh data (no extraction may be running), returns whether it changed
+	bool advance();
+	// play or pause the sequence
+	void togglePlaying();
+	bool playing() const;
+};
+
+#endif /* MESHSEQUENCE_H_ */
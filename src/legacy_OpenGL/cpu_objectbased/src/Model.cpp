@@ -1,46 +1,395 @@
 /*
- * Implementation of the Model class, a class representing a loaded mesh and its view-independent and view-dependent data.
+ * Implementation of the Model class, an instance of a mesh with its own transformation, drawers and view-dependent data.
  *
  * Author: Jeroen Baert
  */
 
 #include "Model.h"
-#include "mesh_info.h"
 #include "vertex_info.h"
+#include "numa.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
 
 /**
- * Constructor: construct a model
- * @param filename : the filesystem location of the file containing mesh_ data
+ * Constructor: construct a model, as a new instance of some mesh data. The instance starts at the origin
+ * (identity transformation), and gets view-dependent buffers for every level of detail the data has.
+ * @param data : the (shared) mesh data
  */
-Model::Model(const char* filename)
+Model::Model(MeshData* data): level_(0), extract_source_(this), next_work_(0), progressive_(false), profile_vertex_(-1), data_(data), mesh_(data->mesh_), front_(0), ndotv_valid_(false), curv_derivatives_valid_(false)
 {
-	// read mesh_ from file
-	trimesh::TriMesh* mesh = trimesh::TriMesh::read(filename);
-	// TriMesh2 library can calculate some vertex-info for us
-	mesh->need_across_edge();
-	mesh->need_normals();
-	mesh->need_tstrips();
-	mesh->need_bsphere();
-	mesh->need_curvatures();
-	mesh->need_across_edge();
-	mesh->need_dcurv();
-	mesh_ = mesh;
-	computeViewIndependentData();
-	setupVBOs();
+	segment_level_[0] = segment_level_[1] = 0;
+	for(int l = 1; l < data->levels(); l++){
+		levels_.push_back(new Model(data->level(l)));
+	}
+	allocateViewDependentData();
+	if(data->clusters_.empty()){
+		data->buildClusters();
+	}
+}
+
+Model::~Model(){
+	for(unsigned int i = 0; i < levels_.size(); i++){
+		delete levels_[i];
+	}
 }
 
 /**
  * Draw a given model using it's current draw stack.
  *
- * @param camera_position: the current position of the camera, in 3d coordinates
+ * @param camera_position: the current position of the camera, in world coordinates
  */
 void Model::draw(trimesh::vec camera_position){
+	extract(camera_position);
+	swapSegments();
+	submit();
+}
+
+/**
+ * Run the extraction step of every visible drawer in the draw stack, filling the back segment buffers.
+ * This does not make any OpenGL calls, so it can run on a worker thread while the front buffers are being submitted.
+ *
+ * @param camera_position: the position of the camera to extract for, in world coordinates
+ */
+void Model::extract(trimesh::vec camera_position){
+	beginExtract(camera_position);
+	extractVertexData();
+	for(unsigned int i = 0; i<drawers_.size(); i++){
+		extractDrawer(i);
+	}
+}
+
+/**
+ * Start an extraction: pick the level of detail to extract from, and invalidate its view-dependent data.
+ *
+ * @param camera_position: the position of the camera to extract for, in world coordinates
+ */
+void Model::beginExtract(trimesh::vec camera_position){
+	// drawers work in object space
+	extract_camera_ = inv(transform_) * camera_position;
+	// the drawers extract from the selected level of detail
+	segment_level_[1-front_] = level_;
+	extract_source_ = levelModel(level_);
+	extract_source_->quality_ = quality_;
 	// clear all view-dependent buffers: drawers_ will fill them as necessary
-	clearViewDependentData();
-	// for every drawer in the draw stack, call draw function
+	extract_source_->clearViewDependentData();
+}
+
+/**
+ * Compute the per-vertex view-dependent data every visible drawer needs, so the drawers can extract concurrently.
+ */
+void Model::extractVertexData(){
+	ProfileTimer timer(profile_vertex_);
 	for(unsigned int i = 0; i<drawers_.size(); i++){
-		drawers_[i]->draw(this, camera_position);
+		if(drawers_[i]->isVisible()){
+			drawers_[i]->prepare(extract_source_, extract_camera_);
+		}
+	}
+}
+
+/**
+ * Run the extraction step of one drawer in the draw stack (if it is visible), into its back segment buffer.
+ *
+ * @param drawer: the index of the drawer in the drawer stack
+ */
+void Model::extractDrawer(unsigned int drawer){
+	SegmentBuffer &back = segments_[1-front_][drawer];
+	if(!drawers_[drawer]->isVisible()){
+		back.clear();
+		return;
+	}
+	bool profiled = drawer < profile_drawers_.size() && Profiler::getDefault();
+	{
+		ProfileTimer timer(profiled ? profile_drawers_[drawer].extract_ : -1);
+		drawers_[drawer]->extract(extract_source_, extract_camera_, back);
+		if(extract_source_->quality_.tolerance_ > 0.0f){
+			back.dropShorterThan(extract_source_->quality_.tolerance_);
+		}
+	}
+	if(profiled){
+		const DrawerSections &sections = profile_drawers_[drawer];
+		Profiler* profiler = Profiler::getDefault();
+		profiler->record(sections.candidates_, back.candidates_);
+		profiler->record(sections.crossings_, back.crossings_);
+		profiler->record(sections.segments_, back.vertices_.size() / 2);
+	}
+}
+
+/**
+ * Start a progressive extraction: empty the back segment buffers, and order the work: every
+ * line drawer on every cluster of faces. Silhouette drawers go first on the clusters whose normal cone says they may
+ * hold a contour, then suggestive contours, then the silhouette drawers on the rest (edge contours can lie on the
+ * border of a cluster which faces the camera completely, and face contours follow vertex normals, so those clusters
+ * can't be skipped). Within a tier, the clusters closest to the view direction go first. The per-vertex data every
+ * visible drawer needs gets computed on the way (see continueProgressive), so starting over after the camera moved
+ * doesn't cost a pass over all vertices.
+ *
+ * @param camera_position: the position of the camera to extract for, in world coordinates
+ * @param view_direction: the direction the camera looks in, in world coordinates
+ */
+void Model::beginProgressive(trimesh::vec camera_position, trimesh::vec view_direction){
+	beginExtract(camera_position);
+	blocks_ready_.assign((extract_source_->mesh_->vertices.size() + VERTEX_BLOCK - 1) / VERTEX_BLOCK, false);
+	trimesh::vec view = inv(transform_) * (camera_position + view_direction) - extract_camera_;
+	normalize(view);
+	const std::vector<FaceCluster> &clusters = extract_source_->data_->clusters_;
+	work_.clear();
+	// (the full resolution model has the most clusters: reserving for it once keeps level switches from allocating)
+	work_.reserve(drawers_.size() * data_->clusters_.size());
+	for(unsigned int i = 0; i < drawers_.size(); i++){
+		segments_[1-front_][i].clear();
+		if(!drawers_[i]->isVisible() || drawers_[i]->segmentVerticesPerFace() == 0){
+			continue;
+		}
+		bool silhouettes = drawers_[i]->silhouettes();
+		for(unsigned int c = 0; c < clusters.size(); c++){
+			const FaceCluster &cluster = clusters[c];
+			trimesh::vec to_camera = extract_camera_ - cluster.center_;
+			float d = len(to_camera);
+			// centrality: 0 in the middle of the view, up to 2 behind the camera
+			float centrality = d > 0.0f ? 1.0f + (to_camera DOT view) / d : 0.0f;
+			int tier = 1;
+			if(silhouettes){
+				bool candidate = d <= cluster.radius_ || cluster.spread_ >= 0.5f * 3.14159265f;
+				if(!candidate){
+					// the angle between the cone axis and the camera, and how far it can be off for any face
+					float angle = acosf(std::max(-1.0f, std::min(1.0f, (to_camera DOT cluster.axis_) / d)));
+					float margin = cluster.spread_ + asinf(cluster.radius_ / d);
+					candidate = angle + margin >= 0.5f * 3.14159265f && angle - margin <= 0.5f * 3.14159265f;
+				}
+				tier = candidate ? 0 : 2;
+			}
+			WorkItem item;
+			item.key_ = 4.0f * tier + centrality;
+			item.drawer_ = i;
+			item.cluster_ = c;
+			work_.push_back(item);
+		}
+	}
+	std::sort(work_.begin(), work_.end(), [](const WorkItem &a, const WorkItem &b){ return a.key_ < b.key_; });
+	next_work_ = 0;
+	progressive_ = true;
+}
+
+/**
+ * Go on with a progressive extraction until a time budget runs out (checked after every cluster, which includes
+ * computing the per-vertex data of the vertex blocks it uses, if no cluster before did). When the work is done, drop
+ * the short segments, record the counters and make the extracted segments the front ones: the result is the same as
+ * extract's.
+ *
+ * @param start: when the budget started
+ * @param budget: the time to stop at, in seconds after start
+ * @return true if the extraction completed (or none was in progress)
+ */
+bool Model::continueProgressive(const trimesh::timestamp &start, float budget){
+	if(!progressive_){
+		return true;
+	}
+	SegmentSet &back = segments_[1-front_];
+	const std::vector<FaceCluster> &clusters = extract_source_->data_->clusters_;
+	while(next_work_ < work_.size()){
+		const WorkItem &item = work_[next_work_++];
+		const FaceCluster &cluster = clusters[item.cluster_];
+		prepareBlocks(cluster);
+		drawers_[item.drawer_]->extractFaces(extract_source_, extract_camera_, cluster.begin_, cluster.end_, back[item.drawer_]);
+		if(next_work_ < work_.size() && trimesh::now() - start >= budget){
+			return false;
+		}
+	}
+	Profiler* profiler = Profiler::getDefault();
+	for(unsigned int i = 0; i < drawers_.size(); i++){
+		if(extract_source_->quality_.tolerance_ > 0.0f){
+			back[i].dropShorterThan(extract_source_->quality_.tolerance_);
+		}
+		if(profiler && i < profile_drawers_.size() && drawers_[i]->isVisible()){
+			profiler->record(profile_drawers_[i].candidates_, back[i].candidates_);
+			profiler->record(profile_drawers_[i].crossings_, back[i].crossings_);
+			profiler->record(profile_drawers_[i].segments_, back[i].vertices_.size() / 2);
+		}
+	}
+	progressive_ = false;
+	swapSegments();
+	return true;
+}
+
+/**
+ * Compute the per-vertex data every visible drawer needs for the vertex blocks a cluster uses, which haven't been
+ * computed yet in this progressive extraction: one kernel run per run of consecutive blocks.
+ *
+ * @param cluster: the cluster (of the level of detail the extraction is from)
+ */
+void Model::prepareBlocks(const FaceCluster &cluster){
+	unsigned int nv = extract_source_->mesh_->vertices.size();
+	const std::vector<unsigned int> &blocks = cluster.blocks_;
+	unsigned int i = 0;
+	while(i < blocks.size()){
+		if(blocks_ready_[blocks[i]]){
+			i++;
+			continue;
+		}
+		unsigned int j = i + 1;
+		while(j < blocks.size() && blocks[j] == blocks[j-1] + 1 && !blocks_ready_[blocks[j]]){
+			j++;
+		}
+		unsigned int begin = blocks[i] * VERTEX_BLOCK;
+		unsigned int end = std::min(nv, (blocks[j-1] + 1) * VERTEX_BLOCK);
+		for(unsigned int d = 0; d < drawers_.size(); d++){
+			if(drawers_[d]->isVisible()){
+				drawers_[d]->prepareVertices(extract_source_, extract_camera_, begin, end);
+			}
+		}
+		for(unsigned int k = i; k < j; k++){
+			blocks_ready_[blocks[k]] = true;
+		}
+		i = j;
+	}
+}
+
+void Model::endProgressive(){
+	progressive_ = false;
+}
+
+bool Model::isProgressive(){
+	return progressive_;
+}
+
+/**
+ * Submit the front segment buffers of every visible drawer in the draw stack to OpenGL. While a progressive extraction
+ * is in progress, submit what it extracted so far instead.
+ */
+void Model::submit(){
+	int shown = progressive_ ? 1-front_ : front_;
+	const SegmentSet &front = segments_[shown];
+	// static geometry gets drawn from the same level of detail the segments came from
+	Model* source = levelModel(segment_level_[shown]);
+	for(unsigned int i = 0; i<drawers_.size(); i++){
+		if(drawers_[i]->isVisible()){
+			// (this times the OpenGL calls, not the GPU work they queue)
+			ProfileTimer timer(i < profile_drawers_.size() ? profile_drawers_[i].submit_ : -1);
+			drawers_[i]->submit(source, front[i]);
+		}
+	}
+}
+
+/**
+ * Register this model's sections in the default profiler: the time to compute its per-vertex data, and for every drawer
+ * in its stack, the time to extract and submit its lines and its counters. Models registered under the same name share
+ * their sections (and their samples).
+ *
+ * @param name: what to call this model in the statistics
+ */
+void Model::profile(const std::string &name){
+	Profiler* profiler = Profiler::getDefault();
+	if(!profiler){
+		return;
+	}
+	profile_vertex_ = profiler->section(name + "/vertex data");
+	profile_drawers_.resize(drawers_.size());
+	for(unsigned int i = 0; i < drawers_.size(); i++){
+		std::string drawer = name + "/" + drawers_[i]->name();
+		profile_drawers_[i].extract_ = profiler->section(drawer + "/extract");
+		profile_drawers_[i].submit_ = profiler->section(drawer + "/submit");
+		profile_drawers_[i].candidates_ = profiler->section(drawer + "/candidate faces", true);
+		profile_drawers_[i].crossings_ = profiler->section(drawer + "/zero-crossing faces", true);
+		profile_drawers_[i].segments_ = profiler->section(drawer + "/segments", true);
+	}
+}
+
+int Model::levels(){
+	return levels_.size() + 1;
+}
+
+/**
+ * The model for a level of detail
+ */
+Model* Model::levelModel(int level){
+	return level == 0 ? this : levels_[level-1];
+}
+
+/**
+ * Pick the coarsest level of detail whose faces are still no larger than LOD_PIXELS_PER_FACE pixels on screen,
+ * assuming about half of them face the camera. Takes effect at the next extraction. Levels of detail don't follow edits
+ * (see MeshData::moveVertices), so edited meshes stay at full resolution.
+ *
+ * @param screen_radius: the radius of the model's bounding sphere, projected on screen, in pixels
+ */
+void Model::selectLevel(float screen_radius){
+	float pixels = 3.14159265f * screen_radius * screen_radius;
+	int level = 0;
+	for(int l = data_->isEdited() ? 0 : levels() - 1; l > 0; l--){
+		if(0.5f * levels_[l-1]->mesh_->faces.size() * LOD_PIXELS_PER_FACE >= pixels){
+			level = l;
+			break;
+		}
+	}
+	level_ = level;
+}
+
+int Model::submittedLevel(){
+	return segment_level_[front_];
+}
+
+/**
+ * Make the most recently extracted segments the ones that get submitted.
+ */
+void Model::swapSegments(){
+	front_ = 1-front_;
+}
+
+/**
+ * Take the transformation, level of detail and extraction quality of another instance of the same mesh data, so this
+ * one's extraction gives the lines the other one would get.
+ *
+ * @param other: the other instance
+ */
+void Model::mirror(const Model &other){
+	transform_ = other.transform_;
+	level_ = other.level_;
+	quality_ = other.quality_;
+}
+
+/**
+ * Swap the segments another instance of the same mesh data (with the same drawer stack) extracted last into the back
+ * segment buffers, and make them the front ones. The other instance gets our back buffers in return, so nothing gets
+ * copied or allocated.
+ *
+ * @param other: the other instance (its extraction has to be done)
+ */
+void Model::adoptSegments(Model &other){
+	segments_[1-front_].swap(other.segments_[1-other.front_]);
+	segment_level_[1-front_] = other.segment_level_[1-other.front_];
+	swapSegments();
+}
+
+/**
+ * Copy the front segments of every drawer out, with the level of detail they got extracted from
+ *
+ * @param segments: where to copy them to (resized to the drawer stack)
+ * @param level: where to put the level of detail
+ */
+void Model::copySegments(SegmentSet &segments, int &level) const{
+	const SegmentSet &front = segments_[front_];
+	segments.resize(front.size());
+	for(unsigned int i = 0; i < front.size(); i++){
+		segments[i] = front[i];
 	}
+	level = segment_level_[front_];
+}
+
+/**
+ * Copy segments copied out earlier (for the same drawer stack) into the back buffers, and make them the front ones.
+ * The back buffers have room for any set of segments (see reserveSegments), so this doesn't allocate.
+ *
+ * @param segments: the segments of every drawer
+ * @param level: the level of detail they got extracted from
+ */
+void Model::loadSegments(const SegmentSet &segments, int level){
+	SegmentSet &back = segments_[1-front_];
+	for(unsigned int i = 0; i < back.size() && i < segments.size(); i++){
+		back[i] = segments[i];
+	}
+	segment_level_[1-front_] = level;
+	swapSegments();
 }
 
 /**
@@ -48,7 +397,32 @@ void Model::draw(trimesh::vec camera_position){
  * @param: d : the drawer you want to push
  */
 void Model::pushDrawer(Drawer* d){
+	// make sure the mesh data has what this drawer needs
+	data_->require(d->requirements());
 	drawers_.push_back(d);
+	segments_[0].resize(drawers_.size());
+	segments_[1].resize(drawers_.size());
+	reserveSegments(drawers_.size()-1);
+}
+
+/**
+ * Reserve the worst-case amount of segment memory for a drawer in the drawer stack, so extraction never
+ * has to grow its buffers. Frame memory only gets backed by physical memory once it is written to.
+ * If there's not enough address space for that, buffers will grow on demand and keep their capacity.
+ *
+ * @param: drawer : the index of the drawer in the drawer stack
+ */
+void Model::reserveSegments(unsigned int drawer){
+	size_t n = mesh_->faces.size() * drawers_[drawer]->segmentVerticesPerFace();
+	for(int k = 0; k < 2; k++){
+		try{
+			segments_[k][drawer].vertices_.reserve(n);
+			segments_[k][drawer].colors_.reserve(n);
+		}
+		catch(std::bad_alloc&){
+			std::cout << "Could not reserve segment memory for " << n << " vertices, buffers will grow on demand" << std::endl;
+		}
+	}
 }
 
 /**
@@ -56,6 +430,17 @@ void Model::pushDrawer(Drawer* d){
  */
 void Model::popDrawer(){
 	drawers_.pop_back();
+	segments_[0].resize(drawers_.size());
+	segments_[1].resize(drawers_.size());
+}
+
+/**
+ * Remove all drawers from this model's drawing stack
+ */
+void Model::clearDrawers(){
+	drawers_.clear();
+	segments_[0].clear();
+	segments_[1].clear();
 }
 
 /**
@@ -63,8 +448,26 @@ void Model::popDrawer(){
  */
 void Model::needNdotV(trimesh::vec camera_position)
 {
-	if(ndotv_.empty()){
-		compute_ndotv(mesh_,camera_position,ndotv_);
+	if(!ndotv_valid_){
+		computeNdotV(camera_position, 0, mesh_->vertices.size());
+		ndotv_valid_ = true;
+	}
+}
+
+/**
+ * Compute NdotV for a range of vertices, given a camera position
+ *
+ * @param camera_position: the camera standpoint
+ * @param begin: the first vertex
+ * @param end: one past the last vertex
+ */
+void Model::computeNdotV(trimesh::vec camera_position, unsigned int begin, unsigned int end)
+{
+	if(data_->isCompact()){
+		compute_ndotv(mesh_,data_->quantized_,camera_position,ndotv_,begin,end,data_->kernel_config_);
+	}
+	else{
+		compute_ndotv(mesh_,camera_position,ndotv_,begin,end,data_->kernel_config_);
 	}
 }
 
@@ -77,58 +480,55 @@ void Model::needNdotV(trimesh::vec camera_position)
  */
 void Model::needCurvDerivatives(trimesh::vec camera_position, float sc_threshold)
 {
-	if(kr_.empty() || num_.empty() || den_.empty()){
-		compute_CurvDerivatives(mesh_,camera_position,kr_,num_,den_,sc_threshold);
+	if(!curv_derivatives_valid_){
+		computeCurvDerivatives(camera_position, sc_threshold, 0, mesh_->vertices.size());
+		curv_derivatives_valid_ = true;
+	}
+}
+
+/**
+ * Compute radial curvature and the numerator/denominator of the directional curvature derivative for a range of
+ * vertices, given a camera standpoint
+ *
+ * @param: camera_position : the camera standpoint
+ * @param: sc_threshold : a filtering threshold for small curvatures
+ * @param begin: the first vertex
+ * @param end: one past the last vertex
+ */
+void Model::computeCurvDerivatives(trimesh::vec camera_position, float sc_threshold, unsigned int begin, unsigned int end)
+{
+	if(data_->isCompact()){
+		compute_CurvDerivatives(mesh_,data_->quantized_,camera_position,kr_,num_,den_,sc_threshold,begin,end,data_->kernel_config_);
+	}
+	else{
+		compute_CurvDerivatives(mesh_,camera_position,kr_,num_,den_,sc_threshold,begin,end,data_->kernel_config_);
 	}
 }
 
 /**
- * Compute the view independent data for this model.
+ * Reserve memory chunks for per-vertex view-dependent info: these keep their size for the lifetime of the model
  */
-void Model::computeViewIndependentData(){
-	// reserve memory chunks for per-vertex info
+void Model::allocateViewDependentData(){
 	int n = mesh_->vertices.size();
 	ndotv_.resize(n);
 	kr_.resize(n);
 	num_.resize(n);
 	den_.resize(n);
-	// The other view-indipendent data, we have to compute ourselves
-	std::cout<<"Computing face normals... ";
-	computeFaceNormals(mesh_,facenormals_);
-	std::cout<< "Done" << std::endl << "Computing feature size... ";
-	feature_size_ = computeFeatureSize(mesh_);
-	std::cout<< "Done" << std::endl;
+	// first touch (the buffers aren't backed by memory yet): the threads which will process a range of vertices
+	// get its pages on their NUMA node
+	numa_place(ndotv_);
+	numa_place(kr_);
+	numa_place(num_);
+	numa_place(den_);
+	parallel_for(0, n, data_->kernel_config_.chunk_, [&](int i){
+		ndotv_[i] = kr_[i] = num_[i] = den_[i] = 0.0f;
+	});
 }
 
 /**
- * Clear the buffers containing the view dependent data
+ * Invalidate the buffers containing the view dependent data (they keep their memory for the next frame)
  */
 void Model::clearViewDependentData(){
-	ndotv_.clear();
-	kr_.clear();
-	num_.clear();
-	den_.clear();
-}
-
-/**
- * Transfer vertex/normal info into GPU memory as STATIC_DRAW data in Vertex Buffer Objects (VBO's).
- */
-void Model::setupVBOs(){
-	int bufferSize;
-	// load vertex positions into VBO buffer
-	glGenBuffersARB(1, &vbo_positions_);
-	glBindBufferARB(GL_ARRAY_BUFFER_ARB, vbo_positions_);
-	// static draw data, we're not going to change vertex information
-	glBufferDataARB(GL_ARRAY_BUFFER_ARB, mesh_->vertices.size()*sizeof(float)*3, &(mesh_->vertices[0]), GL_STATIC_DRAW_ARB);
-	glGetBufferParameterivARB(GL_ARRAY_BUFFER_ARB, GL_BUFFER_SIZE_ARB, &bufferSize);
-	std::cout << "Vertex array loaded in VBO: " << bufferSize << " bytes\n" << std::endl;
-	// do the same for normals
-	glGenBuffersARB(1, &vbo_normals_);
-	glBindBufferARB(GL_ARRAY_BUFFER_ARB, vbo_normals_);
-	// static draw data, we're not going to change vertex information
-	glBufferDataARB(GL_ARRAY_BUFFER_ARB, mesh_->normals.size()*sizeof(float)*3, &(mesh_->normals[0]), GL_STATIC_DRAW_ARB);
-	glGetBufferParameterivARB(GL_ARRAY_BUFFER_ARB, GL_BUFFER_SIZE_ARB, &bufferSize);
-	std::cout << "Normal array loaded in VBO: " << bufferSize << " bytes\n" << std::endl;
-	// unbind buffers to prevent fudging up pointer arithmetic
-	glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+	ndotv_valid_ = false;
+	curv_derivatives_valid_ = false;
 }
@@ -1,14 +1,19 @@
 /*
  * model.h
  *
- * A class representing a worldspace model
+ * A class representing a worldspace model: an instance of (shared) MeshData, placed in the scene by a transformation
  *
  *      Author: Jeroen Baert
  */
 
 #include <TriMesh.h>
+#include <XForm.h>
+#include "timestamp.h"
 #include "Drawer.h"
+#include "SegmentBuffer.h"
+#include "MeshData.h"
 #include <vector>
+#include <string>
 #include <GL/glew.h>
 #include <GL/gl.h>
 #include <GL/glut.h>
@@ -19,46 +24,141 @@
 
 class Drawer;
 
+// target projected size of a face when picking a level of detail, in pixels
+#define LOD_PIXELS_PER_FACE 2.0f
+
+// the profiler sections of a drawer in a model's drawer stack: its extraction and submission times, and the faces it
+// tested, the faces with a zero crossing and the segments it emitted per extraction
+struct DrawerSections{
+	int extract_;
+	int submit_;
+	int candidates_;
+	int crossings_;
+	int segments_;
+};
+
+// how much of a model its drawers look at, and what they keep: set per frame (see QualityGovernor)
+struct ExtractionQuality{
+	int stride_; // test one in every stride_ faces...
+	int offset_; // ...starting at this one (changed every frame, so every face gets its turn)
+	float tolerance_; // drop segments shorter than this, in object space
+
+	ExtractionQuality(): stride_(1), offset_(0), tolerance_(0.0f){}
+	// the first face tested in a range of faces starting at begin
+	unsigned int first(unsigned int begin) const{
+		return begin + (offset_ + stride_ - begin % stride_) % stride_;
+	}
+	// the number of faces tested in a range of faces
+	unsigned int candidates(unsigned int begin, unsigned int end) const{
+		unsigned int f = first(begin);
+		return f < end ? (end - f + stride_ - 1) / stride_ : 0;
+	}
+};
+
+// a step of a progressive extraction: one drawer on one cluster of faces (see Model::beginProgressive)
+struct WorkItem{
+	float key_; // lower goes first
+	unsigned int drawer_;
+	unsigned int cluster_;
+};
+
 class Model
 {
 /**
- * Definition of the Model class, representing a loaded mesh and its view-independent and view-dependent data.
+ * Definition of the Model class, an instance of a mesh: shared view-independent data, plus its own transformation,
+ * drawer stack and view-dependent data.
  *
  * Author: Jeroen Baert
  */
 
 private:
+	// instances of this model's levels of detail (they only hold view-dependent data)
+	std::vector<Model*> levels_;
+	// the level of detail to extract from next (0 is this model itself)
+	int level_;
+	// the level of detail every segment set got extracted from
+	int segment_level_[2];
+	// the extraction in progress: its level of detail, and the camera position in object space
+	Model* extract_source_;
+	trimesh::vec extract_camera_;
+
+	// the progressive extraction in progress: its work, in order, how far it got, and the vertex blocks (see
+	// VERTEX_BLOCK) of the level it extracts from whose view-dependent data it computed so far
+	std::vector<WorkItem> work_;
+	size_t next_work_;
+	bool progressive_;
+	std::vector<bool> blocks_ready_;
+
+	// where this model's timings and counters go in the default profiler (-1 and none: not profiled)
+	int profile_vertex_;
+	std::vector<DrawerSections> profile_drawers_;
+
+	Model* levelModel(int level);
+
 	// some private helper functions
-	void computeViewIndependentData();
+	void allocateViewDependentData();
 	void clearViewDependentData();
-	void setupVBOs();
+	void reserveSegments(unsigned int drawer);
+	void prepareBlocks(const FaceCluster &cluster);
 
 public:
 
-	// the mesh_ representing this model
+	// the shared view-independent data
+	MeshData* data_;
+	// the mesh_ representing this model (the shared data's mesh)
 	const trimesh::TriMesh* mesh_;
+	// object to world transformation
+	trimesh::xform transform_;
 	// the drawer stack
 	std::vector<Drawer*> drawers_;
+	// extracted segments for every drawer in the stack, double-buffered:
+	// extraction fills the back set while the front set can still be submitted
+	SegmentSet segments_[2];
+	int front_;
 
-	// vertex buffer objects for GPU storage
-	GLuint vbo_positions_;
-	GLuint vbo_normals_;
+	// the quality of the next extraction (drawers read the one of the level of detail they extract from)
+	ExtractionQuality quality_;
 
-	// VIEW INDEPENDENT VALUES
-	std::vector<trimesh::vec> facenormals_;
-	float feature_size_;
+	// VIEW_DEPENDENT VALUES (sized once, valid flags get reset every frame)
+	FrameVector<float> ndotv_; // ndotv_
+	FrameVector<float> kr_; // radial curvature
+	FrameVector<float> num_; // second derivative of radial curv
+	FrameVector<float> den_; // second derivative of radial curv
+	bool ndotv_valid_;
+	bool curv_derivatives_valid_;
 
-	// VIEW_DEPENDENT VALUES
-	std::vector<float> ndotv_; // ndotv_
-	std::vector<float> kr_; // radial curvature
-	std::vector<float> num_; // second derivative of radial curv
-	std::vector<float> den_; // second derivative of radial curv
+	// constructor: a new instance of some mesh data
+	Model(MeshData* data);
+	~Model();
 
-	// constructor
-	Model(const char* filename);
-
-	// draw the model
+	// draw the model (extract, swap and submit in one go)
 	void draw(trimesh::vec camera_position);
+	// run the drawer stack's extraction into the back segment buffers (no OpenGL calls)
+	void extract(trimesh::vec camera_position);
+	// the same extraction in steps, for the frame scheduler: begin, compute the per-vertex data of the drawers, then
+	// extract every drawer (in any order, or concurrently)
+	void beginExtract(trimesh::vec camera_position);
+	void extractVertexData();
+	void extractDrawer(unsigned int drawer);
+	// the same extraction spread over frames: begin, then extract within a time budget, the clusters most likely to
+	// show lines first (computing the per-vertex data they use on the way), as often as it takes (returns true when it
+	// completed, and swapped)
+	void beginProgressive(trimesh::vec camera_position, trimesh::vec view_direction);
+	bool continueProgressive(const trimesh::timestamp &start, float budget);
+	// drop a progressive extraction in progress (its lines stop showing)
+	void endProgressive();
+	bool isProgressive();
+	// submit the front segment buffers to OpenGL (the back ones, while a progressive extraction is in progress)
+	void submit();
+	// swap front and back segment buffers
+	void swapSegments();
+	// take the placement, level of detail and quality of another instance of the same mesh data (to extract for it)
+	void mirror(const Model &other);
+	// make the segments another instance of the same mesh data extracted last the front ones (it gets our back ones)
+	void adoptSegments(Model &other);
+	// copy the front segments (and the level of detail they came from) out, or in as the front ones (see LineCache)
+	void copySegments(SegmentSet &segments, int &level) const;
+	void loadSegments(const SegmentSet &segments, int level);
 	// pop a drawer from the drawer stack
 	void popDrawer();
 	// push a drawer into the drawer stack
@@ -66,11 +166,24 @@ public:
 	// clear all drawers_ from the drawer stack
 	void clearDrawers();
 
-	// compute ndotv_ for all vertices in this model, given a camera position
+	// record this model's timings and counters in the default profiler, under a name (call after pushing its drawers)
+	void profile(const std::string &name);
+
+	// number of levels of detail (including the full resolution model)
+	int levels();
+	// pick the level of detail to extract from, given the model's projected radius in pixels
+	void selectLevel(float screen_radius);
+	// the level of detail the segments on screen come from
+	int submittedLevel();
+
+	// compute ndotv_ for all vertices in this model, given a camera position (in object space)
 	void needNdotV(trimesh::vec camera_position);
-	// compute all curvature derivatives in this model, given a camera position
+	// compute all curvature derivatives in this model, given a camera position (in object space)
 	// and a threshold for small derivatives
 	void needCurvDerivatives(trimesh::vec camera_position, float sc_threshold);
+	// the same for a range of vertices (begin ... end-1), whatever has been computed before
+	void computeNdotV(trimesh::vec camera_position, unsigned int begin, unsigned int end);
+	void computeCurvDerivatives(trimesh::vec camera_position, float sc_threshold, unsigned int begin, unsigned int end);
 };
 
 #endif /* MODEL_H_ */
@@ -0,0 +1,187 @@
+/*
+ * Implementation of a Profiler, which keeps rolling statistics of the stages of every frame.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "Profiler.h"
+#include <algorithm>
+#include <cstdio>
+
+Profiler* Profiler::default_ = 0;
+
+Profiler::Section::Section(const std::string &name, bool counter): name_(name), counter_(counter), samples_(PROFILER_WINDOW), recorded_(0){
+}
+
+/**
+ * Constructor: a profiler with a section for the frame time
+ */
+Profiler::Profiler(): scratch_(PROFILER_WINDOW), fps_frames_(0), fps_(0), frames_(0){
+	frame_section_ = section("frame");
+	frame_start_ = fps_start_ = trimesh::now();
+}
+
+Profiler::~Profiler(){
+	for(unsigned int i = 0; i < sections_.size(); i++){
+		delete sections_[i];
+	}
+}
+
+/**
+ * Find the section with a given name, or register it. Registering allocates memory, so do it up front (when building
+ * models, for instance), not while other threads record.
+ *
+ * @param name: the name of the section
+ * @param counter: whether the section counts things (true) or times them (false), if it has to be registered
+ * @return the section, to record to
+ */
+int Profiler::section(const std::string &name, bool counter){
+	std::map<std::string, int>::iterator it = names_.find(name);
+	if(it != names_.end()){
+		return it->second;
+	}
+	int s = sections_.size();
+	sections_.push_back(new Section(name, counter));
+	names_[name] = s;
+	return s;
+}
+
+int Profiler::sections() const{
+	return sections_.size();
+}
+
+const std::string& Profiler::name(int section) const{
+	return sections_[section]->name_;
+}
+
+bool Profiler::isCounter(int section) const{
+	return sections_[section]->counter_;
+}
+
+/**
+ * Record a sample in a section: it replaces the oldest one in the section's window. Doesn't lock or allocate.
+ *
+ * @param section: the section
+ * @param value: the sample, a time in milliseconds or a count
+ */
+void Profiler::record(int section, float value){
+	Section* s = sections_[section];
+	unsigned int slot = s->recorded_.fetch_add(1, std::memory_order_relaxed) % PROFILER_WINDOW;
+	s->samples_[slot].store(value, std::memory_order_relaxed);
+}
+
+/**
+ * Compute the statistics of a section over the samples in its window (nearest-rank percentiles).
+ * Doesn't allocate, but uses a scratch buffer of the profiler, so only one thread should ask for statistics.
+ *
+ * @param section: the section
+ */
+ProfileStats Profiler::stats(int section){
+	Section* s = sections_[section];
+	ProfileStats stats;
+	stats.samples_ = std::min(s->recorded_.load(std::memory_order_relaxed), (unsigned int) PROFILER_WINDOW);
+	stats.mean_ = stats.p50_ = stats.p95_ = stats.p99_ = stats.max_ = 0.0f;
+	if(stats.samples_ == 0){
+		return stats;
+	}
+	double sum = 0.0;
+	for(int i = 0; i < stats.samples_; i++){
+		scratch_[i] = s->samples_[i].load(std::memory_order_relaxed);
+		sum += scratch_[i];
+	}
+	std::sort(scratch_.begin(), scratch_.begin() + stats.samples_);
+	stats.mean_ = float(sum / stats.samples_);
+	stats.p50_ = scratch_[(stats.samples_ - 1) * 50 / 100];
+	stats.p95_ = scratch_[(stats.samples_ - 1) * 95 / 100];
+	stats.p99_ = scratch_[(stats.samples_ - 1) * 99 / 100];
+	stats.max_ = scratch_[stats.samples_ - 1];
+	return stats;
+}
+
+/**
+ * End a frame: record the time since the end of the previous one, and update the frame rate once per second
+ */
+void Profiler::endFrame(){
+	trimesh::timestamp now = trimesh::now();
+	record(frame_section_, 1000.0f * (now - frame_start_));
+	frame_start_ = now;
+	frames_++;
+	fps_frames_++;
+	float elapsed = now - fps_start_;
+	if(elapsed >= 1.0f){
+		fps_ = int(fps_frames_ / elapsed + 0.5f);
+		fps_frames_ = 0;
+		fps_start_ = now;
+	}
+}
+
+int Profiler::fps() const{
+	return fps_;
+}
+
+int Profiler::frames() const{
+	return frames_;
+}
+
+/**
+ * Write the statistics of every section to a CSV file: a line per section, times in milliseconds.
+ *
+ * @param filename: the file to write
+ * @return false if it couldn't be written
+ */
+bool Profiler::writeCSV(const char* filename){
+	FILE* f = fopen(filename, "w");
+	if(!f){
+		return false;
+	}
+	fprintf(f, "section,unit,samples,mean,p50,p95,p99,max\n");
+	for(int i = 0; i < sections(); i++){
+		ProfileStats s = stats(i);
+		// (quote names: they hold file names)
+		fputc('"', f);
+		for(const char* c = sections_[i]->name_.c_str(); *c; c++){
+			if(*c == '"'){
+				fputc('"', f);
+			}
+			fputc(*c, f);
+		}
+		fprintf(f, "\",%s,%d,%g,%g,%g,%g,%g\n", sections_[i]->counter_ ? "count" : "ms", s.samples_, s.mean_, s.p50_, s.p95_, s.p99_, s.max_);
+	}
+	return fclose(f) == 0;
+}
+
+/**
+ * Write the statistics of every section to a JSON file: the number of frames, and an array of sections.
+ *
+ * @param filename: the file to write
+ * @return false if it couldn't be written
+ */
+bool Profiler::writeJSON(const char* filename){
+	FILE* f = fopen(filename, "w");
+	if(!f){
+		return false;
+	}
+	fprintf(f, "{\n  \"frames\": %d,\n  \"window\": %d,\n  \"sections\": [", frames_, PROFILER_WINDOW);
+	for(int i = 0; i < sections(); i++){
+		ProfileStats s = stats(i);
+		fprintf(f, "%s\n    {\"name\": \"", i ? "," : "");
+		for(const char* c = sections_[i]->name_.c_str(); *c; c++){
+			if(*c == '"' || *c == '\\'){
+				fputc('\\', f);
+			}
+			fputc(*c, f);
+		}
+		fprintf(f, "\", \"unit\": \"%s\", \"samples\": %d, \"mean\": %g, \"p50\": %g, \"p95\": %g, \"p99\": %g, \"max\": %g}",
+				sections_[i]->counter_ ? "count" : "ms", s.samples_, s.mean_, s.p50_, s.p95_, s.p99_, s.max_);
+	}
+	fprintf(f, "\n  ]\n}\n");
+	return fclose(f) == 0;
+}
+
+void Profiler::setDefault(Profiler* profiler){
+	default_ = profiler;
+}
+
+Profiler* Profiler::getDefault(){
+	return default_;
+}
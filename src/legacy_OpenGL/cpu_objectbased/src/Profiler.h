@@ -0,0 +1,123 @@
+/*
+ * Definition of a Profiler, which keeps rolling statistics of the stages of every frame.
+ *
+ * A profiler has named sections: timers (in milliseconds) or counters (numbers of faces, segments, ...). Every section
+ * keeps its last PROFILER_WINDOW samples in a ring, from which its mean, percentiles (p50, p95, p99) and maximum get
+ * computed on demand. Sections get registered up front, by name (registering a name twice gives the same section), so
+ * recording a sample is no more than claiming a slot in the ring: any thread can record, concurrently, without
+ * locking or allocating memory.
+ *
+ * Stages get timed with a ProfileTimer, which records the time between its construction and destruction (and an event
+ * under the section's name, when a trace is running: see Tracer). Models register sections for their vertex data, and
+ * for the extraction, submission and counters of every drawer in their stack (see Model::profile). The profiler also
+ * counts frames, for the frame rate.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include "timestamp.h"
+#include "Tracer.h"
+#include <vector>
+#include <string>
+#include <map>
+#include <atomic>
+
+// number of samples every section keeps
+#define PROFILER_WINDOW 256
+
+// statistics of a section over its window of samples
+struct ProfileStats{
+	int samples_;
+	float mean_;
+	float p50_;
+	float p95_;
+	float p99_;
+	float max_;
+};
+
+class Profiler{
+private:
+	struct Section{
+		std::string name_;
+		bool counter_; // counts things, instead of timing them
+		std::vector< std::atomic<float> > samples_;
+		std::atomic<unsigned int> recorded_; // number of samples recorded so far (the next one goes in slot recorded_ % window)
+		Section(const std::string &name, bool counter);
+	};
+
+	std::vector<Section*> sections_;
+	std::map<std::string, int> names_;
+	// the samples of a section, sorted to find its percentiles
+	std::vector<float> scratch_;
+	// frame counting
+	int frame_section_;
+	trimesh::timestamp frame_start_;
+	trimesh::timestamp fps_start_;
+	int fps_frames_;
+	int fps_;
+	int frames_;
+
+	// the profiler ProfileTimers record to
+	static Profiler* default_;
+
+	// no copies: sections are shared by reference
+	Profiler(const Profiler&);
+	Profiler& operator=(const Profiler&);
+
+public:
+	Profiler();
+	~Profiler();
+	// the section with this name: registers it if it doesn't exist yet (call before recording to it)
+	int section(const std::string &name, bool counter = false);
+	// number of sections, and their name and kind
+	int sections() const;
+	const std::string& name(int section) const;
+	bool isCounter(int section) const;
+	// record a sample: a time in milliseconds, or a count (from any thread)
+	void record(int section, float value);
+	// statistics of a section over its last samples (not thread-safe: call from one thread)
+	ProfileStats stats(int section);
+	// end a frame: record its time, and update the frame rate
+	void endFrame();
+	// frames per second (over the last second), and frames so far
+	int fps() const;
+	int frames() const;
+	// write the statistics of every section to a file
+	bool writeCSV(const char* filename);
+	bool writeJSON(const char* filename);
+
+	// the profiler ProfileTimers record to (none: they don't record)
+	static void setDefault(Profiler* profiler);
+	static Profiler* getDefault();
+};
+
+/**
+ * A scoped timer: records the time from its construction to its destruction in a section of the default profiler,
+ * and in the trace, if one is running. Does nothing for section -1, or without a default profiler.
+ */
+class ProfileTimer{
+private:
+	int section_;
+	long long start_;
+public:
+	ProfileTimer(int section): section_(Profiler::getDefault() ? section : -1){
+		if(section_ >= 0){
+			start_ = Tracer::now();
+		}
+	}
+	~ProfileTimer(){
+		if(section_ >= 0){
+			long long end = Tracer::now();
+			Profiler* profiler = Profiler::getDefault();
+			profiler->record(section_, 1e-6f * (end - start_));
+			if(Tracer::enabled()){
+				Tracer::record(profiler->name(section_).c_str(), start_, end);
+			}
+		}
+	}
+};
+
+#endif /* PROFILER_H_ */
@@ -0,0 +1,105 @@
+/*
+ * Implementation of a QualityGovernor, which trades line quality for frame time while the user interacts.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "QualityGovernor.h"
+
+// the quality ladder, from full quality down: the cheap-looking knobs (coarser levels of detail, dropping tiny
+// segments) go first, suggestive contours and then complete faces only when those weren't enough
+static const Quality ladder[] = {
+	// lod scale, tolerance, suggestive, stride
+	{ 1.0f,   0.0f, true,  1 },
+	{ 0.5f,   0.0f, true,  1 },
+	{ 0.5f,   1.0f, true,  1 },
+	{ 0.25f,  1.0f, true,  1 },
+	{ 0.25f,  2.0f, true,  1 },
+	{ 0.125f, 2.0f, true,  1 },
+	{ 0.125f, 2.0f, false, 1 },
+	{ 0.125f, 2.0f, false, 2 },
+	{ 0.125f, 3.0f, false, 4 },
+};
+
+/**
+ * Constructor
+ *
+ * @param budget: the frame time to hold, in milliseconds
+ */
+QualityGovernor::QualityGovernor(float budget): budget_(budget), average_(0.0f), level_(0), over_(0), under_(0), measured_(false), lod_(true){
+}
+
+/**
+ * Does a level get skipped: without levels of detail, one which only changes the lod scale of the level above it
+ */
+bool QualityGovernor::skipped(int level) const{
+	return !lod_ && level > 0 && ladder[level].tolerance_ == ladder[level-1].tolerance_
+			&& ladder[level].suggestive_ == ladder[level-1].suggestive_ && ladder[level].stride_ == ladder[level-1].stride_;
+}
+
+/**
+ * Take a frame time into account: step down a level when the running average has been over the budget for
+ * GOVERNOR_DOWN_FRAMES frames, up a level when it has been under GOVERNOR_HEADROOM of the budget for GOVERNOR_UP_FRAMES.
+ * Changes take a frame or two to show in the frame times, so the counts start over after every step. Steps go past the
+ * levels which get skipped (see useLevelsOfDetail).
+ *
+ * @param frame_time: the time of the last frame, in milliseconds
+ * @return whether the level changed
+ */
+bool QualityGovernor::update(float frame_time){
+	average_ = measured_ ? (1.0f - GOVERNOR_SMOOTHING) * average_ + GOVERNOR_SMOOTHING * frame_time : frame_time;
+	measured_ = true;
+	over_ = average_ > budget_ ? over_ + 1 : 0;
+	under_ = average_ < GOVERNOR_HEADROOM * budget_ ? under_ + 1 : 0;
+	int level = level_;
+	if(over_ >= GOVERNOR_DOWN_FRAMES && level_ < levels() - 1){
+		do{
+			level_++;
+		} while(skipped(level_) && level_ < levels() - 1);
+	}
+	else if(under_ >= GOVERNOR_UP_FRAMES && level_ > 0){
+		do{
+			level_--;
+		} while(skipped(level_));
+	}
+	if(level == level_){
+		return false;
+	}
+	over_ = under_ = 0;
+	return true;
+}
+
+/**
+ * Tell whether levels of detail get picked from screen size. Without them, the lod scale does nothing, and the levels
+ * which only change it would cost GOVERNOR_DOWN_FRAMES over the budget each for no gain.
+ *
+ * @param lod: do models have levels of detail, and do they get picked?
+ */
+void QualityGovernor::useLevelsOfDetail(bool lod){
+	lod_ = lod;
+}
+
+/**
+ * Go back to full quality, and forget the measured frame times
+ */
+void QualityGovernor::restore(){
+	level_ = 0;
+	over_ = under_ = 0;
+	measured_ = false;
+}
+
+int QualityGovernor::level() const{
+	return level_;
+}
+
+int QualityGovernor::levels() const{
+	return sizeof(ladder) / sizeof(ladder[0]);
+}
+
+const Quality& QualityGovernor::quality() const{
+	return ladder[level_];
+}
+
+float QualityGovernor::budget() const{
+	return budget_;
+}
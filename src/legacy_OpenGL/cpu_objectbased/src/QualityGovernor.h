@@ -0,0 +1,65 @@
+/*
+ * Definition of a QualityGovernor, which trades line quality for frame time while the user interacts.
+ *
+ * The governor walks a ladder of quality settings, from full quality (level 0) to the cheapest one. Every setting
+ * turns a few knobs: the screen size levels of detail get picked for (so coarser levels get used), segments shorter
+ * than a tolerance in pixels (which only clutter the image), suggestive contours, and the fraction of faces every
+ * extraction tests (a different subset every frame, so every face gets its turn).
+ *
+ * It watches the measured frame times: when their running average stays over the budget for a few frames, it steps
+ * down a level; when it stays well under the budget for a while, it steps back up. The thresholds are apart, so it
+ * doesn't oscillate between two levels. Once the user stops interacting, the viewer restores full quality.
+ * Without levels of detail to pick from, the levels which only scale the screen size do nothing, so the governor
+ * skips them.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef QUALITYGOVERNOR_H_
+#define QUALITYGOVERNOR_H_
+
+// frames over the budget before stepping down, and frames under the headroom before stepping up
+#define GOVERNOR_DOWN_FRAMES 3
+#define GOVERNOR_UP_FRAMES 30
+// fraction of the budget the average frame time has to stay under to step up
+#define GOVERNOR_HEADROOM 0.6f
+// weight of the last frame in the running average
+#define GOVERNOR_SMOOTHING 0.3f
+
+// a setting of the quality knobs
+struct Quality{
+	float lod_scale_; // multiplies the screen size levels of detail get picked for (1: full size)
+	float tolerance_; // segments shorter than this (in pixels) get dropped
+	bool suggestive_; // extract suggestive contours
+	int stride_; // extraction tests one in every stride_ faces
+};
+
+class QualityGovernor{
+private:
+	float budget_; // milliseconds
+	float average_;
+	int level_;
+	int over_; // frames in a row over the budget
+	int under_; // frames in a row under the headroom
+	bool measured_; // has average_ been initialized?
+	bool lod_; // do levels of detail get picked (so the lod scale does something)?
+	bool skipped(int level) const;
+
+public:
+	// constructor: a governor at full quality, holding a frame time budget in milliseconds
+	QualityGovernor(float budget);
+	// take the time of a frame rendered while the user interacts into account, returns whether the level changed
+	bool update(float frame_time);
+	// tell whether levels of detail get picked from screen size (if not, the levels which only scale it get skipped)
+	void useLevelsOfDetail(bool lod);
+	// go back to full quality (when the user stops interacting)
+	void restore();
+	// the current level (0: full quality), and the number of levels
+	int level() const;
+	int levels() const;
+	// the knob settings of the current level
+	const Quality& quality() const;
+	float budget() const;
+};
+
+#endif /* QUALITYGOVERNOR_H_ */
@@ -0,0 +1,62 @@
+/*
+ * Definition of a SegmentBuffer, which holds the line segments a Drawer extracted for a single model.
+ * Segments are stored in object space as pairs of vertices, with optional per-vertex colors.
+ *
+ * Extraction (CPU) fills a SegmentBuffer, submission (OpenGL) only reads it, so both can run on different threads
+ * as long as they work on different buffers.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef SEGMENTBUFFER_H_
+#define SEGMENTBUFFER_H_
+
+#include <TriMesh.h>
+#include <vector>
+#include "frame_memory.h"
+
+struct SegmentBuffer
+{
+	FrameVector<trimesh::vec> vertices_;
+	FrameVector<trimesh::vec4> colors_;
+	// what the extraction looked at (for the profiler): the faces it tested, and those with a zero crossing
+	unsigned int candidates_;
+	unsigned int crossings_;
+
+	SegmentBuffer(): candidates_(0), crossings_(0){}
+	// clear the buffer (keeps the allocated memory around for the next frame)
+	void clear(){
+		vertices_.clear();
+		colors_.clear();
+		candidates_ = crossings_ = 0;
+	}
+	bool empty() const{
+		return vertices_.empty();
+	}
+	// drop the segments shorter than a length (in place, keeps the allocated memory)
+	void dropShorterThan(float length){
+		float length2 = length * length;
+		bool colored = !colors_.empty();
+		size_t kept = 0;
+		for(size_t s = 0; s + 1 < vertices_.size(); s += 2){
+			if(trimesh::dist2(vertices_[s], vertices_[s+1]) >= length2){
+				vertices_[kept] = vertices_[s];
+				vertices_[kept+1] = vertices_[s+1];
+				if(colored){
+					colors_[kept] = colors_[s];
+					colors_[kept+1] = colors_[s+1];
+				}
+				kept += 2;
+			}
+		}
+		vertices_.resize(kept);
+		if(colored){
+			colors_.resize(kept);
+		}
+	}
+};
+
+// a set of segment buffers: one for every drawer in a model's drawer stack
+typedef std::vector<SegmentBuffer> SegmentSet;
+
+#endif /* SEGMENTBUFFER_H_ */
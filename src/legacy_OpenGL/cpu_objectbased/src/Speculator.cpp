@@ -0,0 +1,166 @@
+/*
+ * Implementation of a Speculator, which extracts the lines of upcoming frames ahead of time, while the camera follows a
+ * path known in advance (autospin).
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "Speculator.h"
+
+Speculator::Slot::Slot(ThreadPool* pool): scheduler_(new FrameScheduler(pool)), quality_(0){
+}
+
+Speculator::Slot::~Slot(){
+	delete scheduler_;
+	for(unsigned int i = 0; i < models_.size(); i++){
+		delete models_[i];
+	}
+}
+
+/**
+ * Constructor: a speculator without models
+ *
+ * @param pool: the thread pool to extract on
+ * @param frames: the number of frames to predict ahead
+ */
+Speculator::Speculator(ThreadPool* pool, int frames): first_(0), count_(0), hits_(0), misses_(0){
+	for(int i = 0; i < frames; i++){
+		slots_.push_back(new Slot(pool));
+	}
+}
+
+Speculator::~Speculator(){
+	wait();
+	for(unsigned int i = 0; i < slots_.size(); i++){
+		delete slots_[i];
+	}
+}
+
+/**
+ * Give every slot an instance of every model, with the same drawer stack, and build its task graph. This allocates
+ * the view-dependent data and segment buffers of every instance, so call it when a spin starts, not every frame.
+ *
+ * @param models: the scene's models
+ */
+void Speculator::build(const std::vector<Model*> &models){
+	release();
+	for(unsigned int s = 0; s < slots_.size(); s++){
+		Slot* slot = slots_[s];
+		for(unsigned int i = 0; i < models.size(); i++){
+			Model* m = new Model(models[i]->data_);
+			for(unsigned int j = 0; j < models[i]->drawers_.size(); j++){
+				m->pushDrawer(models[i]->drawers_[j]);
+			}
+			slot->models_.push_back(m);
+		}
+		slot->scheduler_->build(slot->models_);
+	}
+}
+
+/**
+ * Wait for the extractions of every slot, forget all predictions, and delete the slots' instances with their
+ * view-dependent data and segment buffers. Predictions need a build again.
+ */
+void Speculator::release(){
+	wait();
+	discard();
+	for(unsigned int s = 0; s < slots_.size(); s++){
+		Slot* slot = slots_[s];
+		for(unsigned int i = 0; i < slot->models_.size(); i++){
+			delete slot->models_[i];
+		}
+		slot->models_.clear();
+		slot->scheduler_->build(slot->models_);
+	}
+}
+
+bool Speculator::built() const{
+	return !slots_.empty() && !slots_[0]->models_.empty();
+}
+
+/**
+ * Take the next predicted frame, if it's the one coming up: the camera position and quality level have to match. Its
+ * lines become the models' front segments (they get swapped in: the slot gets the models' back segments in return).
+ * Otherwise, every prediction gets discarded.
+ *
+ * @param transform: the global transformation of the frame coming up
+ * @param quality: the quality level it should be extracted at
+ * @param models: the scene's models (the ones the slots got built for)
+ * @return true if the frame was predicted: the models' lines are ready
+ */
+bool Speculator::take(const trimesh::xform &transform, int quality, std::vector<Model*> &models){
+	if(count_ == 0){
+		return false;
+	}
+	Slot* slot = slots_[first_];
+	// (the lines only depend on where the camera is, not on where it looks)
+	trimesh::vec camera = inv(transform) * trimesh::point(0,0,0);
+	if(slot->quality_ != quality || inv(slot->transform_) * trimesh::point(0,0,0) != camera || slot->models_.size() != models.size()){
+		discard();
+		misses_++;
+		return false;
+	}
+	slot->scheduler_->wait();
+	for(unsigned int i = 0; i < models.size(); i++){
+		models[i]->adoptSegments(*slot->models_[i]);
+	}
+	first_ = (first_ + 1) % slots_.size();
+	count_--;
+	hits_++;
+	return true;
+}
+
+/**
+ * Fill every free slot with a prediction: the frame after the last prediction (or after the given frame, if there
+ * are none), one step further, extracted with the models' current levels of detail and quality.
+ *
+ * @param transform: the global transformation of the current frame
+ * @param step: the transformation every frame applies to the previous one
+ * @param quality: the quality level the models are set up for
+ * @param models: the scene's models
+ */
+void Speculator::predict(const trimesh::xform &transform, const trimesh::xform &step, int quality, const std::vector<Model*> &models){
+	int n = slots_.size();
+	trimesh::xform last = count_ ? slots_[(first_ + count_ - 1) % n]->transform_ : transform;
+	while(count_ < n){
+		Slot* slot = slots_[(first_ + count_) % n];
+		if(slot->models_.size() != models.size()){
+			return; // not built for these models
+		}
+		// (a discarded extraction may still be running)
+		slot->scheduler_->wait();
+		last = step * last;
+		slot->transform_ = last;
+		slot->quality_ = quality;
+		for(unsigned int i = 0; i < models.size(); i++){
+			slot->models_[i]->mirror(*models[i]);
+		}
+		slot->scheduler_->launch(inv(last) * trimesh::point(0,0,0));
+		count_++;
+	}
+}
+
+/**
+ * Forget all predictions. Their extractions may go on: slots get waited for before they get reused.
+ */
+void Speculator::discard(){
+	count_ = 0;
+}
+
+void Speculator::wait(){
+	for(unsigned int i = 0; i < slots_.size(); i++){
+		slots_[i]->scheduler_->wait();
+	}
+}
+
+int Speculator::predictions() const{
+	return count_;
+}
+
+int Speculator::hits() const{
+	return hits_;
+}
+
+int Speculator::misses() const{
+	return misses_;
+}
@@ -0,0 +1,74 @@
+/*
+ * Definition of a Speculator, which extracts the lines of upcoming frames ahead of time, while the camera follows a
+ * path known in advance (autospin).
+ *
+ * While the camera spins, every frame turns the scene by the same step, so the transformations of the next frames
+ * follow from the current one. The speculator keeps a ring of slots, one per predicted frame. A slot has an instance
+ * of every model in the scene of its own (sharing the mesh data and drawers, with their own view-dependent data and
+ * segment buffers) and a FrameScheduler for those, so the extraction of every predicted frame runs on the pool, in the
+ * background, while the GL thread draws the current one.
+ *
+ * When a predicted frame comes up, its lines get swapped into the scene's models (no copies, no allocation), and the
+ * slot goes on to predict the frame after the last one. A frame which doesn't match the prediction (the user touched
+ * something, the quality changed) discards every prediction. Extractions in flight can't be cancelled: a discarded
+ * slot gets waited for when it gets reused, so discarding never blocks.
+ *
+ * The slots' instances only exist while the camera spins (see build and release): their view-dependent data and
+ * segment buffers are as large as the scene's own, for every slot.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef SPECULATOR_H_
+#define SPECULATOR_H_
+
+#include "FrameScheduler.h"
+#include "Model.h"
+#include <XForm.h>
+#include <vector>
+
+// number of frames to extract ahead while the camera spins, when speculating
+#define SPECULATION_FRAMES 3
+
+class Speculator{
+private:
+	struct Slot{
+		std::vector<Model*> models_; // the slot's own instances of the scene's models
+		FrameScheduler* scheduler_;
+		trimesh::xform transform_; // the predicted global transformation
+		int quality_; // the quality level it got extracted at
+		Slot(ThreadPool* pool);
+		~Slot();
+	};
+
+	std::vector<Slot*> slots_;
+	int first_; // the slot predicting the next frame
+	int count_; // number of predictions, in slots first_, first_ + 1, ...
+	int hits_; // frames taken from a prediction
+	int misses_; // frames for which the predictions got discarded
+
+public:
+	// constructor: a speculator predicting a number of frames ahead, extracting on a pool
+	Speculator(ThreadPool* pool, int frames = SPECULATION_FRAMES);
+	~Speculator();
+	// create the slots' instances of a list of models (rebuild when the models or their drawer stacks change)
+	void build(const std::vector<Model*> &models);
+	// delete the slots' instances (after waiting for their extractions), until the next build
+	void release();
+	// do the slots have instances?
+	bool built() const;
+	// if the next prediction is for this transformation and quality level, swap its lines into the models
+	bool take(const trimesh::xform &transform, int quality, std::vector<Model*> &models);
+	// extract the frames after the last prediction (or after this one), a step apart, up to the number of slots
+	void predict(const trimesh::xform &transform, const trimesh::xform &step, int quality, const std::vector<Model*> &models);
+	// forget all predictions
+	void discard();
+	// wait until no extraction runs (before changing what the models extract from)
+	void wait();
+	// number of predictions, and the frames taken from them or missed so far
+	int predictions() const;
+	int hits() const;
+	int misses() const;
+};
+
+#endif /* SPECULATOR_H_ */
@@ -35,37 +35,80 @@ bool SuggestiveContourDrawer::isFaded(){
 }
 
 /**
- * Draw the suggestive contours for a given Model, viewed from a given camera position
+ * Compute the per-vertex data the suggestive contours need: radial curvature and its derivative
  *
  * @param Model* : the model
- * @param camera_position: the current camera position, given in 3d-coordinates
+ * @param camera_position: the camera position, given in 3d-coordinates
  */
-void SuggestiveContourDrawer::draw(Model* m, trimesh::vec camera_position){
-	if(isVisible()){
-		// Setup OpenGL to draw nice lines
-		glPolygonOffset(5.0f, 30.0f);
-		glEnable(GL_LINE_SMOOTH); // line anti-aliasing
-		glDisable(GL_LIGHTING);
-		glEnable(GL_POLYGON_OFFSET_FILL);
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-		// set color and linewidth_
-		glLineWidth(linewidth_);
-		glColor3f(linecolor_[0],linecolor_[1],linecolor_[2]);
-
-		// if we use fading, set the fade parameter to something different than 0.0
-		float fade = 0.0f;
-		if(isFaded()){
-			fade = 0.03f / trimesh::sqr(m->feature_size_);
-		}
+void SuggestiveContourDrawer::prepare(Model* m, trimesh::vec camera_position){
+	m->needCurvDerivatives(camera_position, sc_thresh_);
+}
+
+/**
+ * Compute radial curvature and its derivative for a range of vertices
+ *
+ * @param Model* : the model
+ * @param camera_position: the camera position, given in 3d-coordinates
+ * @param begin: the first vertex
+ * @param end: one past the last vertex
+ */
+void SuggestiveContourDrawer::prepareVertices(Model* m, trimesh::vec camera_position, unsigned int begin, unsigned int end){
+	m->computeCurvDerivatives(camera_position, sc_thresh_, begin, end);
+}
 
-		// we need model curvature info
-		m->needCurvDerivatives(camera_position, sc_thresh_);
-		find_sc_segments(m, camera_position, fade);
-		// draw
-		flushDrawBuffer();
+/**
+ * Extract the suggestive contours for a given Model, viewed from a given camera position
+ *
+ * @param Model* : the model
+ * @param camera_position: the camera position, given in 3d-coordinates
+ * @param segments: the buffer to store the suggestive contour segments in
+ */
+void SuggestiveContourDrawer::extract(Model* m, trimesh::vec camera_position, SegmentBuffer& segments){
+	segments.clear();
+	// we need model curvature info
+	m->needCurvDerivatives(camera_position, sc_thresh_);
+	extractFaces(m, camera_position, 0, m->data_->line_faces_, segments);
+}
+
+/**
+ * Extract the suggestive contours on a range of faces, adding them to the buffer
+ *
+ * @param Model* : the model
+ * @param camera_position: the camera position, given in 3d-coordinates
+ * @param begin: the first face
+ * @param end: one past the last face
+ * @param segments: the buffer to add the suggestive contour segments to
+ */
+void SuggestiveContourDrawer::extractFaces(Model* m, trimesh::vec camera_position, unsigned int begin, unsigned int end, SegmentBuffer& segments){
+	// if we use fading, set the fade parameter to something different than 0.0
+	float fade = 0.0f;
+	if(isFaded()){
+		fade = 0.03f / trimesh::sqr(m->data_->feature_size_);
 	}
+	find_sc_segments(m, camera_position, begin, end, fade, segments);
+}
+
+/**
+ * Draw previously extracted suggestive contours
+ *
+ * @param Model* : the model
+ * @param segments: the extracted suggestive contour segments
+ */
+void SuggestiveContourDrawer::submit(Model* m, const SegmentBuffer& segments){
+	// Setup OpenGL to draw nice lines
+	glPolygonOffset(5.0f, 30.0f);
+	glEnable(GL_LINE_SMOOTH); // line anti-aliasing
+	glDisable(GL_LIGHTING);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	// set color and linewidth_
+	glLineWidth(linewidth_);
+	glColor3f(linecolor_[0],linecolor_[1],linecolor_[2]);
+
+	// draw
+	flushDrawBuffer(segments);
 }
 
 /**
@@ -74,14 +117,15 @@ void SuggestiveContourDrawer::draw(Model* m, trimesh::vec camera_position){
  * @param *m : the model
  * @param vec0, vec1, vec2: the vertex indices of the cornerpoints of a mesh face
  * @param fade_factor : the alpha blending scheme for the fading
+ * @param segments: the buffer to store the segments in
  */
-void SuggestiveContourDrawer::construct_sc_segments(Model *m, int vec0, int vec1, int vec2, float fade_factor)
+void SuggestiveContourDrawer::construct_sc_segments(Model *m, int vec0, int vec1, int vec2, float fade_factor, SegmentBuffer& segments)
 {
 	// aliases
 	const std::vector<trimesh::point> &vertices = m->mesh_->vertices;
-	const std::vector<float> &kr = m->kr_;
-	const std::vector<float> &num = m->num_;
-	const std::vector<float> &den = m->den_;
+	const FrameVector<float> &kr = m->kr_;
+	const FrameVector<float> &num = m->num_;
+	const FrameVector<float> &den = m->den_;
 	// weights between vec0 and vec1/vec2
 	float w10 = kr[vec0] / (kr[vec0] -kr[vec1]); float w01 = 1.0f - w10;
 	float w20 = kr[vec0] / (kr[vec0] -kr[vec2]); float w02 = 1.0f - w20;
@@ -121,45 +165,50 @@ void SuggestiveContourDrawer::construct_sc_segments(Model *m, int vec0, int vec1
 		return;
 	}
 	if(valid_p1){ // first point is valid: it's on a segment
-		drawbuffer_colors_.push_back(trimesh::Vec<4,float>(linecolor_[0],linecolor_[1],linecolor_[2], num1 / (den1 * fade_factor + num1)));
-		drawbuffer_vertices_.push_back(p1);
+		segments.colors_.push_back(trimesh::Vec<4,float>(linecolor_[0],linecolor_[1],linecolor_[2], num1 / (den1 * fade_factor + num1)));
+		segments.vertices_.push_back(p1);
 		nb_points_drawn++;
 	}
 	if(zero_num){ // if the dwKr dips below zero, first segment ends here. or vice versa, it starts here
 		float num = (1.0f - zero_num) * num1 + zero_num * num2;
 		float den = (1.0f - zero_num) * den1 + zero_num * den2;
-		drawbuffer_colors_.push_back(trimesh::Vec<4,float>(linecolor_[0],linecolor_[1],linecolor_[2], num / (den * fade_factor + num)));
-		drawbuffer_vertices_.push_back((1.0f-zero_num)*p1+zero_num*p2);
+		segments.colors_.push_back(trimesh::Vec<4,float>(linecolor_[0],linecolor_[1],linecolor_[2], num / (den * fade_factor + num)));
+		segments.vertices_.push_back((1.0f-zero_num)*p1+zero_num*p2);
 		nb_points_drawn++;
 	}
 	if(zero_den){ // it starts again here, or vice versa, it ends here
 		float num = (1.0f - zero_den) * num1 + zero_den * num2;
 		float den = (1.0f - zero_den) * den1 + zero_den * den2;
-		drawbuffer_colors_.push_back(trimesh::Vec<4,float>(linecolor_[0],linecolor_[1],linecolor_[2], num / (den * fade_factor + num)));
-		drawbuffer_vertices_.push_back((1.0f-zero_den)*p1+zero_den*p2);
+		segments.colors_.push_back(trimesh::Vec<4,float>(linecolor_[0],linecolor_[1],linecolor_[2], num / (den * fade_factor + num)));
+		segments.vertices_.push_back((1.0f-zero_den)*p1+zero_den*p2);
 		nb_points_drawn++;
 	}
 	if(nb_points_drawn != 2){ // when we need another point (no dwKr dips!). Complete 1st or 2nd segment.
-		drawbuffer_colors_.push_back(trimesh::Vec<4,float>(linecolor_[0],linecolor_[1],linecolor_[2], num2 /(den2 * fade_factor + num2)));
-		drawbuffer_vertices_.push_back(p2);
+		segments.colors_.push_back(trimesh::Vec<4,float>(linecolor_[0],linecolor_[1],linecolor_[2], num2 /(den2 * fade_factor + num2)));
+		segments.vertices_.push_back(p2);
 	}
 }
 
 /**
- * Compute the suggestive contour lines for a given model and camera position
+ * Compute the suggestive contour lines on a range of faces for a given model and camera position
  *
  * @param Model* : the model
  * @param camera_position: the current camera position, given in 3d-coordinates
+ * @param begin: the first face
+ * @param end: one past the last face
  * @param fade_factor: the alpha blending scheme for the fading
+ * @param segments: the buffer to store the segments in
  */
-void SuggestiveContourDrawer::find_sc_segments(Model* m, trimesh::vec camera_position, float fade_factor)
+void SuggestiveContourDrawer::find_sc_segments(Model* m, trimesh::vec camera_position, unsigned int begin, unsigned int end, float fade_factor, SegmentBuffer& segments)
 {
 	// some aliases to write readable code
 	const std::vector<trimesh::TriMesh::Face> &faces = m->mesh_->faces;
-	const std::vector<float> &kr = m->kr_;
+	const FrameVector<float> &kr = m->kr_;
+	const ExtractionQuality &quality = m->quality_;
+	unsigned int crossings = 0;
 
-	// for every face in the filtered set
-	for(unsigned int i =0; i < faces.size(); i++)
+	// for every face in the filtered set (or every stride_ one)
+	for(unsigned int i = quality.first(begin); i < end; i += quality.stride_)
 	{
 		// find vertex points
 		const int &v0 = faces[i][0];
@@ -167,23 +216,44 @@ void SuggestiveContourDrawer::find_sc_segments(Model* m, trimesh::vec camera_pos
 		const int &v2 = faces[i][2];
 		// does this face have a zero crossing for its radial curvature KR?
 		if((kr[v0] >= 0.0f || kr[v1] >= 0.0f || kr[v2] >= 0.0f) && (kr[v0] <= 0.0f || kr[v1] <= 0.0f || kr[v2] <= 0.0f)){
+			crossings++;
 			// is this face turned to the camera?
 			if(to_camera(m, i, camera_position)){
 				// which polygon corner has the different sign of kr_ ?
 				if     ((kr[v0] > 0.0f && kr[v1] <= 0.0f && kr[v2] <= 0.0f)||
 						(kr[v0] < 0.0f && kr[v1] >= 0.0f && kr[v2] >= 0.0f)){
-					construct_sc_segments(m,v0,v1,v2,fade_factor);
+					construct_sc_segments(m,v0,v1,v2,fade_factor,segments);
 				}
 				else if((kr[v1] > 0.0f && kr[v2] <= 0.0f && kr[v0] <= 0.0f)||
 						(kr[v1] < 0.0f && kr[v2] >= 0.0f && kr[v0] >= 0.0f)){
-					construct_sc_segments(m,v1,v0,v2,fade_factor);
+					construct_sc_segments(m,v1,v0,v2,fade_factor,segments);
 				}
 				else if((kr[v2] > 0.0f && kr[v1] <= 0.0f && kr[v0] <= 0.0f)||
 						(kr[v2] < 0.0f && kr[v1] >= 0.0f && kr[v0] >= 0.0f)){
-					construct_sc_segments(m,v2,v0,v1,fade_factor);
+					construct_sc_segments(m,v2,v0,v1,fade_factor,segments);
 				}
 
 			}
 		}
 	}
+	segments.candidates_ += quality.candidates(begin, end);
+	segments.crossings_ += crossings;
+}
+
+/**
+ * Upper bound on the number of segment vertices per face: at most two suggestive contour segments per face
+ */
+unsigned int SuggestiveContourDrawer::segmentVerticesPerFace(){
+	return 4;
+}
+
+const char* SuggestiveContourDrawer::name(){
+	return "suggestive contours";
+}
+
+/**
+ * Mesh properties this drawer needs: curvatures, their derivatives, face normals and the feature size
+ */
+unsigned int SuggestiveContourDrawer::requirements(){
+	return MESH_NORMALS | MESH_CURVATURES | MESH_DCURV | MESH_FACENORMALS | MESH_FEATURE_SIZE;
 }
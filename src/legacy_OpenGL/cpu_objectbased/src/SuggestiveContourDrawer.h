@@ -13,11 +13,18 @@ class SuggestiveContourDrawer: public LineDrawer {
 private:
 	bool fading_;
 	float sc_thresh_;
-	void construct_sc_segments(Model *m, int vec0, int vec1, int vec2, float fade_factor);
-	void find_sc_segments(Model* m, trimesh::vec camera_position, float fade_factor);
+	void construct_sc_segments(Model *m, int vec0, int vec1, int vec2, float fade_factor, SegmentBuffer& segments);
+	void find_sc_segments(Model* m, trimesh::vec camera_position, unsigned int begin, unsigned int end, float fade_factor, SegmentBuffer& segments);
 public:
 	SuggestiveContourDrawer(trimesh::Color color,float linewidth, bool fade, float sc_thresh);
-	virtual void draw(Model* m, trimesh::vec camera_position);
+	virtual void prepare(Model* m, trimesh::vec camera_position);
+	virtual void prepareVertices(Model* m, trimesh::vec camera_position, unsigned int begin, unsigned int end);
+	virtual void extract(Model* m, trimesh::vec camera_position, SegmentBuffer& segments);
+	virtual void extractFaces(Model* m, trimesh::vec camera_position, unsigned int begin, unsigned int end, SegmentBuffer& segments);
+	virtual void submit(Model* m, const SegmentBuffer& segments);
+	virtual unsigned int segmentVerticesPerFace();
+	virtual unsigned int requirements();
+	virtual const char* name();
 	virtual void toggleFading();
 	virtual bool isFaded();
 };
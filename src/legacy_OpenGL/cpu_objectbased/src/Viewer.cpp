@@ -18,8 +18,14 @@
 #include <GL/glut.h> // FreeGlut window management
 
 #include <string>
-#include <sstream>
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+#include <cmath>
 #include <algorithm>
+#include <map>
+#include <set>
+#include <atomic>
 
 
 // SELFMADE
@@ -28,28 +34,126 @@
 #include "EdgeContourDrawer.h"
 #include "FaceContourDrawer.h"
 #include "SuggestiveContourDrawer.h"
-#include "FPSCounter.h"
+#include "Profiler.h"
+#include "Tracer.h"
+#include "QualityGovernor.h"
+#include "ExtractionWorker.h"
+#include "ThreadPool.h"
+#include "FrameScheduler.h"
+#include "frame_memory.h"
+#include "CacheCounter.h"
+#include "autotune.h"
+#include "numa.h"
+#include "ChunkPager.h"
+#include "chunk_preprocess.h"
+#include "MeshSequence.h"
+#include "Speculator.h"
+#include "LineCache.h"
 
 using std::string;
 
 // Global variables (if this Viewer were a class, this would be its attributes)
-std::vector<Model*> models; // the model list
-std::vector<trimesh::xform> transformations; // model transformations
+std::vector<Model*> models; // the model list: the model instances, then the resident chunks of out-of-core meshes
+std::vector<trimesh::xform> placements; // where every model instance got placed initially
+ChunkPager* pager = 0; // pages the chunks of out-of-core meshes in and out
+MeshSequence* sequence = 0; // the frames of an animated mesh, prepared ahead on a loader thread
 trimesh::TriMesh::BSphere global_bsph; // global boundingbox
 trimesh::xform global_transf; // global transformations
 trimesh::GLCamera camera; // global camera
 
-// our fps counter
-FPSCounter* fps;
+// our profiler: frame rate, and statistics of every stage of the frame
+Profiler* profiler;
+int profile_wait; // the time the GL thread waits for lines to be extracted
+int profile_swap; // the time to swap buffers
+bool show_profile = false; // show the statistics on screen
+#define PROFILE_OVERLAY_LINES 64
+#define PROFILE_OVERLAY_REFRESH 0.5f // seconds
+char profile_lines[PROFILE_OVERLAY_LINES][96]; // the statistics on screen (formatted into fixed buffers)
+int profile_line_count = 0;
+trimesh::timestamp profile_lines_time; // when those got formatted
 
 // The drawers we'll use in this demo
 BaseDrawer* b;
 EdgeContourDrawer* b1;
 SuggestiveContourDrawer* b2;
 
+// trades line quality for frame time while the user interacts (none: always full quality)
+QualityGovernor* governor = 0;
+bool governing = true; // toggled with 'b'
+bool interacting = false; // is the camera moving (or an animation playing)?
+int profile_work; // the time the GL thread spends on a frame, which the governor holds to its budget
+int profile_quality; // the quality level the governor picked
+
 // toggle for diffuse lighting
 bool diffuse = false;
 
+// frame modes:
+//  - FRAME_SYNC: extract and submit every frame, one after the other
+//  - FRAME_PIPELINED: while frame N gets submitted, the worker already extracts frame N+1
+//  - FRAME_ASYNC: always submit the last completed lines with the current camera, swap in new lines whenever
+//    the worker finishes them, so a slow extraction never stalls the display
+//  - FRAME_PROGRESSIVE: extract on the GL thread (and the pool) within a slice of every frame, the clusters of faces
+//    likely to show lines first, and show what's done so far: the lines of a huge model build up over a few frames
+//    after every camera move, instead of freezing the first one
+enum FrameMode { FRAME_SYNC, FRAME_PIPELINED, FRAME_ASYNC, FRAME_PROGRESSIVE };
+FrameMode frame_mode = FRAME_SYNC;
+ExtractionWorker* worker;
+ThreadPool* pool; // the worker threads which preprocess meshes and extract lines
+std::vector<float> pool_utilization; // how busy every worker was during the last second
+trimesh::timestamp pool_utilization_time; // when that got measured
+FrameScheduler* scheduler; // runs the extraction of all models concurrently, on the pool
+bool extraction_pending = false; // is there a launched extraction we haven't swapped in yet?
+trimesh::vec extract_camera_pos; // the camera position the worker is extracting for
+trimesh::timestamp extract_time; // when that camera position was captured
+int extract_frame = 0; // in which frame that camera position was captured
+trimesh::vec lines_camera_pos; // the camera position of the lines on screen
+trimesh::timestamp lines_time; // when the camera position of the lines on screen was captured
+int lines_frame = 0; // in which frame the camera position of the lines on screen was captured
+int extract_quality = 0; // the quality level the worker is extracting at
+int lines_quality = 0; // the quality level of the lines on screen
+int frame_count = 0; // number of frames drawn so far
+int steady_frames = 0; // number of frames since the last user action (which is allowed to allocate memory)
+#define PROGRESSIVE_SLICE 0.5f // fraction of the frame budget progressive extraction gets every frame (16 ms without one)
+bool progressive_restart = true; // does the progressive extraction have to start over (settings or models changed)?
+int profile_slice; // the time the GL thread spends on progressive extraction every frame
+// extracts the next frames of an autospin ahead, on the pool (synchronous frame mode only: none if -speculate 0)
+Speculator* speculator = 0;
+// -speculate K: number of frames to extract ahead (SPECULATION_FRAMES is a good start), off by default: the spin then
+// turns by a fixed step per frame instead of by the time passed
+int speculation_frames = 0;
+bool spin_locked = false; // does the spin turn by spin_step every frame (so the next frames are known)?
+trimesh::xform spin_step;
+int spin_frame = -1; // the last frame the spin turned for
+int profile_speculation; // per spinning frame: 1 if its lines were extracted ahead, 0 if not
+// the lines of the views the user stopped at (synchronous frame mode only: none if -linecache 0)
+LineCache* line_cache = 0;
+size_t line_cache_budget = size_t(LINE_CACHE_MB) * 1024 * 1024; // -linecache MB: memory the cached lines can take
+bool frame_interacting = false; // was the user interacting during the last frame?
+int profile_cache_views; // number of cached views
+int profile_cache_memory; // memory they take, in MB
+int profile_cache_hit_rate; // percentage of views found in the cache so far
+
+// command line options
+bool reorder_models = false; // -reorder: put mesh vertices and faces in locality-optimized order
+bool compact_models = false; // -compact: store vertex attributes in compact (quantized) form
+bool lod_models = false; // -lod: build a level of detail hierarchy for every model
+bool use_lod = true; // pick levels of detail from screen size (when models have them)
+#define LOD_MIN_FACES 2000 // coarsest level of detail
+#define BENCH_EDIT_VERTICES 64 // scattered vertices the benchmark moves, to check incremental updates
+int instances = 1; // -instances N: place every model N times in the scene, side by side
+int threads = 0; // -threads N: number of worker threads (0: one less than the number of hardware threads)
+bool pin_threads = false; // -pin: pin every worker thread to a core
+bool autotune = true; // pick the fastest kernel configuration for every mesh (-notune: use the defaults)
+bool force_kernel_config = false; // -kernel C,T: use chunk size C and T threads (0: all) for every mesh instead
+KernelConfig forced_kernel_config;
+size_t ooc_budget = 0; // -ooc MB: preprocess and view meshes out of core, within a memory budget (0: in core)
+bool sequence_mode = false; // -seq: the model files are the frames of one animated mesh, with the same connectivity
+float frame_budget = 16.0f; // -budget MS: the frame time the quality governor holds while the user interacts (0: off)
+std::string profile_name = "profile"; // -profile NAME: write the frame statistics to NAME.csv and NAME.json at exit
+std::string trace_file = "trace.json"; // -trace FILE: trace from the start (preprocessing included), write the trace to FILE
+bool benchmark = false; // -bench: benchmark extraction before and after reordering (and compacting), and an edit, then quit
+CacheCounter* cache_counter; // hardware cache counters for the benchmark
+
 /**
  * Clears the OpenGL Draw and Depth buffer, resets all relevant OpenGL states
  */
@@ -71,13 +175,23 @@ void cls(){
  * (from TriMesh2 library)
  */
 void update_boundingsphere(){
+	// the spheres to enclose: every model instance, and every out-of-core mesh as a whole (not all of it is resident)
+	std::vector<trimesh::TriMesh::BSphere> spheres;
+	for (unsigned int i = 0; i < placements.size(); i++){
+		trimesh::TriMesh::BSphere s = models[i]->mesh_->bsphere;
+		s.center = models[i]->transform_ * s.center;
+		spheres.push_back(s);
+	}
+	for (int i = 0; pager && i < pager->stores(); i++){
+		spheres.push_back(pager->store(i)->bsphere());
+	}
 	// largest box possible
 	trimesh::point boxmin(1e38, 1e38, 1e38);
 	trimesh::point boxmax(-1e38, -1e38, -1e38);
 	// find outer coords
-	for (unsigned int i = 0; i < models.size(); i++){
-		trimesh::point c = transformations[i] * models[i]->mesh_->bsphere.center;
-		float r = models[i]->mesh_->bsphere.r;
+	for (unsigned int i = 0; i < spheres.size(); i++){
+		trimesh::point c = spheres[i].center;
+		float r = spheres[i].r;
 		for (int j = 0; j < 3; j++) {
 			boxmin[j] = std::min(boxmin[j], c[j]-r);
 			boxmax[j] = std::max(boxmax[j], c[j]+r);
@@ -88,11 +202,15 @@ void update_boundingsphere(){
 	gc = 0.5f * (boxmin + boxmax);
 	gr = 0.0f;
 	// find largest possible radius for sphere
-	for (unsigned int i = 0; i < models.size(); i++) {
-		trimesh::point c = transformations[i] * models[i]->mesh_->bsphere.center;
-		float r = models[i]->mesh_->bsphere.r;
+	for (unsigned int i = 0; i < spheres.size(); i++) {
+		trimesh::point c = spheres[i].center;
+		float r = spheres[i].r;
 		gr = std::max(gr, dist(c, gc) + r);
 	}
+	// cached views are quantized relative to the scene's size
+	if(line_cache){
+		line_cache->setScale(gr);
+	}
 }
 
 /**
@@ -103,8 +221,8 @@ void resetview()
 	// kill the cam
 	camera.stopspin();
 	// undo all model transformations
-	for (unsigned int i = 0; i < models.size(); i++){
-		transformations[i] = trimesh::xform();
+	for (unsigned int i = 0; i < placements.size(); i++){
+		models[i]->transform_ = placements[i];
 	}
 	// recompute bounding sphere
 	update_boundingsphere();
@@ -133,10 +251,341 @@ void setup_lighting(){
 	}
 }
 
+/**
+ * Extraction job for the pipelined and asynchronous frame modes: run the drawer stack extraction of every model
+ * on the thread pool. Runs on the worker thread, which helps until all models are done.
+ */
+void extract_models(){
+	scheduler->launch(extract_camera_pos);
+	scheduler->wait();
+}
+
+/**
+ * Make the lines the worker extracted the ones on screen.
+ */
+void swap_in_extracted_lines(){
+	for (unsigned int i = 0; i < models.size(); i++){
+		models[i]->swapSegments();
+	}
+	lines_camera_pos = extract_camera_pos;
+	lines_time = extract_time;
+	lines_frame = extract_frame;
+	lines_quality = extract_quality;
+	extraction_pending = false;
+}
+
+/**
+ * The quality level extractions run at now (0: full quality)
+ */
+int quality_level(){
+	return governor && governing ? governor->level() : 0;
+}
+
+/**
+ * Pick every model's level of detail and extraction quality for the next extraction, from the size of its bounding
+ * sphere on screen and the quality the governor settled on.
+ * Uses the current OpenGL projection and viewport, so call this on the GL thread after setting up the camera.
+ */
+void select_levels(trimesh::vec camera_pos){
+	GLdouble projection[16];
+	GLint viewport[4];
+	glGetDoublev(GL_PROJECTION_MATRIX, projection);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	bool reduced = governor && governing;
+	float lod_scale = reduced ? governor->quality().lod_scale_ : 1.0f;
+	float tolerance = reduced ? governor->quality().tolerance_ : 0.0f;
+	int stride = reduced ? governor->quality().stride_ : 1;
+	bool suppressed = reduced && !governor->quality().suggestive_;
+	if(suppressed != b2->isSuppressed()){
+		// the frames extracted ahead read the drawers too (the worker doesn't run here, see launch_extraction)
+		if(speculator){
+			speculator->wait();
+		}
+		b2->setSuppressed(suppressed);
+	}
+	for (unsigned int i = 0; i < models.size(); i++){
+		const trimesh::TriMesh::BSphere &bsphere = models[i]->mesh_->bsphere;
+		trimesh::point center = models[i]->transform_ * bsphere.center;
+		// distance to the nearest point of the bounding sphere (inside it, everything is full size)
+		float distance = std::max(dist(camera_pos, center) - bsphere.r, 1e-6f * bsphere.r);
+		float screen_radius = bsphere.r * float(projection[5]) / distance * 0.5f * viewport[3];
+		models[i]->selectLevel(use_lod ? lod_scale * screen_radius : 1e30f);
+		// (the tolerance in pixels, in object space at the model's distance)
+		ExtractionQuality &quality = models[i]->quality_;
+		quality.tolerance_ = tolerance * bsphere.r / screen_radius;
+		quality.stride_ = stride;
+		quality.offset_ = frame_count % stride;
+	}
+}
+
+/**
+ * Tell the governor whether levels of detail get picked: only when some model has them, and selection is on.
+ */
+void update_governor_lod(){
+	if(!governor){
+		return;
+	}
+	bool lod = false;
+	for (unsigned int i = 0; i < models.size(); i++){
+		lod = lod || models[i]->levels() > 1;
+	}
+	governor->useLevelsOfDetail(use_lod && lod);
+}
+
+/**
+ * Start extracting lines for the given camera position on the worker.
+ */
+void launch_extraction(trimesh::vec camera_pos){
+	select_levels(camera_pos);
+	extract_camera_pos = camera_pos;
+	extract_time = trimesh::now();
+	extract_frame = frame_count;
+	extract_quality = quality_level();
+	worker->launch(extract_models);
+	extraction_pending = true;
+}
+
+/**
+ * Drop the progressive extraction in progress (if any): the next frame starts over.
+ */
+void end_progressive(){
+	for (unsigned int i = 0; i < models.size(); i++){
+		models[i]->endProgressive();
+	}
+	extraction_pending = false;
+	progressive_restart = true;
+}
+
+/**
+ * Start a progressive extraction of every model for the given camera position.
+ * Uses the current OpenGL projection and viewport (see select_levels).
+ */
+void begin_progressive(trimesh::vec camera_pos){
+	select_levels(camera_pos);
+	extract_camera_pos = camera_pos;
+	extract_time = trimesh::now();
+	extract_frame = frame_count;
+	extract_quality = quality_level();
+	trimesh::vec view_dir = inv(global_transf) * trimesh::point(0,0,-1) - camera_pos;
+	parallel_for(0, models.size(), 1, [&](int i){
+		models[i]->beginProgressive(camera_pos, view_dir);
+	});
+	extraction_pending = true;
+	progressive_restart = false;
+}
+
+/**
+ * Go on with the progressive extraction of every model for a slice of the frame, and make its lines the ones on screen
+ * once every model completed.
+ *
+ * @param frame_start: when the frame started (the slice counts from there)
+ */
+void continue_progressive(const trimesh::timestamp &frame_start){
+	ProfileTimer timer(profile_slice);
+	float slice = 0.001f * PROGRESSIVE_SLICE * (frame_budget > 0.0f ? frame_budget : 16.0f);
+	std::atomic<int> completed(0);
+	parallel_for(0, models.size(), 1, [&](int i){
+		if(models[i]->continueProgressive(frame_start, slice)){
+			completed++;
+		}
+	});
+	if(completed == (int) models.size()){
+		lines_camera_pos = extract_camera_pos;
+		lines_time = extract_time;
+		lines_frame = extract_frame;
+		lines_quality = extract_quality;
+		extraction_pending = false;
+	}
+}
+
+/**
+ * Switch to another frame mode, after letting the worker finish whatever it is doing.
+ */
+void set_frame_mode(FrameMode mode){
+	worker->wait();
+	end_progressive();
+	frame_mode = mode;
+}
+
+/**
+ * Compute the current camera position, in world coordinates
+ */
+trimesh::vec current_camera_position(){
+	return inv(global_transf) * trimesh::point(0,0,0);
+}
+
+/**
+ * Make sure no extraction reads the models or the drawers, before the GL thread changes them: wait for the worker (in
+ * the pipelined and asynchronous frame modes) and swap its lines in, drop a progressive extraction, and wait for the
+ * frames extracted ahead and forget them. In the synchronous frame mode, every model's extraction has been waited for
+ * already.
+ */
+void finish_extraction(){
+	if(frame_mode == FRAME_PROGRESSIVE){
+		end_progressive();
+	}
+	else if(extraction_pending){
+		worker->wait();
+		swap_in_extracted_lines();
+	}
+	if(speculator){
+		speculator->wait();
+		speculator->discard();
+	}
+}
+
+/**
+ * Page chunks of out-of-core meshes in (and out) for a camera position. That changes the model list, so it waits
+ * for the extraction in flight (if any) and rebuilds the extraction task graph.
+ */
+void page_chunks(trimesh::vec camera_pos){
+	if(!pager || !pager->plan(camera_pos)){
+		return;
+	}
+	finish_extraction();
+	pager->apply();
+	models.resize(placements.size());
+	models.insert(models.end(), pager->models().begin(), pager->models().end());
+	scheduler->build(models);
+	if(speculator && spin_locked){
+		speculator->build(models);
+	}
+	if(line_cache){
+		line_cache->clear();
+	}
+	printf("Resident chunks: %i (%i MB) \n", int(pager->models().size()), int(pager->residentBytes() / (1024 * 1024)));
+	// new models allocate their buffers
+	steady_frames = 0;
+}
+
+/**
+ * Show the next frame of the animated sequence, if the loader has prepared it. That changes the mesh data the models
+ * extract from, so it waits for the extraction in flight (if any).
+ */
+void advance_sequence(){
+	if(!sequence || !sequence->playing()){
+		return;
+	}
+	// the loader reads frames (which allocates) while the sequence plays
+	steady_frames = 0;
+	if(!sequence->ready()){
+		return;
+	}
+	finish_extraction();
+	sequence->advance();
+}
+
+/**
+ * A hash of everything besides the camera position the lines of a frame depend on, for the line cache: the drawers'
+ * visibility and parameters, the viewport height (levels of detail get picked for it) and the animation frame.
+ */
+unsigned long long line_settings(){
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	bool visible[3] = { b->isVisible(), b1->isVisible(), b2->isVisible() };
+	bool faded = b2->isFaded();
+	trimesh::vec color = b2->getLineColor();
+	int frame = sequence ? sequence->frame() : 0;
+	unsigned long long settings = LineCache::settings(0, visible, sizeof(visible));
+	settings = LineCache::settings(settings, &faded, sizeof(faded));
+	settings = LineCache::settings(settings, &color[0], 3 * sizeof(float));
+	settings = LineCache::settings(settings, &use_lod, sizeof(use_lod));
+	settings = LineCache::settings(settings, &viewport[3], sizeof(viewport[3]));
+	settings = LineCache::settings(settings, &frame, sizeof(frame));
+	return settings;
+}
+
+/**
+ * Draw the profiler statistics on top of the scene: the percentiles of every section, in milliseconds or counts.
+ * They get formatted (into fixed buffers) every PROFILE_OVERLAY_REFRESH seconds, so they can be read.
+ */
+void draw_profile(){
+	if(trimesh::now() - profile_lines_time >= PROFILE_OVERLAY_REFRESH){
+		profile_lines_time = trimesh::now();
+		profile_line_count = 0;
+		snprintf(profile_lines[profile_line_count++], sizeof(profile_lines[0]), "%-36s %8s %8s %8s", "", "p50", "p95", "p99");
+		for (int i = 0; i < profiler->sections() && profile_line_count < PROFILE_OVERLAY_LINES; i++){
+			ProfileStats s = profiler->stats(i);
+			if(s.samples_ == 0){
+				continue;
+			}
+			// (the end of the name tells most: model names are file names)
+			const std::string &name = profiler->name(i);
+			const char* shown = name.c_str() + (name.size() > 36 ? name.size() - 36 : 0);
+			snprintf(profile_lines[profile_line_count++], sizeof(profile_lines[0]), profiler->isCounter(i) ? "%-36s %8.0f %8.0f %8.0f" : "%-36s %8.3f %8.3f %8.3f",
+					shown, s.p50_, s.p95_, s.p99_);
+		}
+	}
+	// draw in window coordinates, top down
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0, viewport[2], 0, viewport[3], -1, 1);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_LIGHTING);
+	glColor3f(0.0f, 0.0f, 0.8f);
+	for (int l = 0; l < profile_line_count; l++){
+		glRasterPos2i(4, viewport[3] - 13 * (l + 1));
+		for (const char* c = profile_lines[l]; *c; c++){
+			glutBitmapCharacter(GLUT_BITMAP_8_BY_13, *c);
+		}
+	}
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+}
+
+/**
+ * Write the profiler statistics to files (at exit)
+ */
+void write_profile(){
+	std::string csv = profile_name + ".csv";
+	std::string json = profile_name + ".json";
+	if(profiler->writeCSV(csv.c_str()) && profiler->writeJSON(json.c_str())){
+		printf("Wrote frame statistics to %s and %s \n", csv.c_str(), json.c_str());
+	}
+	else{
+		printf("Could not write frame statistics to %s and %s \n", csv.c_str(), json.c_str());
+	}
+}
+
+/**
+ * Write the running trace to file (at exit, or when tracing gets toggled off)
+ */
+void write_trace(){
+	if(!Tracer::enabled()){
+		return;
+	}
+	Tracer::stop();
+	if(Tracer::write(trace_file.c_str())){
+		printf("Wrote trace to %s (open it in chrome://tracing or Perfetto) \n", trace_file.c_str());
+	}
+	else{
+		printf("Could not write trace to %s \n", trace_file.c_str());
+	}
+}
+
 /**
  * Reposition the camera and draw every model in the scene.
  */
 void redraw(){
+#ifdef _DEBUG
+	// all per-frame buffers keep their capacity, so once warmed up, a frame should not allocate any heap memory
+	static size_t last_allocation_count = 0;
+	size_t allocation_count = heap_allocation_count();
+	assert(steady_frames < 3 || allocation_count == last_allocation_count);
+	last_allocation_count = allocation_count;
+#endif
+	steady_frames++;
+	TraceScope trace("frame");
+	trimesh::timestamp frame_start = trimesh::now();
+
 	// setup camera and push global transformations
 	camera.setupGL(global_transf * global_bsph.center, global_bsph.r);
 	glPushMatrix();
@@ -150,30 +599,140 @@ void redraw(){
 	glEnable(GL_CULL_FACE);
 
 	// compute new camera position
-	trimesh::vec camera_pos = inv(global_transf) * trimesh::point(0,0,0);
+	trimesh::vec camera_pos = current_camera_position();
 
 	// setup lighting
 	setup_lighting();
 
+	// bring in the out-of-core chunks this camera position needs
+	page_chunks(camera_pos);
+	bool prepared = false; // are the lines ready without extracting (extracted ahead, or cached)?
+	bool cacheable = false; // can the lines of this frame go in the line cache (and come from it)? views at rest only
+	LineCacheKey view;
+	// and the next frame of an animated mesh
+	advance_sequence();
+
+	if(frame_mode == FRAME_PIPELINED){
+		// the extraction launched last frame becomes the set of lines we show this frame
+		if(extraction_pending){
+			ProfileTimer timer(profile_wait);
+			worker->wait();
+			swap_in_extracted_lines();
+		}
+		// start extracting the next frame from the latest camera while we submit this one
+		launch_extraction(camera_pos);
+	}
+	else if(frame_mode == FRAME_ASYNC){
+		// never wait: swap in new lines if the worker is done, and put it back to work for the current camera
+		if(extraction_pending && worker->finished()){
+			swap_in_extracted_lines();
+		}
+		if(!extraction_pending){
+			launch_extraction(camera_pos);
+		}
+	}
+	else if(frame_mode == FRAME_PROGRESSIVE){
+		// start over when the camera (or the quality) changed, go on where the last frame stopped otherwise
+		if(progressive_restart || camera_pos != extract_camera_pos || quality_level() != extract_quality){
+			begin_progressive(camera_pos);
+		}
+		if(extraction_pending){
+			continue_progressive(frame_start);
+		}
+	}
+	else{
+		select_levels(camera_pos);
+		// take the lines of a spinning camera from the frames extracted ahead, or those of a view at rest from the cache
+		// (at full quality), or extract all models concurrently: each one gets submitted as soon as its own lines are done
+		if(speculator && camera_pos != lines_camera_pos){
+			prepared = speculator->take(global_transf, quality_level(), models);
+			if(spin_locked){
+				profiler->record(profile_speculation, prepared);
+			}
+		}
+		// (frames while the camera moves neither look views up nor count as misses: the hit rate is the one of the views
+		// the user stops at)
+		cacheable = line_cache && quality_level() == 0 && !interacting;
+		if(cacheable && !prepared){
+			view = line_cache->key(camera_pos, line_settings());
+			prepared = line_cache->load(view, models);
+		}
+		if(!prepared){
+			scheduler->launch(camera_pos);
+		}
+		// and put the idle cores to work on the next frames of the spin
+		if(speculator && spin_locked){
+			speculator->predict(global_transf, spin_step, quality_level(), models);
+		}
+		lines_camera_pos = camera_pos;
+		lines_time = trimesh::now();
+		lines_frame = frame_count;
+		lines_quality = quality_level();
+	}
+
 	// draw every model
 	for (unsigned int i = 0; i < models.size(); i++){
 		// push model-specific transformations
 		glPushMatrix();
-		glMultMatrixd(transformations[i]);
-		// tell model to execute its drawer stack
-		models[i]->draw(camera_pos);
+		glMultMatrixd(models[i]->transform_);
+		// wait for the model's lines (if they're being extracted for this frame), then submit them (in object space)
+		if(frame_mode == FRAME_SYNC && !prepared){
+			ProfileTimer timer(profile_wait);
+			scheduler->wait(i);
+			models[i]->swapSegments();
+		}
+		models[i]->submit();
 		// pop again
 		glPopMatrix();
 	}
 	// pop global transformations
 	glPopMatrix();
-	glutSwapBuffers();
-	// update FPS counter
-	fps->updateCounter();
-	std::stringstream out;
-	out << "Crytek Object Space Contours Demo | FPS: " << fps->FPS;
-	string s = out.str();
-	glutSetWindowTitle(s.c_str());
+	// keep the lines of a view the user stopped at (the cache may allocate)
+	if(cacheable && !prepared){
+		if(line_cache->store(view, models)){
+			steady_frames = 0;
+		}
+	}
+	if(line_cache){
+		profiler->record(profile_cache_views, line_cache->entries());
+		profiler->record(profile_cache_memory, line_cache->bytes() / (1024.0f * 1024.0f));
+		profiler->record(profile_cache_hit_rate, 100.0f * line_cache->hitRate());
+	}
+	frame_interacting = interacting;
+	if(show_profile){
+		draw_profile();
+	}
+	{
+		ProfileTimer timer(profile_swap);
+		glutSwapBuffers();
+	}
+	profiler->endFrame();
+	// hold the frame time while the user interacts (at rest, idle restores full quality)
+	float frame_time = 1000.0f * (trimesh::now() - frame_start);
+	profiler->record(profile_work, frame_time);
+	if(governor){
+		if(governing && interacting){
+			governor->update(frame_time);
+		}
+		profiler->record(profile_quality, governor->level());
+	}
+	// measure how busy the workers are, once per second
+	if(trimesh::now() - pool_utilization_time >= 1.0f){
+		pool->utilization(pool_utilization);
+		pool_utilization_time = trimesh::now();
+	}
+	float mean_utilization = 0.0f;
+	for (int i = 0; i < pool->threads(); i++){
+		mean_utilization += pool_utilization[i] / pool->threads();
+	}
+	// (formatted into a fixed buffer: the frame loop shouldn't allocate)
+	static char title[256];
+	snprintf(title, sizeof(title), "Crytek Object Space Contours Demo | FPS: %i | Line age: %i frame(s), %i ms | LOD: %i/%i | Quality: %i/%i | Workers: %i%% busy",
+			profiler->fps(), frame_count - lines_frame, int(1000.0f * (trimesh::now() - lines_time)),
+			models.empty() ? 0 : models[0]->submittedLevel(), models.empty() ? 0 : models[0]->levels() - 1,
+			governor ? governor->level() : 0, governor ? governor->levels() - 1 : 0, int(100.0f * mean_utilization));
+	frame_count++;
+	glutSetWindowTitle(title);
 }
 
 /**
@@ -226,6 +785,17 @@ void dump_image()
 
 static unsigned buttonstate = 0;
 
+/**
+ * End a spin the speculator extracts ahead for (if one is going on): its predictions won't come up, so free their
+ * instances (see Speculator::release).
+ */
+void unlock_spin(){
+	if(spin_locked && speculator){
+		speculator->release();
+	}
+	spin_locked = false;
+}
+
 /**
  * Handle mouse motions
  * (from TriMesh2 library)
@@ -247,12 +817,17 @@ void mousemotionfunc(int x, int y){
 	else // hmm, it was something else
 		b = map[buttonstate & 7];
 
+	// the user takes the camera over: the frames extracted ahead won't come up
+	unlock_spin();
+
 	// pass mouse movement to camera
 	camera.mouse(x, y, b,global_transf * global_bsph.center, global_bsph.r,global_transf);
 
-	// if we identified something as mouse movement, force redisplay
-	if (b != trimesh::Mouse::NONE)
+	// if we identified something as mouse movement, force redisplay (at the quality the governor allows)
+	if (b != trimesh::Mouse::NONE){
+		interacting = true;
 		glutPostRedisplay();
+	}
 }
 
 /**
@@ -282,6 +857,9 @@ void mousebuttonfunc(int button, int state, int x, int y){
  * Handle keyboard events to toggle some functionalities in the drawers, for demonstration purposes in this sample
  */
 void keyboardfunc(unsigned char key, int x, int y){
+	// keys change drawer settings (and the models) which extractions read, on other threads: let those finish first
+	// (the frames extracted ahead wouldn't have the new settings either)
+	finish_extraction();
 	switch (key) {
 	case 'a': // toggle basedrawer
 		b->toggleVisibility();
@@ -314,8 +892,68 @@ void keyboardfunc(unsigned char key, int x, int y){
 	case 'w': // dump image to file
 		dump_image();
 		break;
+	case 'p': // toggle pipelined frame mode
+		set_frame_mode(frame_mode == FRAME_PIPELINED ? FRAME_SYNC : FRAME_PIPELINED);
+		printf ("Toggled pipelined frame mode to %i \n", frame_mode == FRAME_PIPELINED);
+		break;
+	case 'o': // toggle level of detail selection
+		use_lod = !use_lod;
+		update_governor_lod();
+		printf ("Toggled level of detail selection to %i \n", use_lod);
+		break;
+	case 'u': // report worker utilization
+		for (unsigned int i = 0; i < pool_utilization.size(); i++){
+			if(i < pool_utilization.size() - 1){
+				printf("Worker %i: %.1f%% busy \n", i, 100.0f * pool_utilization[i]);
+			}
+			else{
+				printf("Other threads (helping): %.1f%% busy \n", 100.0f * pool_utilization[i]);
+			}
+		}
+		break;
+	case 'n': // play or pause the animated sequence
+		if(sequence){
+			sequence->togglePlaying();
+			printf ("Toggled sequence playback to %i (frame %i of %i) \n", sequence->playing(), sequence->frame(), sequence->frames());
+		}
+		break;
+	case 's': // toggle the profiler statistics on screen
+		show_profile = !show_profile;
+		printf ("Toggled frame statistics to %i \n", show_profile);
+		break;
+	case 'b': // toggle the quality governor
+		if(governor){
+			governing = !governing;
+			governor->restore();
+			printf ("Toggled quality governor (%.1f ms budget) to %i \n", governor->budget(), governing);
+		}
+		break;
+	case 'r': // start tracing, or stop and write the trace
+		if(Tracer::enabled()){
+			write_trace();
+		}
+		else{
+			Tracer::start();
+			printf ("Tracing to %s, press 'r' again to write the trace \n", trace_file.c_str());
+		}
+		break;
+	case 'l': // toggle asynchronous (latency hiding) frame mode
+		set_frame_mode(frame_mode == FRAME_ASYNC ? FRAME_SYNC : FRAME_ASYNC);
+		printf ("Toggled asynchronous frame mode to %i \n", frame_mode == FRAME_ASYNC);
+		break;
+	case 'v': // toggle progressive frame mode
+		set_frame_mode(frame_mode == FRAME_PROGRESSIVE ? FRAME_SYNC : FRAME_PROGRESSIVE);
+		printf ("Toggled progressive frame mode to %i \n", frame_mode == FRAME_PROGRESSIVE);
+		break;
 	}
+	// user actions may (re)allocate buffers, and change what gets extracted
+	steady_frames = 0;
+	progressive_restart = true;
 	glutPostOverlayRedisplay();
+	// the asynchronous frame mode only extracts in redraws, and the lines on screen now have the old settings
+	if(frame_mode == FRAME_ASYNC){
+		glutPostRedisplay();
+	}
 }
 
 /**
@@ -324,15 +962,233 @@ void keyboardfunc(unsigned char key, int x, int y){
  */
 void idle(){
 	trimesh::xform tmp_xf = global_transf;
-	if (camera.autospin(tmp_xf)) // if the camera is still spinning
+	bool spinning = camera.autospin(tmp_xf);
+	interacting = spinning || (buttonstate & 7) || (sequence && sequence->playing());
+	// with frames extracted ahead, the spin turns by a fixed step every frame (the first step autospin took) instead of
+	// by the time since the last call, so the next frames are known
+	if (spinning && speculator && frame_mode == FRAME_SYNC && !(sequence && sequence->playing())){
+		if (!spin_locked){
+			spin_step = tmp_xf * inv(global_transf);
+			spin_locked = true;
+			// the instances which extract ahead only exist while the spin lasts
+			speculator->build(models);
+		}
+		else
+			tmp_xf = frame_count != spin_frame ? spin_step * global_transf : global_transf;
+		spin_frame = frame_count;
+	}
+	else
+		unlock_spin();
+	if (governor && !interacting && governor->level() > 0){
+		governor->restore(); // at rest: back to full quality
+		glutPostRedisplay();
+	}
+	else if (spinning) // if the camera is still spinning
 		glutPostRedisplay();
+	else if (frame_mode != FRAME_SYNC && (lines_camera_pos != current_camera_position() || lines_quality > quality_level()))
+		glutPostRedisplay(); // the lines on screen haven't caught up with the camera (or the quality) yet
+	else if (frame_mode == FRAME_PROGRESSIVE && extraction_pending)
+		glutPostRedisplay(); // the progressive extraction goes on
+	else if (frame_mode == FRAME_ASYNC && extraction_pending)
+		glutPostRedisplay(); // swap in the lines the worker is extracting (for new settings, at the same camera)
+	else if (line_cache && frame_mode == FRAME_SYNC && frame_interacting)
+		glutPostRedisplay(); // the user stopped: draw (and cache) the view at rest
+	else if (sequence && sequence->playing())
+		glutPostRedisplay(); // the animation goes on
 	else
 		trimesh::usleep(10000); // do nothing
 	global_transf = tmp_xf;
 
 }
 
+/**
+ * Benchmark line extraction for a model from a ring of viewpoints around it, and report the time and the
+ * (last-level) cache misses per extraction.
+ *
+ * @param m: the model
+ * @param label: what to call this run in the report
+ */
+void benchmark_extraction(Model* m, const char* label){
+	const int views = 64;
+	const trimesh::TriMesh::BSphere &bsphere = m->mesh_->bsphere;
+	// warm up: the first extraction touches freshly reserved buffers
+	m->extract(bsphere.center + trimesh::vec(5.0f * bsphere.r, 0, 0));
+	cache_counter->start();
+	trimesh::timestamp start = trimesh::now();
+	for (int i = 0; i < views; i++){
+		float angle = 2.0f * 3.14159265f * i / views;
+		trimesh::vec camera_pos = bsphere.center + 5.0f * bsphere.r * trimesh::vec(cos(angle), 0.3f, sin(angle));
+		m->extract(camera_pos);
+	}
+	float elapsed = trimesh::now() - start;
+	cache_counter->stop();
+	printf("%s: %.3f ms per extraction", label, 1000.0f * elapsed / views);
+	if(cache_counter->available()){
+		printf(", %llu cache misses per extraction (%.1f%% of %llu references)", (unsigned long long)(cache_counter->misses() / views),
+				cache_counter->references() ? 100.0 * cache_counter->misses() / cache_counter->references() : 0.0,
+				(unsigned long long)(cache_counter->references() / views));
+	}
+	else{
+		printf(", cache counters not available");
+	}
+	printf("\n");
+}
+
+/**
+ * Benchmark an edit: move scattered vertices along their normals (see MeshData::moveVertices), then rebuild normals,
+ * curvatures and curvature derivatives of the whole edited mesh from scratch, and report the time of both and how far
+ * the incremental update is from the full recompute. Leaves the mesh edited.
+ *
+ * @param data: the mesh data
+ */
+void benchmark_edit(MeshData* data){
+	const trimesh::TriMesh* mesh = data->mesh_;
+	int nv = mesh->vertices.size();
+	if(nv == 0 || !(data->available() & MESH_NORMALS)){
+		return;
+	}
+	float offset = data->feature_size_ > 0.0f ? 0.5f * data->feature_size_ : 0.001f * mesh->bsphere.r;
+	std::vector<int> vertices;
+	std::vector<trimesh::point> positions;
+	int stride = std::max(1, nv / BENCH_EDIT_VERTICES);
+	for (int v = stride / 2; v < nv; v += stride){
+		vertices.push_back(v);
+		positions.push_back(mesh->vertices[v]);
+	}
+	// warm up: the first edit builds the vertex to face adjacency (and expands compact attributes)
+	data->moveVertices(vertices, positions);
+	for (unsigned int i = 0; i < vertices.size(); i++){
+		positions[i] += offset * mesh->normals[vertices[i]];
+	}
+	trimesh::timestamp start = trimesh::now();
+	data->moveVertices(vertices, positions);
+	float incremental = trimesh::now() - start;
+	// the full recompute, on a copy of the edited positions and faces
+	trimesh::TriMesh full;
+	full.vertices = mesh->vertices;
+	full.faces = mesh->faces;
+	start = trimesh::now();
+	full.need_normals();
+	if(data->available() & (MESH_CURVATURES | MESH_DCURV)){
+		FaceColoring coloring;
+		color_faces(&full, coloring);
+		compute_curvatures(&full, coloring);
+		if(data->available() & MESH_DCURV){
+			compute_dcurv(&full, coloring);
+		}
+	}
+	float recompute = trimesh::now() - start;
+	float normal_error = 0.0f, curvature_error = 0.0f, dcurv_error = 0.0f;
+	for (int v = 0; v < nv; v++){
+		normal_error = std::max(normal_error, trimesh::dist(full.normals[v], mesh->normals[v]));
+		if(data->available() & MESH_CURVATURES){
+			curvature_error = std::max(curvature_error, std::max(fabsf(full.curv1[v] - mesh->curv1[v]), fabsf(full.curv2[v] - mesh->curv2[v])));
+		}
+		if(data->available() & MESH_DCURV){
+			for (int k = 0; k < 4; k++){
+				dcurv_error = std::max(dcurv_error, fabsf(full.dcurv[v][k] - mesh->dcurv[v][k]));
+			}
+		}
+	}
+	printf("Edit of %d vertices: %.3f ms incremental, %.3f ms full recompute, largest difference: %g (normals), %g (curvatures), %g (curvature derivatives)\n",
+			int(vertices.size()), 1000.0f * incremental, 1000.0f * recompute, normal_error, curvature_error, dcurv_error);
+}
+
 int main(int argc, char *argv[]){
+	// parse options (everything else is a model)
+	int nmodels = 0;
+	for (int i = 1; i < argc; i++){
+		if(strcmp(argv[i], "-reorder") == 0){
+			reorder_models = true;
+		}
+		else if(strcmp(argv[i], "-verifycache") == 0){
+			set_mesh_cache_verify(true);
+		}
+		else if(strcmp(argv[i], "-compact") == 0){
+			compact_models = true;
+		}
+		else if(strcmp(argv[i], "-lod") == 0){
+			lod_models = true;
+		}
+		else if(strcmp(argv[i], "-bench") == 0){
+			benchmark = true;
+		}
+		else if(strcmp(argv[i], "-instances") == 0 && i + 1 < argc){
+			instances = std::max(1, atoi(argv[++i]));
+		}
+		else if(strcmp(argv[i], "-threads") == 0 && i + 1 < argc){
+			threads = std::max(0, atoi(argv[++i]));
+		}
+		else if(strcmp(argv[i], "-pin") == 0){
+			pin_threads = true;
+		}
+		else if(strcmp(argv[i], "-numa") == 0 && i + 1 < argc){
+			i++;
+			numa_set_policy(strcmp(argv[i], "off") == 0 ? NUMA_OFF : strcmp(argv[i], "interleave") == 0 ? NUMA_INTERLEAVE : NUMA_PARTITION);
+		}
+		else if(strcmp(argv[i], "-notune") == 0){
+			autotune = false;
+		}
+		else if(strcmp(argv[i], "-kernel") == 0 && i + 1 < argc){
+			force_kernel_config = sscanf(argv[++i], "%d,%d", &forced_kernel_config.chunk_, &forced_kernel_config.threads_) == 2;
+		}
+		else if(strcmp(argv[i], "-ooc") == 0 && i + 1 < argc){
+			ooc_budget = size_t(std::max(1, atoi(argv[++i]))) * 1024 * 1024;
+		}
+		else if(strcmp(argv[i], "-seq") == 0){
+			sequence_mode = true;
+		}
+		else if(strcmp(argv[i], "-budget") == 0 && i + 1 < argc){
+			frame_budget = std::max(0.0f, float(atof(argv[++i])));
+		}
+		else if(strcmp(argv[i], "-speculate") == 0 && i + 1 < argc){
+			speculation_frames = std::max(0, atoi(argv[++i]));
+		}
+		else if(strcmp(argv[i], "-linecache") == 0 && i + 1 < argc){
+			line_cache_budget = size_t(std::max(0, atoi(argv[++i]))) * 1024 * 1024;
+		}
+		else if(strcmp(argv[i], "-profile") == 0 && i + 1 < argc){
+			profile_name = argv[++i];
+		}
+		else if(strcmp(argv[i], "-trace") == 0 && i + 1 < argc){
+			trace_file = argv[++i];
+			Tracer::start();
+		}
+		else{
+			nmodels++;
+		}
+	}
+	// write the trace (if one is running) at exit, benchmarks included
+	Tracer::nameThread("GL thread");
+	atexit(write_trace);
+	// the cache counters have to exist before any of the threads they should count
+	if(benchmark){
+		cache_counter = new CacheCounter();
+	}
+	// create the thread pool all parallel loops (preprocessing included) and the line extraction run on
+	pool = new ThreadPool(threads, pin_threads);
+	ThreadPool::setDefault(pool);
+	printf("Running on %i worker threads%s, %i NUMA node(s) \n", pool->threads(), pool->pinned() ? ", pinned to cores" : "", numa_nodes());
+	// create the profiler, before the models which register their sections in it
+	profiler = new Profiler();
+	Profiler::setDefault(profiler);
+	profile_wait = profiler->section("frame/wait for lines");
+	profile_swap = profiler->section("frame/swap");
+	profile_work = profiler->section("frame/work");
+	profile_slice = profiler->section("frame/progressive slice");
+	if(speculation_frames > 0){
+		profile_speculation = profiler->section("speculation/frames extracted ahead", true);
+	}
+	if(line_cache_budget > 0){
+		profile_cache_views = profiler->section("line cache/views", true);
+		profile_cache_memory = profiler->section("line cache/memory (MB)", true);
+		profile_cache_hit_rate = profiler->section("line cache/hit rate (%)", true);
+	}
+	if(frame_budget > 0.0f){
+		governor = new QualityGovernor(frame_budget);
+		profile_quality = profiler->section("governor/quality level", true);
+	}
+
 	// Initialize GLUT window manager
 	glutInitWindowSize(512, 512);
 	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH);
@@ -360,27 +1216,162 @@ int main(int argc, char *argv[]){
 	b1 = new EdgeContourDrawer(trimesh::vec(0,0,0),3.0);
     b2 = new SuggestiveContourDrawer(trimesh::vec(0,0,0), 2.0, true, 0.001);
 
-    if (argc < 2){
+    if (nmodels < 1){
     	printf("No models supplied. Please supply one or more OBJ/PLY models. \n");
+    	printf("Options: -reorder (locality-optimized vertex and face order), -verifycache (hash the source of every mesh cache, even if its size and modification time match), -compact (quantized vertex attributes), -lod (level of detail hierarchy), -instances N (place every model N times), -threads N (number of worker threads), -pin (pin worker threads to cores), -numa off|partition|interleave (placement of per-vertex data), -notune (no kernel autotuning), -kernel C,T (use chunk size C and T threads for all kernels), -ooc MB (preprocess and view models out of core, in chunks, within a memory budget), -seq (the models are the frames of one animated mesh), -budget MS (frame time to hold while interacting, 0: always full quality), -speculate K (frames to extract ahead while the camera spins, which then turns by a fixed step per frame, 0: none, the default), -linecache MB (memory for the lines of views looked at before, 0: no cache), -profile NAME (write frame statistics to NAME.csv and NAME.json at exit), -trace FILE (trace preprocessing and frames into a Chrome trace file), -bench (benchmark extraction and edits, and quit) \n");
     	exit(3);
     }
 
-	// read models from arguments
+	// read models from arguments: every file gets loaded and preprocessed once, however often it appears
+	std::map<std::string, MeshData*> loaded;
+	unsigned int requirements = b->requirements() | b1->requirements() | b2->requirements();
+	std::vector<Drawer*> drawers;
+	drawers.push_back(b);
+	drawers.push_back(b1);
+	drawers.push_back(b2);
+	std::set<std::string> paged;
+	std::vector<std::string> sequence_frames;
+	if(ooc_budget && !benchmark){
+		pager = new ChunkPager(ooc_budget, drawers);
+	}
 	for (int i = 1; i < argc; i++){
 		const char *name = argv[i];
-		// creat model
-		Model* m = new Model(name);
-		// add drawers to model
-		m->pushDrawer(b);
-		m->pushDrawer(b1);
-		m->pushDrawer(b2);
-		models.push_back(m);
-		// push back blank tranformation matrix
-		transformations.push_back(trimesh::xform());
-	}
-
-	// create fps counter
-	fps = new FPSCounter();
+		if(strcmp(name, "-instances") == 0 || strcmp(name, "-threads") == 0 || strcmp(name, "-kernel") == 0 || strcmp(name, "-numa") == 0
+				|| strcmp(name, "-ooc") == 0 || strcmp(name, "-profile") == 0
+				|| strcmp(name, "-trace") == 0 || strcmp(name, "-budget") == 0 || strcmp(name, "-speculate") == 0 || strcmp(name, "-linecache") == 0){
+			i++;
+			continue;
+		}
+		if(name[0] == '-'){
+			continue;
+		}
+		if(pager){
+			// out of core: preprocess into a chunk store (once), whose chunks get paged in while viewing
+			if(paged.insert(name).second){
+				ChunkStore* store = new ChunkStore();
+				if(build_chunk_store(name, ooc_budget, *store)){
+					pager->addStore(store);
+				}
+				else{
+					delete store;
+				}
+			}
+			continue;
+		}
+		if(sequence_mode){
+			// only the first frame gets loaded as a model, the sequence reads the others
+			sequence_frames.push_back(name);
+			if(sequence_frames.size() > 1){
+				continue;
+			}
+		}
+		MeshData* data = loaded[name];
+		if(!data){
+			// (the benchmark compares the file's own order to the reordered one, and the frames of a sequence get matched
+			// against the first one in the order of their files, so neither can start from a reordered cache)
+			data = new MeshData(name, benchmark || sequence_mode);
+			loaded[name] = data;
+			data->require(requirements);
+			if(benchmark){
+				// benchmark through a probe instance, placed at the origin
+				Model* probe = new Model(data);
+				probe->pushDrawer(b);
+				probe->pushDrawer(b1);
+				probe->pushDrawer(b2);
+				benchmark_extraction(probe, "As loaded");
+				data->reorder();
+				benchmark_extraction(probe, "Reordered");
+				if(compact_models){
+					data->compact();
+					benchmark_extraction(probe, "Reordered, compact");
+				}
+				delete probe;
+			}
+			else if(reorder_models && !sequence_mode){
+				data->reorder();
+			}
+			else if(reorder_models){
+				printf("Not reordering %s: the frames of a sequence keep the order of their files \n", name);
+			}
+			// keep what the drawers made us compute for the next run
+			data->writeCache();
+			// (levels of detail and compact attributes don't follow the frames of a sequence either)
+			if(lod_models && !sequence_mode){
+				data->buildLevels(LOD_MIN_FACES);
+			}
+			if(compact_models && !sequence_mode){
+				data->compact();
+			}
+			data->placeVertexData();
+			if(force_kernel_config){
+				force_kernels(data, forced_kernel_config);
+			}
+			else if(autotune && !benchmark){
+				autotune_kernels(data, drawers);
+			}
+			printf("Preprocessing %s took %d ms \n", name, int(1000.0f * data->preprocessing_time_));
+			if(benchmark){
+				// (after writing the cache, which doesn't take edited meshes)
+				benchmark_edit(data);
+			}
+		}
+		if(benchmark){
+			continue;
+		}
+		// the first instance stays where the file put it, copies go side by side along x
+		float spacing = 2.5f * data->mesh_->bsphere.r;
+		for (int j = 0; j < instances; j++){
+			Model* m = new Model(data);
+			m->transform_ = trimesh::xform::trans(j * spacing, 0, 0);
+			m->pushDrawer(b);
+			m->pushDrawer(b1);
+			m->pushDrawer(b2);
+			if(instances > 1){
+				char instance[16];
+				snprintf(instance, sizeof(instance), "#%d", j);
+				m->profile(name + std::string(instance));
+			}
+			else{
+				m->profile(name);
+			}
+			models.push_back(m);
+			placements.push_back(m->transform_);
+		}
+	}
+	printf("%d model instances of %d meshes \n", int(models.size()), int(loaded.size()));
+	if(pager){
+		printf("%d out-of-core meshes, paged in chunks within %d MB \n", pager->stores(), int(ooc_budget / (1024 * 1024)));
+	}
+	if(!sequence_frames.empty() && !benchmark){
+		sequence = new MeshSequence(loaded[sequence_frames[0]], sequence_frames);
+		printf("Animated sequence of %d frames \n", sequence->frames());
+	}
+
+	if(benchmark){
+		exit(0);
+	}
+
+	// write the frame statistics when the window gets closed
+	atexit(write_profile);
+	update_governor_lod();
+	// create the extraction task graph of all models
+	scheduler = new FrameScheduler(pool);
+	scheduler->build(models);
+	// and the instances which extract the frames of a spin ahead
+	// (their instances get built when a spin starts)
+	if(speculation_frames > 0){
+		speculator = new Speculator(pool, speculation_frames);
+	}
+	// and the cache of the lines of views looked at before
+	if(line_cache_budget > 0){
+		line_cache = new LineCache(line_cache_budget);
+	}
+	// create the background extraction worker for the pipelined and asynchronous frame modes
+	worker = new ExtractionWorker();
+
+	// start measuring worker utilization from here (leaving out preprocessing)
+	pool->utilization(pool_utilization);
+	pool_utilization_time = trimesh::now();
 
 	// reset window viewpoint and start GLUT main loop (will never stop)
 	resetview();
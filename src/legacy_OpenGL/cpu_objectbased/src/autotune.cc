@@ -0,0 +1,193 @@
+/*
+ * Autotuning of the view-dependent vertex kernels.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "autotune.h"
+#include "Model.h"
+#include "timestamp.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cmath>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// number of viewpoints to time an extraction from, and how many times to repeat that (keeping the fastest)
+#define AUTOTUNE_VIEWS 8
+#define AUTOTUNE_REPEATS 2
+
+/**
+ * The key under which a mesh's tuning decision gets cached on this host
+ */
+static std::string tuning_key(const MeshData* data){
+	char host[256] = "unknown";
+#ifdef _WIN32
+	DWORD size = sizeof(host);
+	GetComputerNameA(host, &size);
+#else
+	gethostname(host, sizeof(host));
+	host[sizeof(host) - 1] = 0;
+#endif
+	int workers = ThreadPool::getDefault() ? ThreadPool::getDefault()->threads() : 0;
+	int size_class = int(floor(log2(double(std::max(size_t(1), data->mesh_->vertices.size())))));
+	std::ostringstream key;
+	key << host << " " << std::thread::hardware_concurrency() << " " << workers << " " << size_class << " " << data->isCompact();
+	return key.str();
+}
+
+/**
+ * Look up a cached tuning decision
+ *
+ * @param key: the tuning key
+ * @param config: the cached configuration, if there is one
+ * @return whether there is one
+ */
+static bool read_tuning_cache(const std::string &key, KernelConfig &config){
+	std::ifstream in(AUTOTUNE_CACHE_FILE);
+	std::string line;
+	bool found = false;
+	while(std::getline(in, line)){
+		// entries: the key, then the chunk size and number of threads (later entries win)
+		if(line.size() > key.size() && line.compare(0, key.size(), key) == 0 && line[key.size()] == ' '){
+			std::istringstream values(line.substr(key.size()));
+			KernelConfig entry;
+			if(values >> entry.chunk_ >> entry.threads_){
+				config = entry;
+				found = true;
+			}
+		}
+	}
+	return found;
+}
+
+static void write_tuning_cache(const std::string &key, const KernelConfig &config){
+	std::ofstream out(AUTOTUNE_CACHE_FILE, std::ios::app);
+	out << key << " " << config.chunk_ << " " << config.threads_ << std::endl;
+}
+
+/**
+ * Time line extraction on a mesh: the fastest of a few rounds of extractions from a ring of viewpoints
+ *
+ * @param m: a model of the mesh, with the drawers to time
+ * @return the time per extraction, in seconds
+ */
+static float time_extraction(Model* m){
+	const trimesh::TriMesh::BSphere &bsphere = m->mesh_->bsphere;
+	float best = 1e30f;
+	for(int r = 0; r < AUTOTUNE_REPEATS; r++){
+		trimesh::timestamp start = trimesh::now();
+		for(int i = 0; i < AUTOTUNE_VIEWS; i++){
+			float angle = 2.0f * 3.14159265f * i / AUTOTUNE_VIEWS;
+			m->extract(bsphere.center + 5.0f * bsphere.r * trimesh::vec(cos(angle), 0.3f, sin(angle)));
+		}
+		best = std::min(best, float(trimesh::now() - start) / AUTOTUNE_VIEWS);
+	}
+	return best;
+}
+
+static std::string describe(const KernelConfig &config){
+	std::ostringstream s;
+	s << "chunk " << config.chunk_ << ", ";
+	if(config.threads_ == 0){
+		s << "all threads";
+	}
+	else{
+		s << config.threads_ << " thread(s)";
+	}
+	return s.str();
+}
+
+/**
+ * Tune the kernel configuration of one mesh (not its levels of detail)
+ */
+static void autotune_mesh(MeshData* data, const std::vector<Drawer*> &drawers){
+	int nv = data->mesh_->vertices.size();
+	std::string key = tuning_key(data);
+	KernelConfig config;
+	if(read_tuning_cache(key, config)){
+		data->kernel_config_ = config;
+		std::cout << "Kernel configuration for " << nv << " vertices (cached for this host): " << describe(config) << std::endl;
+		return;
+	}
+
+	// a probe instance, with the drawers to time
+	Model* probe = new Model(data);
+	for(unsigned int i = 0; i < drawers.size(); i++){
+		probe->pushDrawer(drawers[i]);
+	}
+	// candidates: serial, half and all threads, times a range of chunk sizes
+	int threads = ThreadPool::getDefault() ? ThreadPool::getDefault()->threads() + 1 : 1;
+	int thread_counts[3] = { 1, std::max(2, threads / 2), 0 };
+	int chunks[4] = { 256, 1024, 4096, 16384 };
+	std::cout << "Autotuning kernels for " << nv << " vertices:" << std::endl;
+	// warm up: the first extraction touches freshly reserved buffers
+	time_extraction(probe);
+	float default_time = 0.0f;
+	float best_time = 1e30f;
+	KernelConfig best;
+	for(int t = 0; t < 3; t++){
+		if(threads == 1 && thread_counts[t] != 1){
+			continue;
+		}
+		if(t == 1 && thread_counts[1] >= threads){
+			continue;
+		}
+		for(int c = 0; c < 4; c++){
+			// with a single chunk, there's no parallelism to split up
+			if(thread_counts[t] != 1 && chunks[c] >= nv && chunks[c] != chunks[0]){
+				continue;
+			}
+			data->kernel_config_ = KernelConfig(chunks[c], thread_counts[t]);
+			float time = time_extraction(probe);
+			std::cout << "   " << describe(data->kernel_config_) << ": " << 1000.0f * time << " ms per extraction" << std::endl;
+			if(chunks[c] == PARALLEL_CHUNK && thread_counts[t] == 0){
+				default_time = time;
+			}
+			if(time < best_time){
+				best_time = time;
+				best = data->kernel_config_;
+			}
+		}
+	}
+	delete probe;
+	data->kernel_config_ = best;
+	std::cout << "Picked " << describe(best) << " (" << 1000.0f * best_time << " ms per extraction";
+	if(default_time > 0.0f){
+		std::cout << ", default " << 1000.0f * default_time << " ms";
+	}
+	std::cout << ")" << std::endl;
+	write_tuning_cache(key, best);
+}
+
+/**
+ * Pick the fastest kernel configuration for a mesh and all of its levels of detail (each one on its own: they differ
+ * in size). Uses the tuning cache where it can, and adds new decisions to it.
+ *
+ * @param data: the mesh data, with the properties the drawers need built
+ * @param drawers: the drawers whose extraction to time
+ */
+void autotune_kernels(MeshData* data, const std::vector<Drawer*> &drawers){
+	for(int l = 0; l < data->levels(); l++){
+		autotune_mesh(data->level(l), drawers);
+	}
+}
+
+/**
+ * Use a fixed kernel configuration for a mesh and its levels of detail, bypassing the autotuning (for reproducible
+ * measurements)
+ *
+ * @param data: the mesh data
+ * @param config: the kernel configuration
+ */
+void force_kernels(MeshData* data, KernelConfig config){
+	for(int l = 0; l < data->levels(); l++){
+		data->level(l)->kernel_config_ = config;
+	}
+	std::cout << "Using forced kernel configuration: " << describe(config) << std::endl;
+}
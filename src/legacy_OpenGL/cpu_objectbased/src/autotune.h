@@ -0,0 +1,31 @@
+/*
+ * Autotuning of the view-dependent vertex kernels.
+ *
+ * How to best split up the per-vertex passes depends on the mesh and on the machine: small meshes run fastest on a
+ * single thread, large ones want as many threads as possible and chunks big enough to keep the scheduling overhead
+ * down. For every mesh (and level of detail), we time a full line extraction under every candidate KernelConfig, and
+ * keep the fastest. Decisions are cached per host, in a text file in the working directory, keyed by the host name,
+ * its number of hardware threads and worker threads, the (power of two) size of the mesh and whether its attributes
+ * are compact, so the next run on the same host skips the timing.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef AUTOTUNE_H_
+#define AUTOTUNE_H_
+
+#include "MeshData.h"
+#include "Drawer.h"
+#include "ThreadPool.h"
+#include <vector>
+
+// the tuning cache, in the working directory
+#define AUTOTUNE_CACHE_FILE "kernel_tuning.txt"
+
+// pick the fastest kernel configuration for extracting lines with the given drawers from a mesh and its levels of
+// detail: the cached one, if this host has tuned a mesh like it before, otherwise by timing the candidates
+void autotune_kernels(MeshData* data, const std::vector<Drawer*> &drawers);
+// use a fixed kernel configuration for a mesh and its levels of detail
+void force_kernels(MeshData* data, KernelConfig config);
+
+#endif /* AUTOTUNE_H_ */
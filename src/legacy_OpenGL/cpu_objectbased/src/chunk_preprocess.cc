@@ -0,0 +1,624 @@
+/*
+ * Out-of-core preprocessing of meshes which don't fit in memory.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "chunk_preprocess.h"
+#include "MappedFile.h"
+#include "MeshParser.h"
+#include "mesh_cache.h"
+#include "mesh_reorder.h"
+#include "curvature.h"
+#include "timestamp.h"
+#include <TriMesh.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iterator>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+// the finest grid faces get binned in: 2^6 = 64 cells along every axis
+#define CHUNK_GRID_LEVELS 6
+
+/**
+ * An array in a memory-mapped scratch file, which gets deleted again when the array is released. The OS pages it in
+ * and out as it gets used, so it doesn't count against the memory budget.
+ */
+template <class T>
+class ScratchArray{
+private:
+	MappedFile file_;
+	std::string filename_;
+	T* data_;
+public:
+	ScratchArray(): data_(0){}
+	~ScratchArray(){
+		release();
+	}
+	bool create(const std::string &filename, size_t count){
+		release();
+		// (a mapping can't be empty)
+		if(!file_.create(filename.c_str(), std::max(count, size_t(1)) * sizeof(T))){
+			return false;
+		}
+		filename_ = filename;
+		data_ = reinterpret_cast<T*>(file_.writableData());
+		return true;
+	}
+	void release(){
+		if(!filename_.empty()){
+			file_.close();
+			remove(filename_.c_str());
+			filename_.clear();
+		}
+		data_ = 0;
+	}
+	T* data(){
+		return data_;
+	}
+	T& operator[](size_t i){
+		return data_[i];
+	}
+};
+
+/**
+ * A chunk: a range of the faces sorted by cell (its own faces), and the size of its local mesh, halo included
+ */
+struct ChunkRange{
+	size_t first_;
+	size_t last_;
+	int nv_;
+	int nf_;
+};
+
+/**
+ * The whole mesh while it gets preprocessed: everything per vertex or per face lives in scratch files
+ */
+struct OutOfCoreMesh{
+	int nv_;
+	int nf_;
+	trimesh::TriMesh::BSphere bsphere_;
+	// the source geometry: the positions are in the parser's mapping of the source file if it stores them like we do,
+	// otherwise in a scratch array
+	MeshParser parser_;
+	const trimesh::point* positions_;
+	ScratchArray<trimesh::point> parsed_positions_;
+	ScratchArray<trimesh::TriMesh::Face> faces_;
+	// the faces sorted by cell, and the chunks as ranges of them
+	ScratchArray<int> sorted_faces_;
+	std::vector<ChunkRange> chunks_;
+	// vertex to face adjacency: the faces around vertex v are adjacent_faces_[adjacency_start_[v]] up to
+	// adjacent_faces_[adjacency_start_[v+1]]
+	ScratchArray<uint64_t> adjacency_start_;
+	ScratchArray<int> adjacent_faces_;
+	// the results, for every vertex
+	ScratchArray<trimesh::vec> normals_;
+	ScratchArray<trimesh::vec> pdir1_;
+	ScratchArray<trimesh::vec> pdir2_;
+	ScratchArray<float> curv1_;
+	ScratchArray<float> curv2_;
+	ScratchArray<trimesh::Vec<4,float> > dcurv_;
+};
+
+/**
+ * The local mesh of a chunk: its own faces followed by its halo, and the vertices of all of those. The vertices of its
+ * own faces have every face around them in the local mesh, so their results are the same as in the whole mesh.
+ */
+struct ChunkMesh{
+	// global indices of the faces: the chunk's own ones first, then its halo
+	std::vector<int> faces_;
+	size_t owned_;
+	// global indices of the vertices, sorted (the local index of a vertex is its position in here)
+	std::vector<int> vertices_;
+	// per local vertex: are all faces around it in the local mesh?
+	std::vector<bool> complete_;
+	// positions and faces, with local vertex indices
+	trimesh::TriMesh* mesh_;
+	ChunkMesh(): owned_(0), mesh_(0){}
+	~ChunkMesh(){
+		delete mesh_;
+	}
+};
+
+enum ChunkPass { CHUNK_PASS_NORMALS, CHUNK_PASS_CURVATURES, CHUNK_PASS_DCURV };
+
+static void report(trimesh::timestamp start){
+	std::cout << "Done (" << int(1000.0f * (trimesh::now() - start)) << " ms)" << std::endl;
+}
+
+static void sort_unique(std::vector<int> &v){
+	std::sort(v.begin(), v.end());
+	v.erase(std::unique(v.begin(), v.end()), v.end());
+}
+
+/**
+ * Read the geometry of a mesh file into scratch arrays.
+ * OBJ and PLY files get parsed straight into the scratch arrays (binary PLY positions may even stay in the file
+ * mapping), so reading stays within the budget. Other files go through TriMesh::read, which holds the whole mesh in
+ * memory while parsing it: for those, the budget only holds from here on.
+ *
+ * @param filename: the mesh file
+ * @param scratch: the prefix for scratch filenames
+ * @param m: the out-of-core mesh, gets its positions and faces
+ * @return false if the file could not be read
+ */
+static bool read_source(const char* filename, const std::string &scratch, OutOfCoreMesh &m){
+	if(m.parser_.open(filename)){
+		m.nv_ = m.parser_.vertices();
+		m.nf_ = m.parser_.faces();
+		const trimesh::point* mapped = m.parser_.mappedVertices();
+		bool ok = m.faces_.create(scratch + ".faces.tmp", m.nf_) && (mapped || m.parsed_positions_.create(scratch + ".positions.tmp", m.nv_));
+		if(ok && m.parser_.parse(mapped ? 0 : m.parsed_positions_.data(), m.faces_.data())){
+			m.positions_ = mapped ? mapped : m.parsed_positions_.data();
+			return m.nv_ > 0 && m.nf_ > 0;
+		}
+		m.parser_.close();
+	}
+	trimesh::TriMesh* mesh = trimesh::TriMesh::read(filename);
+	if(!mesh){
+		return false;
+	}
+	// TriMesh2 reads some formats as triangle strips
+	mesh->need_faces();
+	m.nv_ = mesh->vertices.size();
+	m.nf_ = mesh->faces.size();
+	bool ok = m.parsed_positions_.create(scratch + ".positions.tmp", m.nv_) && m.faces_.create(scratch + ".faces.tmp", m.nf_);
+	if(ok){
+		std::copy(mesh->vertices.begin(), mesh->vertices.end(), m.parsed_positions_.data());
+		std::copy(mesh->faces.begin(), mesh->faces.end(), m.faces_.data());
+		m.positions_ = m.parsed_positions_.data();
+	}
+	delete mesh;
+	return ok && m.nv_ > 0 && m.nf_ > 0;
+}
+
+/**
+ * Compute the bounding sphere of the whole mesh: around the center of its bounding box
+ */
+static void compute_bsphere(OutOfCoreMesh &m){
+	trimesh::point boxmin(1e38f, 1e38f, 1e38f);
+	trimesh::point boxmax(-1e38f, -1e38f, -1e38f);
+	for(int i = 0; i < m.nv_; i++){
+		for(int j = 0; j < 3; j++){
+			boxmin[j] = std::min(boxmin[j], m.positions_[i][j]);
+			boxmax[j] = std::max(boxmax[j], m.positions_[i][j]);
+		}
+	}
+	m.bsphere_.center = 0.5f * (boxmin + boxmax);
+	float r2 = 0.0f;
+	for(int i = 0; i < m.nv_; i++){
+		r2 = std::max(r2, dist2(m.positions_[i], m.bsphere_.center));
+	}
+	m.bsphere_.r = sqrt(r2);
+	m.bsphere_.valid = true;
+}
+
+/**
+ * Partition the faces into chunks of at most a given number of faces. Faces get binned by the Morton code of their
+ * centroid on a grid fine enough to give every chunk a few cells (sorted with a counting sort), then runs of cells
+ * get grouped into chunks: neighbouring cells along the Morton curve are close together, so chunks are compact.
+ *
+ * @param m: the out-of-core mesh
+ * @param scratch: the prefix for scratch filenames
+ * @param chunk_faces: the maximal number of faces of a chunk (halo not included)
+ */
+static bool partition(OutOfCoreMesh &m, const std::string &scratch, size_t chunk_faces){
+	size_t wanted = (m.nf_ + chunk_faces - 1) / chunk_faces;
+	int levels = 0;
+	while(levels < CHUNK_GRID_LEVELS && (size_t(1) << (3 * levels)) < 8 * wanted){
+		levels++;
+	}
+	int cells = 1 << (3 * levels);
+	int shift = 30 - 3 * levels;
+	// count the faces in every cell, then put them in cell order
+	std::vector<size_t> cell_start(cells + 1, 0);
+	for(int f = 0; f < m.nf_; f++){
+		const trimesh::TriMesh::Face &face = m.faces_[f];
+		trimesh::point centroid = (m.positions_[face[0]] + m.positions_[face[1]] + m.positions_[face[2]]) / 3.0f;
+		cell_start[(morton_code(centroid, m.bsphere_) >> shift) + 1]++;
+	}
+	for(int c = 0; c < cells; c++){
+		cell_start[c + 1] += cell_start[c];
+	}
+	if(!m.sorted_faces_.create(scratch + ".sorted.tmp", m.nf_)){
+		return false;
+	}
+	std::vector<size_t> next(cell_start.begin(), cell_start.end() - 1);
+	for(int f = 0; f < m.nf_; f++){
+		const trimesh::TriMesh::Face &face = m.faces_[f];
+		trimesh::point centroid = (m.positions_[face[0]] + m.positions_[face[1]] + m.positions_[face[2]]) / 3.0f;
+		m.sorted_faces_[next[morton_code(centroid, m.bsphere_) >> shift]++] = f;
+	}
+	// group runs of cells into chunks
+	ChunkRange chunk;
+	chunk.first_ = 0;
+	chunk.nv_ = chunk.nf_ = 0;
+	for(int c = 0; c < cells; c++){
+		if(cell_start[c] > chunk.first_ && cell_start[c + 1] - chunk.first_ > chunk_faces){
+			chunk.last_ = cell_start[c];
+			m.chunks_.push_back(chunk);
+			chunk.first_ = cell_start[c];
+		}
+		// a cell which is too large on its own gets cut in pieces
+		while(cell_start[c + 1] - chunk.first_ > chunk_faces){
+			chunk.last_ = chunk.first_ + chunk_faces;
+			m.chunks_.push_back(chunk);
+			chunk.first_ = chunk.last_;
+		}
+	}
+	if(chunk.first_ < size_t(m.nf_)){
+		chunk.last_ = m.nf_;
+		m.chunks_.push_back(chunk);
+	}
+	return true;
+}
+
+/**
+ * Build the vertex to face adjacency (in compressed rows: all faces around vertex 0, then around vertex 1, ...)
+ */
+static bool build_adjacency(OutOfCoreMesh &m, const std::string &scratch){
+	if(!m.adjacency_start_.create(scratch + ".adjacency_start.tmp", size_t(m.nv_) + 1)
+			|| !m.adjacent_faces_.create(scratch + ".adjacency.tmp", 3 * size_t(m.nf_))){
+		return false;
+	}
+	// count the faces around every vertex (the scratch file starts out zeroed)
+	for(int f = 0; f < m.nf_; f++){
+		for(int j = 0; j < 3; j++){
+			m.adjacency_start_[m.faces_[f][j] + 1]++;
+		}
+	}
+	for(int v = 0; v < m.nv_; v++){
+		m.adjacency_start_[v + 1] += m.adjacency_start_[v];
+	}
+	// fill the rows, using the row starts as cursors, then shift them back
+	for(int f = 0; f < m.nf_; f++){
+		for(int j = 0; j < 3; j++){
+			m.adjacent_faces_[m.adjacency_start_[m.faces_[f][j]]++] = f;
+		}
+	}
+	for(int v = m.nv_; v > 0; v--){
+		m.adjacency_start_[v] = m.adjacency_start_[v - 1];
+	}
+	m.adjacency_start_[0] = 0;
+	return true;
+}
+
+/**
+ * Build the local mesh of a chunk: its own faces, the halo around them, and the vertices of both
+ *
+ * @param m: the out-of-core mesh
+ * @param range: the chunk
+ * @param chunk: the local mesh to fill
+ */
+static void gather_chunk(OutOfCoreMesh &m, const ChunkRange &range, ChunkMesh &chunk){
+	chunk.faces_.assign(m.sorted_faces_.data() + range.first_, m.sorted_faces_.data() + range.last_);
+	chunk.owned_ = chunk.faces_.size();
+	// the vertices of the chunk's own faces
+	std::vector<int> own_vertices;
+	own_vertices.reserve(3 * chunk.owned_);
+	for(size_t i = 0; i < chunk.owned_; i++){
+		const trimesh::TriMesh::Face &f = m.faces_[chunk.faces_[i]];
+		own_vertices.push_back(f[0]);
+		own_vertices.push_back(f[1]);
+		own_vertices.push_back(f[2]);
+	}
+	sort_unique(own_vertices);
+	// the halo: all other faces around those vertices
+	std::vector<int> around;
+	for(size_t i = 0; i < own_vertices.size(); i++){
+		int v = own_vertices[i];
+		around.insert(around.end(), m.adjacent_faces_.data() + m.adjacency_start_[v], m.adjacent_faces_.data() + m.adjacency_start_[v + 1]);
+	}
+	sort_unique(around);
+	std::vector<int> owned(chunk.faces_);
+	std::sort(owned.begin(), owned.end());
+	std::set_difference(around.begin(), around.end(), owned.begin(), owned.end(), std::back_inserter(chunk.faces_));
+	// the vertices of all faces
+	chunk.vertices_.clear();
+	for(size_t i = 0; i < chunk.faces_.size(); i++){
+		const trimesh::TriMesh::Face &f = m.faces_[chunk.faces_[i]];
+		chunk.vertices_.push_back(f[0]);
+		chunk.vertices_.push_back(f[1]);
+		chunk.vertices_.push_back(f[2]);
+	}
+	sort_unique(chunk.vertices_);
+	int nv = chunk.vertices_.size();
+	chunk.complete_.assign(nv, false);
+	for(int i = 0; i < nv; i++){
+		chunk.complete_[i] = std::binary_search(own_vertices.begin(), own_vertices.end(), chunk.vertices_[i]);
+	}
+	// the local mesh
+	delete chunk.mesh_;
+	chunk.mesh_ = new trimesh::TriMesh();
+	trimesh::TriMesh* mesh = chunk.mesh_;
+	mesh->vertices.resize(nv);
+	for(int i = 0; i < nv; i++){
+		mesh->vertices[i] = m.positions_[chunk.vertices_[i]];
+	}
+	mesh->faces.resize(chunk.faces_.size());
+	for(size_t i = 0; i < chunk.faces_.size(); i++){
+		const trimesh::TriMesh::Face &f = m.faces_[chunk.faces_[i]];
+		for(int j = 0; j < 3; j++){
+			mesh->faces[i][j] = int(std::lower_bound(chunk.vertices_.begin(), chunk.vertices_.end(), f[j]) - chunk.vertices_.begin());
+		}
+	}
+}
+
+/**
+ * Run one preprocessing pass on a chunk: compute normals, curvatures or curvature derivatives on its local mesh (the
+ * earlier passes' results come from the whole mesh, for the halo too), and keep the results of the vertices whose
+ * neighbourhood is complete.
+ *
+ * @param m: the out-of-core mesh
+ * @param chunk: the local mesh of the chunk
+ * @param pass: the pass
+ */
+static void process_chunk(OutOfCoreMesh &m, ChunkMesh &chunk, ChunkPass pass){
+	trimesh::TriMesh* mesh = chunk.mesh_;
+	int nv = chunk.vertices_.size();
+	if(pass == CHUNK_PASS_NORMALS){
+		mesh->need_normals();
+		for(int i = 0; i < nv; i++){
+			if(chunk.complete_[i]){
+				m.normals_[chunk.vertices_[i]] = mesh->normals[i];
+			}
+		}
+		return;
+	}
+	mesh->normals.resize(nv);
+	for(int i = 0; i < nv; i++){
+		mesh->normals[i] = m.normals_[chunk.vertices_[i]];
+	}
+	FaceColoring coloring;
+	color_faces(mesh, coloring);
+	if(pass == CHUNK_PASS_CURVATURES){
+		compute_curvatures(mesh, coloring);
+		for(int i = 0; i < nv; i++){
+			if(chunk.complete_[i]){
+				int v = chunk.vertices_[i];
+				m.pdir1_[v] = mesh->pdir1[i];
+				m.pdir2_[v] = mesh->pdir2[i];
+				m.curv1_[v] = mesh->curv1[i];
+				m.curv2_[v] = mesh->curv2[i];
+			}
+		}
+		return;
+	}
+	mesh->pdir1.resize(nv);
+	mesh->pdir2.resize(nv);
+	mesh->curv1.resize(nv);
+	mesh->curv2.resize(nv);
+	for(int i = 0; i < nv; i++){
+		int v = chunk.vertices_[i];
+		mesh->pdir1[i] = m.pdir1_[v];
+		mesh->pdir2[i] = m.pdir2_[v];
+		mesh->curv1[i] = m.curv1_[v];
+		mesh->curv2[i] = m.curv2_[v];
+	}
+	compute_pointareas(mesh, coloring);
+	compute_dcurv(mesh, coloring);
+	for(int i = 0; i < nv; i++){
+		if(chunk.complete_[i]){
+			m.dcurv_[chunk.vertices_[i]] = mesh->dcurv[i];
+		}
+	}
+}
+
+/**
+ * Run a preprocessing pass over all chunks, one chunk at a time
+ */
+static void run_pass(OutOfCoreMesh &m, ChunkPass pass, const char* label){
+	std::cout << "Computing " << label << " of " << m.chunks_.size() << " chunks... ";
+	trimesh::timestamp start = trimesh::now();
+	ChunkMesh chunk;
+	for(unsigned int c = 0; c < m.chunks_.size(); c++){
+		gather_chunk(m, m.chunks_[c], chunk);
+		process_chunk(m, chunk, pass);
+		m.chunks_[c].nv_ = chunk.vertices_.size();
+		m.chunks_[c].nf_ = chunk.faces_.size();
+	}
+	report(start);
+}
+
+/**
+ * Estimate the feature size of the whole mesh from a sample of its curvatures (the same estimate as
+ * computeFeatureSize, see mesh_info.h)
+ */
+static float feature_size(OutOfCoreMesh &m){
+	int nsamp = std::min(m.nv_, 500);
+	std::vector<float> samples;
+	samples.reserve(nsamp * 2);
+	unsigned randq = 0;
+	for(int i = 0; i < nsamp; i++){
+		randq = unsigned(1664525) * randq + unsigned(1013904223);
+		int ind = randq % m.nv_;
+		samples.push_back(fabs(m.curv1_[ind]));
+		samples.push_back(fabs(m.curv2_[ind]));
+	}
+	const float frac = 0.1f;
+	const float mult = 0.01f;
+	float max_feature_size = 0.05f * m.bsphere_.r;
+	int which = int(frac * samples.size());
+	std::nth_element(samples.begin(), samples.begin() + which, samples.end());
+	return std::min(mult / samples[which], max_feature_size);
+}
+
+/**
+ * Copy a per-vertex array of the whole mesh into a chunk's array in the store
+ */
+template <class T>
+static void store_vertex_array(char* file, const ChunkRecord &record, int a, const ChunkMesh &chunk, ScratchArray<T> &values){
+	T* out = reinterpret_cast<T*>(file + record.offset[a]);
+	for(size_t i = 0; i < chunk.vertices_.size(); i++){
+		out[i] = values[chunk.vertices_[i]];
+	}
+}
+
+/**
+ * Write the chunk store: every chunk's local mesh, with the results for all of its vertices
+ *
+ * @param filename: the store file
+ * @param m: the preprocessed out-of-core mesh
+ * @param source: content hash, size and modification time of the source mesh file
+ * @param feature: the feature size of the whole mesh
+ * @return false if the store could not be written
+ */
+static bool write_store(const std::string &filename, OutOfCoreMesh &m, const MeshSource &source, float feature){
+	std::cout << "Writing chunk store " << filename << "... ";
+	trimesh::timestamp start = trimesh::now();
+	// lay out the header, the chunk table, and the arrays of every chunk (the passes recorded their sizes)
+	uint32_t chunks = m.chunks_.size();
+	std::vector<ChunkRecord> table(chunks);
+	uint64_t table_offset = (sizeof(ChunkStoreHeader) + CHUNK_STORE_ALIGNMENT - 1) / CHUNK_STORE_ALIGNMENT * CHUNK_STORE_ALIGNMENT;
+	uint64_t offset = table_offset + chunks * sizeof(ChunkRecord);
+	for(uint32_t c = 0; c < chunks; c++){
+		memset(&table[c], 0, sizeof(ChunkRecord));
+		table[c].nv = m.chunks_[c].nv_;
+		table[c].nf = m.chunks_[c].nf_;
+		table[c].owned_faces = uint32_t(m.chunks_[c].last_ - m.chunks_[c].first_);
+		for(int a = 0; a < CHUNK_ARRAY_COUNT; a++){
+			offset = (offset + CHUNK_STORE_ALIGNMENT - 1) / CHUNK_STORE_ALIGNMENT * CHUNK_STORE_ALIGNMENT;
+			table[c].offset[a] = offset;
+			offset += chunk_array_bytes(a, table[c].nv, table[c].nf);
+		}
+	}
+	MappedFile out;
+	if(!out.create(filename.c_str(), offset)){
+		std::cout << "Failed" << std::endl;
+		return false;
+	}
+	char* file = out.writableData();
+	// fill in every chunk
+	ChunkMesh chunk;
+	for(uint32_t c = 0; c < chunks; c++){
+		gather_chunk(m, m.chunks_[c], chunk);
+		ChunkRecord &record = table[c];
+		const trimesh::TriMesh* mesh = chunk.mesh_;
+		std::copy(mesh->vertices.begin(), mesh->vertices.end(), reinterpret_cast<trimesh::point*>(file + record.offset[CHUNK_POSITIONS]));
+		std::copy(mesh->faces.begin(), mesh->faces.end(), reinterpret_cast<trimesh::TriMesh::Face*>(file + record.offset[CHUNK_FACES]));
+		store_vertex_array(file, record, CHUNK_NORMALS, chunk, m.normals_);
+		store_vertex_array(file, record, CHUNK_PDIR1, chunk, m.pdir1_);
+		store_vertex_array(file, record, CHUNK_PDIR2, chunk, m.pdir2_);
+		store_vertex_array(file, record, CHUNK_CURV1, chunk, m.curv1_);
+		store_vertex_array(file, record, CHUNK_CURV2, chunk, m.curv2_);
+		store_vertex_array(file, record, CHUNK_DCURV, chunk, m.dcurv_);
+		// bounding sphere of the chunk, around the center of its bounding box
+		trimesh::point boxmin(1e38f, 1e38f, 1e38f);
+		trimesh::point boxmax(-1e38f, -1e38f, -1e38f);
+		for(size_t i = 0; i < mesh->vertices.size(); i++){
+			for(int j = 0; j < 3; j++){
+				boxmin[j] = std::min(boxmin[j], mesh->vertices[i][j]);
+				boxmax[j] = std::max(boxmax[j], mesh->vertices[i][j]);
+			}
+		}
+		trimesh::point center = 0.5f * (boxmin + boxmax);
+		float r2 = 0.0f;
+		for(size_t i = 0; i < mesh->vertices.size(); i++){
+			r2 = std::max(r2, dist2(mesh->vertices[i], center));
+		}
+		for(int j = 0; j < 3; j++){
+			record.bsphere[j] = center[j];
+		}
+		record.bsphere[3] = sqrt(r2);
+	}
+	memcpy(file + table_offset, &table[0], chunks * sizeof(ChunkRecord));
+	// the header goes last, its magic at the very end, so an interrupted build never looks complete
+	ChunkStoreHeader header;
+	memset(&header, 0, sizeof(header));
+	header.version = CHUNK_STORE_VERSION;
+	header.header_size = sizeof(ChunkStoreHeader);
+	header.source_hash = source.hash;
+	header.source_size = source.size;
+	header.source_mtime = source.mtime;
+	header.nv = m.nv_;
+	header.nf = m.nf_;
+	header.chunks = chunks;
+	header.feature_size = feature;
+	header.bsphere[0] = m.bsphere_.center[0];
+	header.bsphere[1] = m.bsphere_.center[1];
+	header.bsphere[2] = m.bsphere_.center[2];
+	header.bsphere[3] = m.bsphere_.r;
+	header.table_offset = table_offset;
+	memcpy(file, &header, sizeof(header));
+	memcpy(file, CHUNK_STORE_MAGIC, 8);
+	out.close();
+	report(start);
+	return true;
+}
+
+/**
+ * Build the chunk store of a mesh file, unless there's an up-to-date one already, and open it. The mesh gets
+ * partitioned into chunks which fit the memory budget, and normals, curvatures and curvature derivatives are computed
+ * one chunk at a time (each on all threads), with intermediate results in memory-mapped scratch files.
+ *
+ * @param mesh_filename: the source mesh file
+ * @param budget: the memory budget for preprocessing, in bytes
+ * @param store: the store to open
+ * @return false if the mesh could not be read or the store could not be written
+ */
+bool build_chunk_store(const char* mesh_filename, size_t budget, ChunkStore &store){
+	MeshSource source;
+	if(!stat_mesh_file(mesh_filename, source)){
+		std::cout << "Could not read " << mesh_filename << std::endl;
+		return false;
+	}
+	std::string filename = chunk_store_filename(mesh_filename);
+	if(store.open(mesh_filename, source)){
+		std::cout << "Loaded chunk store " << filename << ": " << store.chunks() << " chunks" << std::endl;
+		return true;
+	}
+	trimesh::timestamp total = trimesh::now();
+	OutOfCoreMesh m;
+	std::cout << "Reading " << mesh_filename << " into scratch files... ";
+	trimesh::timestamp start = trimesh::now();
+	if(!read_source(mesh_filename, filename, m)){
+		std::cout << "Failed" << std::endl;
+		return false;
+	}
+	report(start);
+	compute_bsphere(m);
+
+	size_t chunk_faces = std::max(size_t(CHUNK_MIN_FACES), budget / CHUNK_PREPROCESS_BYTES_PER_FACE);
+	std::cout << "Partitioning " << m.nf_ << " faces in chunks of up to " << chunk_faces << " faces (budget "
+			<< budget / (1024 * 1024) << " MB)... ";
+	start = trimesh::now();
+	if(!partition(m, filename, chunk_faces) || !build_adjacency(m, filename)){
+		std::cout << "Failed" << std::endl;
+		return false;
+	}
+	report(start);
+
+	if(!m.normals_.create(filename + ".normals.tmp", m.nv_) || !m.pdir1_.create(filename + ".pdir1.tmp", m.nv_)
+			|| !m.pdir2_.create(filename + ".pdir2.tmp", m.nv_) || !m.curv1_.create(filename + ".curv1.tmp", m.nv_)
+			|| !m.curv2_.create(filename + ".curv2.tmp", m.nv_) || !m.dcurv_.create(filename + ".dcurv.tmp", m.nv_)){
+		std::cout << "Could not create scratch files next to " << filename << std::endl;
+		return false;
+	}
+	run_pass(m, CHUNK_PASS_NORMALS, "normals");
+	run_pass(m, CHUNK_PASS_CURVATURES, "curvatures");
+	run_pass(m, CHUNK_PASS_DCURV, "curvature derivatives");
+	float feature = feature_size(m);
+
+	int largest = 0;
+	for(unsigned int c = 0; c < m.chunks_.size(); c++){
+		largest = std::max(largest, m.chunks_[c].nf_);
+	}
+	std::cout << "Largest chunk: " << largest << " faces (halo included), about "
+			<< size_t(largest) * CHUNK_PREPROCESS_BYTES_PER_FACE / (1024 * 1024) << " MB of working memory" << std::endl;
+	// (the store gets the content hash, for when the source only gets touched later on)
+	uint64_t size;
+	if(source.hash == 0 && !hash_mesh_file(mesh_filename, source.hash, size)){
+		std::cout << "Could not read " << mesh_filename << std::endl;
+		return false;
+	}
+	if(!write_store(filename, m, source, feature) || !store.open(mesh_filename, source)){
+		std::cout << "Could not write chunk store " << filename << std::endl;
+		return false;
+	}
+	std::cout << "Out-of-core preprocessing of " << mesh_filename << " took " << int(1000.0f * (trimesh::now() - total)) << " ms" << std::endl;
+	return true;
+}
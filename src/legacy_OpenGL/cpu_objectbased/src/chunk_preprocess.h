@@ -0,0 +1,34 @@
+/*
+ * Out-of-core preprocessing of meshes which don't fit in memory.
+ *
+ * The mesh gets partitioned spatially: faces are binned by their centroid into a grid of cells, cells are walked in
+ * Morton order and grouped into chunks of about as many faces as fit the memory budget (cells which are too large on
+ * their own get cut up). Every chunk is then processed on its own, as a small mesh of its own faces plus the ring of
+ * faces around their vertices (its halo), so the vertices of its own faces see their whole neighbourhood and get the
+ * same normals, curvatures and curvature derivatives as in the whole mesh. That takes three passes over the chunks,
+ * since every step needs the previous one's results on the halo as well: normals, then curvatures, then their
+ * derivatives. In between, results live in per-vertex arrays in memory-mapped scratch files, next to the source
+ * geometry and the vertex-to-face adjacency, which the OS pages in and out as the chunks need them.
+ *
+ * Only one chunk is in memory at a time (and processed by all threads), so the working set stays within the budget
+ * however large the mesh is. The result is a ChunkStore (see ChunkStore.h), which the viewer pages in per chunk.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef CHUNK_PREPROCESS_H_
+#define CHUNK_PREPROCESS_H_
+
+#include <cstddef>
+#include "ChunkStore.h"
+
+// estimated working memory per face of a chunk while preprocessing it: the local mesh with all its attributes, the
+// face coloring and the halo bookkeeping
+#define CHUNK_PREPROCESS_BYTES_PER_FACE 256
+// don't cut chunks smaller than this, however small the budget
+#define CHUNK_MIN_FACES 4096
+
+// build the chunk store of a mesh file (unless there's an up-to-date one) within a memory budget in bytes, and open it
+bool build_chunk_store(const char* mesh_filename, size_t budget, ChunkStore &store);
+
+#endif /* CHUNK_PREPROCESS_H_ */
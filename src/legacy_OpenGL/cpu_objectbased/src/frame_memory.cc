@@ -0,0 +1,124 @@
+/*
+ * Implementation of the per-frame buffer memory and the debug heap allocation counter.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "frame_memory.h"
+#include <atomic>
+#include <cstdlib>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+// buffers smaller than this come from the regular heap, bigger ones are mapped from the OS
+static const size_t MAPPED_THRESHOLD = 64 * 1024;
+// buffers of at least this size are worth backing with (2 MB) huge pages
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+static std::atomic<size_t> allocations(0);
+static bool huge_pages = false;
+
+/**
+ * Allocate memory for a per-frame buffer
+ *
+ * @param bytes: the size of the buffer
+ */
+void* frame_alloc(size_t bytes){
+	allocations++;
+	if(bytes < MAPPED_THRESHOLD){
+		void* p = malloc(bytes ? bytes : 1);
+		if(!p){
+			throw std::bad_alloc();
+		}
+		return p;
+	}
+#ifdef _WIN32
+	// large pages on Windows need SeLockMemoryPrivilege and get pinned immediately, so we stick to regular pages
+	void* p = VirtualAlloc(0, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	if(!p){
+		throw std::bad_alloc();
+	}
+#else
+	void* p = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if(p == MAP_FAILED){
+		throw std::bad_alloc();
+	}
+#ifdef MADV_HUGEPAGE
+	if(bytes >= HUGE_PAGE_SIZE && madvise(p, bytes, MADV_HUGEPAGE) == 0){
+		huge_pages = true;
+	}
+#endif
+#endif
+	return p;
+}
+
+/**
+ * Release memory allocated by frame_alloc
+ *
+ * @param p: the buffer
+ * @param bytes: the size the buffer was allocated with
+ */
+void frame_free(void* p, size_t bytes){
+	if(!p){
+		return;
+	}
+	if(bytes < MAPPED_THRESHOLD){
+		free(p);
+		return;
+	}
+#ifdef _WIN32
+	VirtualFree(p, 0, MEM_RELEASE);
+#else
+	munmap(p, bytes);
+#endif
+}
+
+/**
+ * Returns whether any per-frame buffer got backed by huge pages
+ */
+bool frame_memory_huge_pages(){
+	return huge_pages;
+}
+
+/**
+ * Returns the number of heap allocations so far (per-frame buffers included).
+ * Only counts operator new in debug builds.
+ */
+size_t heap_allocation_count(){
+	return allocations;
+}
+
+#ifdef _DEBUG
+// count every allocation going through operator new
+void* operator new(size_t bytes){
+	allocations++;
+	void* p = malloc(bytes ? bytes : 1);
+	if(!p){
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[](size_t bytes){
+	return operator new(bytes);
+}
+
+void operator delete(void* p) noexcept{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept{
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept{
+	free(p);
+}
+#endif
@@ -0,0 +1,58 @@
+/*
+ * Memory for per-frame buffers (view-dependent arrays, extracted segments, scratch space).
+ *
+ * These buffers are owned by a Model and keep their capacity between frames, so once they have been sized, the
+ * frame loop does not allocate anymore. Big buffers are mapped straight from the OS, using huge pages when available,
+ * and are only backed by physical memory once they get touched.
+ *
+ * In debug builds, every heap allocation is counted, so the viewer can check that a steady-state frame allocates nothing.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef FRAME_MEMORY_H_
+#define FRAME_MEMORY_H_
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+void* frame_alloc(size_t bytes);
+void frame_free(void* p, size_t bytes);
+bool frame_memory_huge_pages();
+size_t heap_allocation_count();
+
+/**
+ * STL allocator for per-frame buffers. Elements are default-initialized, so resizing a buffer of floats does not
+ * touch (and therefore does not commit) its memory.
+ */
+template <class T>
+class FrameAllocator
+{
+public:
+	typedef T value_type;
+	FrameAllocator(){}
+	template <class U> FrameAllocator(const FrameAllocator<U>&){}
+	T* allocate(size_t n){
+		return static_cast<T*>(frame_alloc(n * sizeof(T)));
+	}
+	void deallocate(T* p, size_t n){
+		frame_free(p, n * sizeof(T));
+	}
+	template <class U> void construct(U* p){
+		::new(static_cast<void*>(p)) U;
+	}
+	template <class U, class... Args> void construct(U* p, Args&&... args){
+		::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+	}
+	template <class U> struct rebind { typedef FrameAllocator<U> other; };
+};
+
+template <class T, class U> bool operator==(const FrameAllocator<T>&, const FrameAllocator<U>&){ return true; }
+template <class T, class U> bool operator!=(const FrameAllocator<T>&, const FrameAllocator<U>&){ return false; }
+
+// a vector backed by frame memory
+template <class T> using FrameVector = std::vector<T, FrameAllocator<T> >;
+
+#endif /* FRAME_MEMORY_H_ */
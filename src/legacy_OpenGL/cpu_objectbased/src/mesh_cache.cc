@@ -0,0 +1,346 @@
+/*
+ * Implementation of the binary cache for preprocessed meshes.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "mesh_cache.h"
+#include "MeshData.h"
+#include "MappedFile.h"
+#include <cstring>
+#include <cstdio>
+#include <cstddef>
+#include <sys/stat.h>
+
+static const char MESH_CACHE_MAGIC[8] = "SCCACHE";
+static const uint64_t MESH_CACHE_ALIGNMENT = 64;
+
+// hash the source even when its size and modification time match the cache's?
+static bool verify_sources = false;
+
+/**
+ * Returns the filename of the cache sidecar for a given mesh file
+ *
+ * @param mesh_filename: the source mesh file
+ */
+std::string mesh_cache_filename(const char* mesh_filename){
+	return std::string(mesh_filename) + ".sccache";
+}
+
+/**
+ * Have every cache check (mesh caches and chunk stores) hash its source mesh file, even when the file's size and
+ * modification time match the ones recorded in the cache
+ *
+ * @param verify: true to always hash
+ */
+void set_mesh_cache_verify(bool verify){
+	verify_sources = verify;
+}
+
+/**
+ * Get the size and modification time of a mesh file, without reading it (the hash is left at 0)
+ *
+ * @param mesh_filename: the source mesh file
+ * @param source: the result
+ * @return false if the file does not exist
+ */
+bool stat_mesh_file(const char* mesh_filename, MeshSource &source){
+#ifdef _WIN32
+	struct _stat64 st;
+	if(_stat64(mesh_filename, &st) != 0){
+		return false;
+	}
+#else
+	struct stat st;
+	if(stat(mesh_filename, &st) != 0){
+		return false;
+	}
+#endif
+	source.hash = 0;
+	source.size = uint64_t(st.st_size);
+	source.mtime = uint64_t(st.st_mtime);
+	return true;
+}
+
+/**
+ * Compute a content hash of a mesh file. Works on 64-bit words, so it runs at memory bandwidth.
+ *
+ * @param mesh_filename: the source mesh file
+ * @param hash: the resulting hash
+ * @param size: the size of the file
+ * @return false if the file could not be read
+ */
+bool hash_mesh_file(const char* mesh_filename, uint64_t &hash, uint64_t &size){
+	MappedFile file;
+	if(!file.open(mesh_filename)){
+		return false;
+	}
+	const char* data = file.data();
+	size = file.size();
+	uint64_t h = 14695981039346656037ULL ^ size;
+	size_t i = 0;
+	for(; i + 8 <= size; i += 8){
+		uint64_t w;
+		memcpy(&w, data + i, 8);
+		h = (h ^ w) * 1099511628211ULL;
+		h ^= h >> 32;
+	}
+	for(; i < size; i++){
+		h = (h ^ (unsigned char) data[i]) * 1099511628211ULL;
+	}
+	hash = h;
+	return true;
+}
+
+/**
+ * Check whether a source mesh file is the one a cache got built from. A different size means it isn't. The same size
+ * and modification time mean it is, without reading it (unless verification was requested). Otherwise the file gets
+ * hashed and its hash compared to the cached one: when only the modification time changed, the cache should get the
+ * new one (restamp), so the next check doesn't hash again.
+ *
+ * @param mesh_filename: the source mesh file
+ * @param source: its size and modification time (see stat_mesh_file), gets the hash if it had to be computed
+ * @param cached_hash, cached_size, cached_mtime: what the cache recorded of its source
+ * @param restamp: set to true if the cache is valid but recorded another modification time
+ * @return true if the cache is valid for this file
+ */
+bool mesh_source_unchanged(const char* mesh_filename, MeshSource &source, uint64_t cached_hash, uint64_t cached_size, uint64_t cached_mtime, bool &restamp){
+	restamp = false;
+	if(source.size != cached_size){
+		return false;
+	}
+	if(source.mtime == cached_mtime && !verify_sources){
+		source.hash = cached_hash;
+		return true;
+	}
+	uint64_t size;
+	if(!hash_mesh_file(mesh_filename, source.hash, size) || source.hash != cached_hash){
+		return false;
+	}
+	restamp = source.mtime != cached_mtime;
+	return true;
+}
+
+/**
+ * Overwrite the modification time of the source recorded in a cache file's header
+ *
+ * @param filename: the cache file
+ * @param offset: byte offset of the modification time in its header
+ * @param mtime: the source's modification time
+ * @return true if it was written
+ */
+bool restamp_cache_file(const std::string &filename, size_t offset, uint64_t mtime){
+	FILE* f = fopen(filename.c_str(), "r+b");
+	if(!f){
+		return false;
+	}
+	bool ok = fseek(f, long(offset), SEEK_SET) == 0 && fwrite(&mtime, sizeof(mtime), 1, f) == 1;
+	return (fclose(f) == 0) && ok;
+}
+
+// raw view on a mesh vector
+template <class T>
+static size_t raw_array(const std::vector<T> &v, const void* &data){
+	data = v.empty() ? 0 : &v[0];
+	return v.size() * sizeof(T);
+}
+
+// the arrays we store
+static size_t array_bytes(const trimesh::TriMesh* mesh, const std::vector<trimesh::vec> &facenormals, const CornerTable &corners, int a, const void* &data){
+	switch(a){
+	case CACHE_POSITIONS: return raw_array(mesh->vertices, data);
+	case CACHE_NORMALS: return raw_array(mesh->normals, data);
+	case CACHE_PDIR1: return raw_array(mesh->pdir1, data);
+	case CACHE_PDIR2: return raw_array(mesh->pdir2, data);
+	case CACHE_CURV1: return raw_array(mesh->curv1, data);
+	case CACHE_CURV2: return raw_array(mesh->curv2, data);
+	case CACHE_DCURV: return raw_array(mesh->dcurv, data);
+	case CACHE_FACES: return raw_array(mesh->faces, data);
+	case CACHE_OPPOSITE: return raw_array(corners.opposite_, data);
+	case CACHE_VERTEX_CORNER: return raw_array(corners.vertex_corner_, data);
+	case CACHE_TSTRIPS: return raw_array(mesh->tstrips, data);
+	case CACHE_FACENORMALS: return raw_array(facenormals, data);
+	}
+	data = 0;
+	return 0;
+}
+
+/**
+ * Check the byte size of a cached array: count elements of the vector's type, or none if the array is optional (its
+ * property hasn't been built)
+ */
+template <class T>
+static bool array_fits(const MeshCacheHeader &header, int a, uint64_t count, bool optional, const std::vector<T> &){
+	return header.bytes[a] == count * sizeof(T) || (optional && header.bytes[a] == 0);
+}
+
+/**
+ * Copy an array out of the mapped cache file into a mesh vector
+ */
+template <class T>
+static void load_array(const MappedFile &file, const MeshCacheHeader &header, int a, std::vector<T> &v){
+	const T* begin = reinterpret_cast<const T*>(file.data() + header.offset[a]);
+	v.assign(begin, begin + header.bytes[a] / sizeof(T));
+}
+
+/**
+ * The MeshProperty mask of what a mesh's cache sidecar holds, from its header only (without checking whether it's up
+ * to date)
+ *
+ * @param mesh_filename: the source mesh file
+ * @return the mask, 0 if there is no cache
+ */
+unsigned int cached_mesh_properties(const char* mesh_filename){
+	MappedFile file;
+	if(!file.open(mesh_cache_filename(mesh_filename).c_str()) || file.size() < sizeof(MeshCacheHeader)){
+		return 0;
+	}
+	const MeshCacheHeader* header = reinterpret_cast<const MeshCacheHeader*>(file.data());
+	if(memcmp(header->magic, MESH_CACHE_MAGIC, 8) != 0 || header->version != MESH_CACHE_VERSION){
+		return 0;
+	}
+	return header->properties;
+}
+
+/**
+ * Read a preprocessed mesh from its cache sidecar, if there is a valid one
+ *
+ * @param mesh_filename: the source mesh file
+ * @param source: size and modification time of the source mesh file, gets the content hash the cache recorded
+ * @param mesh: the (empty) mesh to fill
+ * @param facenormals: the vector to store face normals in
+ * @param corners: the corner table to fill
+ * @param feature_size: the cached feature size
+ * @param properties: the MeshProperty mask of the cached data
+ * @return true if a valid cache was found and loaded
+ */
+bool read_mesh_cache(const char* mesh_filename, MeshSource &source, trimesh::TriMesh* mesh, std::vector<trimesh::vec> &facenormals, CornerTable &corners, float &feature_size, unsigned int &properties){
+	MappedFile file;
+	std::string filename = mesh_cache_filename(mesh_filename);
+	if(!file.open(filename.c_str()) || file.size() < sizeof(MeshCacheHeader)){
+		return false;
+	}
+	MeshCacheHeader header;
+	memcpy(&header, file.data(), sizeof(header));
+	if(memcmp(header.magic, MESH_CACHE_MAGIC, 8) != 0 || header.version != MESH_CACHE_VERSION || header.header_size != sizeof(MeshCacheHeader)){
+		std::cout << "Mesh cache has an unknown format, rebuilding" << std::endl;
+		return false;
+	}
+	bool restamp;
+	if(!mesh_source_unchanged(mesh_filename, source, header.source_hash, header.source_size, header.source_mtime, restamp)){
+		std::cout << "Mesh cache is out of date, rebuilding" << std::endl;
+		return false;
+	}
+	for(int a = 0; a < CACHE_ARRAY_COUNT; a++){
+		if(header.bytes[a] > file.size() || header.offset[a] > file.size() - header.bytes[a]){
+			std::cout << "Mesh cache is truncated, rebuilding" << std::endl;
+			return false;
+		}
+	}
+	// every array has to hold exactly as many elements as the header says (the arrays of properties which haven't been
+	// built may be missing), or the mesh would be read out of bounds later on
+	uint64_t nv = header.nv, nf = header.nf;
+	unsigned int p = header.properties;
+	bool fits = nv <= file.size() && nf <= file.size() && header.ntstrips <= file.size()
+			&& array_fits(header, CACHE_POSITIONS, nv, false, mesh->vertices)
+			&& array_fits(header, CACHE_NORMALS, nv, !(p & MESH_NORMALS), mesh->normals)
+			&& array_fits(header, CACHE_PDIR1, nv, !(p & MESH_CURVATURES), mesh->pdir1)
+			&& array_fits(header, CACHE_PDIR2, nv, !(p & MESH_CURVATURES), mesh->pdir2)
+			&& array_fits(header, CACHE_CURV1, nv, !(p & MESH_CURVATURES), mesh->curv1)
+			&& array_fits(header, CACHE_CURV2, nv, !(p & MESH_CURVATURES), mesh->curv2)
+			&& array_fits(header, CACHE_DCURV, nv, !(p & MESH_DCURV), mesh->dcurv)
+			&& array_fits(header, CACHE_FACES, nf, false, mesh->faces)
+			&& array_fits(header, CACHE_OPPOSITE, 3 * nf, !(p & MESH_CONNECTIVITY), corners.opposite_)
+			&& array_fits(header, CACHE_VERTEX_CORNER, nv, !(p & MESH_CONNECTIVITY), corners.vertex_corner_)
+			&& array_fits(header, CACHE_TSTRIPS, header.ntstrips, false, mesh->tstrips)
+			&& array_fits(header, CACHE_FACENORMALS, nf, !(p & MESH_FACENORMALS), facenormals);
+	if(!fits){
+		std::cout << "Mesh cache is corrupt, rebuilding" << std::endl;
+		return false;
+	}
+	// the arrays are laid out exactly like the mesh vectors, so loading them is a plain copy out of the mapping
+	load_array(file, header, CACHE_POSITIONS, mesh->vertices);
+	load_array(file, header, CACHE_NORMALS, mesh->normals);
+	load_array(file, header, CACHE_PDIR1, mesh->pdir1);
+	load_array(file, header, CACHE_PDIR2, mesh->pdir2);
+	load_array(file, header, CACHE_CURV1, mesh->curv1);
+	load_array(file, header, CACHE_CURV2, mesh->curv2);
+	load_array(file, header, CACHE_DCURV, mesh->dcurv);
+	load_array(file, header, CACHE_FACES, mesh->faces);
+	load_array(file, header, CACHE_OPPOSITE, corners.opposite_);
+	load_array(file, header, CACHE_VERTEX_CORNER, corners.vertex_corner_);
+	load_array(file, header, CACHE_TSTRIPS, mesh->tstrips);
+	load_array(file, header, CACHE_FACENORMALS, facenormals);
+	mesh->bsphere.center = trimesh::point(header.bsphere[0], header.bsphere[1], header.bsphere[2]);
+	mesh->bsphere.r = header.bsphere[3];
+	mesh->bsphere.valid = true;
+	feature_size = header.feature_size;
+	properties = header.properties;
+	if(restamp){
+		file.close();
+		restamp_cache_file(filename, offsetof(MeshCacheHeader, source_mtime), source.mtime);
+	}
+	return true;
+}
+
+/**
+ * Write a preprocessed mesh to its cache sidecar
+ *
+ * @param mesh_filename: the source mesh file
+ * @param source: content hash, size and modification time of the source mesh file
+ * @param mesh: the preprocessed mesh
+ * @param facenormals: the face normals
+ * @param corners: the corner table
+ * @param feature_size: the feature size
+ * @param properties: the MeshProperty mask of the data that is present
+ * @return true if the cache was written
+ */
+bool write_mesh_cache(const char* mesh_filename, const MeshSource &source, const trimesh::TriMesh* mesh, const std::vector<trimesh::vec> &facenormals, const CornerTable &corners, float feature_size, unsigned int properties){
+	MeshCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MESH_CACHE_MAGIC, 8);
+	header.version = MESH_CACHE_VERSION;
+	header.header_size = sizeof(MeshCacheHeader);
+	header.source_hash = source.hash;
+	header.source_size = source.size;
+	header.source_mtime = source.mtime;
+	header.nv = mesh->vertices.size();
+	header.nf = mesh->faces.size();
+	header.ntstrips = mesh->tstrips.size();
+	header.feature_size = feature_size;
+	header.properties = properties;
+	header.bsphere[0] = mesh->bsphere.center[0];
+	header.bsphere[1] = mesh->bsphere.center[1];
+	header.bsphere[2] = mesh->bsphere.center[2];
+	header.bsphere[3] = mesh->bsphere.r;
+	// lay out the arrays
+	const void* data[CACHE_ARRAY_COUNT];
+	uint64_t offset = sizeof(MeshCacheHeader);
+	for(int a = 0; a < CACHE_ARRAY_COUNT; a++){
+		offset = (offset + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT;
+		header.offset[a] = offset;
+		header.bytes[a] = array_bytes(mesh, facenormals, corners, a, data[a]);
+		offset += header.bytes[a];
+	}
+	// write them
+	std::string filename = mesh_cache_filename(mesh_filename);
+	FILE* f = fopen(filename.c_str(), "wb");
+	if(!f){
+		return false;
+	}
+	static const char zeros[MESH_CACHE_ALIGNMENT] = {0};
+	bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+	uint64_t written = sizeof(header);
+	for(int a = 0; a < CACHE_ARRAY_COUNT && ok; a++){
+		ok = fwrite(zeros, 1, header.offset[a] - written, f) == header.offset[a] - written;
+		if(ok && header.bytes[a]){
+			ok = fwrite(data[a], header.bytes[a], 1, f) == 1;
+		}
+		written = header.offset[a] + header.bytes[a];
+	}
+	ok = (fclose(f) == 0) && ok;
+	if(!ok){
+		remove(filename.c_str());
+	}
+	return ok;
+}
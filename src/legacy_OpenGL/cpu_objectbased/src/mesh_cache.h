@@ -0,0 +1,69 @@
+/*
+ * A binary cache for preprocessed meshes.
+ *
+ * Next to a mesh file, we store a sidecar file (<mesh>.sccache) holding everything the Model constructor computes:
+ * positions, normals, principal directions and curvatures, curvature derivatives, faces, corner table, triangle strips,
+ * face normals and the feature size (or the subset of those the Model has computed so far, as recorded in the
+ * header's property mask). The cache is keyed by the size and modification time of the source mesh file, so it gets
+ * rebuilt automatically when the mesh changes. Only when those differ (or when asked to, see set_mesh_cache_verify) the
+ * source gets read and its content hash compared to the one in the cache: a file which was only touched keeps its cache.
+ *
+ * Layout: a fixed-size header followed by the raw arrays, every array starting on a 64-byte boundary, so the file can be
+ * memory-mapped and the arrays used as they are (little-endian, 32-bit floats and ints).
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef MESH_CACHE_H_
+#define MESH_CACHE_H_
+
+#include <TriMesh.h>
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include "CornerTable.h"
+
+#define MESH_CACHE_VERSION 4
+
+enum MeshCacheArray{
+	CACHE_POSITIONS, CACHE_NORMALS, CACHE_PDIR1, CACHE_PDIR2, CACHE_CURV1, CACHE_CURV2, CACHE_DCURV,
+	CACHE_FACES, CACHE_OPPOSITE, CACHE_VERTEX_CORNER, CACHE_TSTRIPS, CACHE_FACENORMALS,
+	CACHE_ARRAY_COUNT
+};
+
+struct MeshCacheHeader{
+	char magic[8]; // "SCCACHE"
+	uint32_t version;
+	uint32_t header_size;
+	uint64_t source_hash; // content hash of the source mesh file
+	uint64_t source_size; // size of the source mesh file
+	uint64_t source_mtime; // modification time of the source mesh file
+	uint64_t nv; // number of vertices
+	uint64_t nf; // number of faces
+	uint64_t ntstrips; // length of the triangle strip array
+	float feature_size;
+	float bsphere[4]; // bounding sphere center and radius
+	uint32_t properties; // which MeshProperty data is present
+	uint64_t offset[CACHE_ARRAY_COUNT]; // byte offset of each array from the start of the file
+	uint64_t bytes[CACHE_ARRAY_COUNT]; // byte size of each array
+};
+
+// what a cache records of its source mesh file (a hash of 0 means it hasn't been computed)
+struct MeshSource{
+	uint64_t hash;
+	uint64_t size;
+	uint64_t mtime;
+	MeshSource(): hash(0), size(0), mtime(0){}
+};
+
+std::string mesh_cache_filename(const char* mesh_filename);
+void set_mesh_cache_verify(bool verify);
+bool stat_mesh_file(const char* mesh_filename, MeshSource &source);
+bool hash_mesh_file(const char* mesh_filename, uint64_t &hash, uint64_t &size);
+bool mesh_source_unchanged(const char* mesh_filename, MeshSource &source, uint64_t cached_hash, uint64_t cached_size, uint64_t cached_mtime, bool &restamp);
+bool restamp_cache_file(const std::string &filename, size_t offset, uint64_t mtime);
+unsigned int cached_mesh_properties(const char* mesh_filename);
+bool read_mesh_cache(const char* mesh_filename, MeshSource &source, trimesh::TriMesh* mesh, std::vector<trimesh::vec> &facenormals, CornerTable &corners, float &feature_size, unsigned int &properties);
+bool write_mesh_cache(const char* mesh_filename, const MeshSource &source, const trimesh::TriMesh* mesh, const std::vector<trimesh::vec> &facenormals, const CornerTable &corners, float feature_size, unsigned int properties);
+
+#endif /* MESH_CACHE_H_ */
@@ -16,17 +16,26 @@ void computeFaceNormals(const trimesh::TriMesh* mesh, std::vector<trimesh::vec>
 	int n = mesh->faces.size();
 	facenormals.resize(n);
 	for (int i =0; i < n; i++){
-		trimesh::vec p0 = mesh->vertices[(mesh->faces)[i][0]];
-		trimesh::vec p1 = mesh->vertices[(mesh->faces)[i][1]];
-		trimesh::vec p2 = mesh->vertices[(mesh->faces)[i][2]];
-		// compute vector, normalize it
-		trimesh::vec facenormal = (p0-p1) CROSS (p1-p2);
-		trimesh::normalize(facenormal);
-		// put it in result vector
-		facenormals[i] = facenormal;
+		facenormals[i] = computeFaceNormal(mesh, i);
 	}
 }
 
+/**
+ * Compute the normal of one face of a given mesh
+ *
+ * @param *mesh : A pointer to the mesh
+ * @param i : The face index
+ */
+trimesh::vec computeFaceNormal(const trimesh::TriMesh* mesh, int i){
+	trimesh::vec p0 = mesh->vertices[(mesh->faces)[i][0]];
+	trimesh::vec p1 = mesh->vertices[(mesh->faces)[i][1]];
+	trimesh::vec p2 = mesh->vertices[(mesh->faces)[i][2]];
+	// compute vector, normalize it
+	trimesh::vec facenormal = (p0-p1) CROSS (p1-p2);
+	trimesh::normalize(facenormal);
+	return facenormal;
+}
+
 /**
  * Compute the feature size for a given mesh, using random sampling
  *
@@ -66,7 +75,7 @@ bool to_camera(Model* m, int face, trimesh::vec camera_position){
 	// vector to point on face
 	trimesh::vec view = camera_position-(m->mesh_->vertices[(m->mesh_->faces[face])[0]]);
 	trimesh::normalize(view);
-	trimesh::vec facenormal = m->facenormals_[face];
+	trimesh::vec facenormal = m->data_->facenormals_[face];
 	// do dot product to get camera facing test
 	return ((view^facenormal) > 0.0f);
 }
@@ -12,6 +12,7 @@
 #include <vector>
 
 void computeFaceNormals(const trimesh::TriMesh* mesh, std::vector<trimesh::vec> &facenormals);
+trimesh::vec computeFaceNormal(const trimesh::TriMesh* mesh, int i);
 float computeFeatureSize(const trimesh::TriMesh* mesh);
 bool to_camera(Model* m, int face, trimesh::vec camera_position);
 
@@ -0,0 +1,146 @@
+/*
+ * Locality-optimizing reordering of a mesh's vertices and faces.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "mesh_reorder.h"
+#include <algorithm>
+
+/**
+ * Spread the lower 10 bits of a value, so there are two zero bits between every bit
+ */
+static uint32_t spread_bits(uint32_t x){
+	x &= 0x000003ff;
+	x = (x | (x << 16)) & 0x030000ff;
+	x = (x | (x << 8)) & 0x0300f00f;
+	x = (x | (x << 4)) & 0x030c30c3;
+	x = (x | (x << 2)) & 0x09249249;
+	return x;
+}
+
+/**
+ * Compute the 30-bit Morton code of a point, on a 1024^3 grid spanning the cube around a bounding sphere
+ *
+ * @param p: the point
+ * @param bsphere: the bounding sphere
+ */
+uint32_t morton_code(const trimesh::point &p, const trimesh::TriMesh::BSphere &bsphere){
+	uint32_t code = 0;
+	float scale = bsphere.r > 0.0f ? 1023.0f / (2.0f * bsphere.r) : 0.0f;
+	for(int j = 0; j < 3; j++){
+		float c = (p[j] - bsphere.center[j] + bsphere.r) * scale;
+		uint32_t q = uint32_t(std::min(std::max(c, 0.0f), 1023.0f));
+		code |= spread_bits(q) << j;
+	}
+	return code;
+}
+
+/**
+ * Put the elements of a per-element array in their new order
+ *
+ * @param v: the array (left alone if it doesn't hold one value per element)
+ * @param order: order[i] is the old index of the element which ends up at index i
+ */
+template<class T>
+static void permute(std::vector<T> &v, const std::vector<int> &order){
+	if(v.size() != order.size()){
+		return;
+	}
+	std::vector<T> reordered(v.size());
+	for(size_t i = 0; i < order.size(); i++){
+		reordered[i] = v[order[i]];
+	}
+	v.swap(reordered);
+}
+
+/**
+ * Reorder the vertices of a mesh along a Morton curve, and its faces by lowest vertex index.
+ * All per-vertex and per-face data present in the mesh gets remapped accordingly. Neighbour and adjacent face
+ * lists are cleared, TriMesh2 rebuilds them on demand.
+ *
+ * @param *mesh: the mesh
+ * @param &facenormals: face normals, if present
+ */
+void reorder_mesh(trimesh::TriMesh* mesh, std::vector<trimesh::vec> &facenormals){
+	int nv = mesh->vertices.size();
+	int nf = mesh->faces.size();
+	mesh->need_bsphere();
+
+	// sort vertices by Morton code
+	std::vector<uint32_t> codes(nv);
+	for(int i = 0; i < nv; i++){
+		codes[i] = morton_code(mesh->vertices[i], mesh->bsphere);
+	}
+	std::vector<int> vertex_order(nv);
+	for(int i = 0; i < nv; i++){
+		vertex_order[i] = i;
+	}
+	std::stable_sort(vertex_order.begin(), vertex_order.end(), [&codes](int a, int b){ return codes[a] < codes[b]; });
+	std::vector<int> new_vertex(nv);
+	for(int i = 0; i < nv; i++){
+		new_vertex[vertex_order[i]] = i;
+	}
+
+	// remap per-vertex data
+	permute(mesh->vertices, vertex_order);
+	permute(mesh->normals, vertex_order);
+	permute(mesh->colors, vertex_order);
+	permute(mesh->pdir1, vertex_order);
+	permute(mesh->pdir2, vertex_order);
+	permute(mesh->curv1, vertex_order);
+	permute(mesh->curv2, vertex_order);
+	permute(mesh->dcurv, vertex_order);
+	permute(mesh->pointareas, vertex_order);
+
+	// renumber vertex references
+	for(int i = 0; i < nf; i++){
+		for(int j = 0; j < 3; j++){
+			mesh->faces[i][j] = new_vertex[mesh->faces[i][j]];
+		}
+	}
+	// triangle strips are stored as length, followed by that many vertex indices
+	for(size_t i = 0; i < mesh->tstrips.size(); i += mesh->tstrips[i] + 1){
+		for(int j = 1; j <= mesh->tstrips[i]; j++){
+			mesh->tstrips[i + j] = new_vertex[mesh->tstrips[i + j]];
+		}
+	}
+	for(size_t i = 0; i < mesh->grid.size(); i++){
+		if(mesh->grid[i] >= 0){
+			mesh->grid[i] = new_vertex[mesh->grid[i]];
+		}
+	}
+
+	// sort faces by their lowest vertex index
+	std::vector<int> lowest(nf);
+	for(int i = 0; i < nf; i++){
+		lowest[i] = std::min(mesh->faces[i][0], std::min(mesh->faces[i][1], mesh->faces[i][2]));
+	}
+	std::vector<int> face_order(nf);
+	for(int i = 0; i < nf; i++){
+		face_order[i] = i;
+	}
+	std::stable_sort(face_order.begin(), face_order.end(), [&lowest](int a, int b){ return lowest[a] < lowest[b]; });
+	std::vector<int> new_face(nf);
+	for(int i = 0; i < nf; i++){
+		new_face[face_order[i]] = i;
+	}
+
+	// remap per-face data
+	permute(mesh->faces, face_order);
+	permute(mesh->cornerareas, face_order);
+	permute(mesh->across_edge, face_order);
+	permute(facenormals, face_order);
+
+	// renumber face references (-1 marks a boundary edge)
+	for(size_t i = 0; i < mesh->across_edge.size(); i++){
+		for(int j = 0; j < 3; j++){
+			if(mesh->across_edge[i][j] >= 0){
+				mesh->across_edge[i][j] = new_face[mesh->across_edge[i][j]];
+			}
+		}
+	}
+
+	mesh->clear_neighbors();
+	mesh->clear_adjacentfaces();
+}
@@ -0,0 +1,25 @@
+/*
+ * Locality-optimizing reordering of a mesh's vertices and faces.
+ *
+ * Vertices get sorted along a Morton (Z-order) curve through the bounding sphere's cube, faces by their lowest
+ * (new) vertex index. Neighbouring faces then touch neighbouring vertices, so the per-face loops in the drawers gather
+ * per-vertex data (ndotv, kr, curvatures, ...) from a small window of memory instead of from all over the mesh.
+ *
+ * Every per-vertex and per-face array which is present gets remapped, so this can run before or after any
+ * preprocessing.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef MESH_REORDER_H_
+#define MESH_REORDER_H_
+
+#include "TriMesh.h"
+#include <vector>
+#include <stdint.h>
+
+void reorder_mesh(trimesh::TriMesh* mesh, std::vector<trimesh::vec> &facenormals);
+// the 30-bit Morton code of a point, on a 1024^3 grid spanning the cube around a bounding sphere
+uint32_t morton_code(const trimesh::point &p, const trimesh::TriMesh::BSphere &bsphere);
+
+#endif /* MESH_REORDER_H_ */
@@ -0,0 +1,144 @@
+/*
+ * Compact (quantized) storage for the per-vertex attributes line extraction needs.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "quantize.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+
+/**
+ * Encode a float in [-1,1] as a half float, rounding to nearest. Values too small for a normalized half become zero.
+ */
+uint16_t float_to_half(float f){
+	uint32_t bits;
+	memcpy(&bits, &f, sizeof(bits));
+	uint16_t sign = uint16_t((bits >> 16) & 0x8000);
+	int exponent = int((bits >> 23) & 0xff) - 127 + 15;
+	if(exponent <= 0){
+		return sign;
+	}
+	if(exponent >= 31){
+		return sign | 0x7bff;
+	}
+	uint32_t mantissa = bits & 0x7fffff;
+	uint32_t h = (uint32_t(exponent) << 10) | (mantissa >> 13);
+	// round to nearest: a carry into the exponent is exactly right
+	h += (mantissa >> 12) & 1;
+	return sign | uint16_t(std::min(h, uint32_t(0x7bff)));
+}
+
+/**
+ * Encode a unit vector in 32 bits: octahedral projection, 16 bit signed normalized per coordinate
+ */
+uint32_t encode_octahedral(trimesh::vec v){
+	float s = fabs(v[0]) + fabs(v[1]) + fabs(v[2]);
+	if(s == 0.0f){
+		return 0;
+	}
+	float x = v[0] / s;
+	float y = v[1] / s;
+	if(v[2] < 0.0f){
+		float fx = (1.0f - fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float fy = (1.0f - fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = fx;
+		y = fy;
+	}
+	int16_t qx = int16_t(floor(x * 32767.0f + 0.5f));
+	int16_t qy = int16_t(floor(y * 32767.0f + 0.5f));
+	return uint32_t(uint16_t(qx)) | (uint32_t(uint16_t(qy)) << 16);
+}
+
+/**
+ * Build the compact representation of a mesh's per-vertex attributes. Attributes the mesh doesn't have get encoded as
+ * zero. The scales are the largest absolute curvature and curvature derivative in the mesh.
+ *
+ * @param *mesh: the mesh
+ * @param &q: the quantized attributes
+ */
+void quantize_attributes(const trimesh::TriMesh* mesh, QuantizedAttributes &q){
+	size_t nv = mesh->vertices.size();
+	bool normals = mesh->normals.size() == nv;
+	bool curvatures = normals && mesh->curv1.size() == nv;
+	bool dcurv = curvatures && mesh->dcurv.size() == nv;
+	q.normals_ = normals;
+	q.curvatures_ = curvatures;
+	q.dcurv_ = dcurv;
+
+	// per-mesh scales
+	q.curv_scale_ = 0.0f;
+	q.dcurv_scale_ = 0.0f;
+	for(size_t i = 0; curvatures && i < nv; i++){
+		q.curv_scale_ = std::max(q.curv_scale_, float(std::max(fabs(mesh->curv1[i]), fabs(mesh->curv2[i]))));
+		for(int j = 0; dcurv && j < 4; j++){
+			q.dcurv_scale_ = std::max(q.dcurv_scale_, float(fabs(mesh->dcurv[i][j])));
+		}
+	}
+	float curv_inv = q.curv_scale_ > 0.0f ? 1.0f / q.curv_scale_ : 0.0f;
+	float dcurv_inv = q.dcurv_scale_ > 0.0f ? 1.0f / q.dcurv_scale_ : 0.0f;
+
+	q.vertices_.resize(nv);
+	parallel_for(0, int(nv), PARALLEL_CHUNK, [&](int i){
+		QuantizedVertex &v = q.vertices_[i];
+		memset(&v, 0, sizeof(v));
+		if(normals){
+			v.normal_ = encode_octahedral(mesh->normals[i]);
+		}
+		if(curvatures){
+			v.pdir1_ = encode_octahedral(mesh->pdir1[i]);
+			v.curv_[0] = float_to_half(mesh->curv1[i] * curv_inv);
+			v.curv_[1] = float_to_half(mesh->curv2[i] * curv_inv);
+		}
+		if(dcurv){
+			// derivatives are expressed in the (pdir1, pdir2) frame: if the stored pdir2 points opposite to the
+			// reconstructed normal x pdir1, the components with an odd number of pdir2 factors change sign
+			float flip = ((mesh->normals[i] CROSS mesh->pdir1[i]) DOT mesh->pdir2[i]) < 0.0f ? -1.0f : 1.0f;
+			v.dcurv_[0] = float_to_half(mesh->dcurv[i][0] * dcurv_inv);
+			v.dcurv_[1] = float_to_half(flip * mesh->dcurv[i][1] * dcurv_inv);
+			v.dcurv_[2] = float_to_half(mesh->dcurv[i][2] * dcurv_inv);
+			v.dcurv_[3] = float_to_half(flip * mesh->dcurv[i][3] * dcurv_inv);
+		}
+	});
+}
+
+/**
+ * Decode the compact representation back into a mesh's float arrays: only the attributes the mesh had when it got
+ * quantized, the others stay empty (so they still look unbuilt)
+ *
+ * @param &q: the quantized attributes
+ * @param *mesh: the mesh
+ */
+void dequantize_attributes(const QuantizedAttributes &q, trimesh::TriMesh* mesh){
+	size_t nv = q.vertices_.size();
+	if(q.normals_){
+		mesh->normals.resize(nv);
+	}
+	if(q.curvatures_){
+		mesh->pdir1.resize(nv);
+		mesh->pdir2.resize(nv);
+		mesh->curv1.resize(nv);
+		mesh->curv2.resize(nv);
+	}
+	if(q.dcurv_){
+		mesh->dcurv.resize(nv);
+	}
+	parallel_for(0, int(nv), PARALLEL_CHUNK, [&](int i){
+		const QuantizedVertex &v = q.vertices_[i];
+		if(q.normals_){
+			mesh->normals[i] = decode_octahedral(v.normal_);
+		}
+		if(q.curvatures_){
+			mesh->pdir1[i] = decode_octahedral(v.pdir1_);
+			mesh->pdir2[i] = mesh->normals[i] CROSS mesh->pdir1[i];
+			mesh->curv1[i] = half_to_float(v.curv_[0]) * q.curv_scale_;
+			mesh->curv2[i] = half_to_float(v.curv_[1]) * q.curv_scale_;
+		}
+		if(q.dcurv_){
+			for(int j = 0; j < 4; j++){
+				mesh->dcurv[i][j] = half_to_float(v.dcurv_[j]) * q.dcurv_scale_;
+			}
+		}
+	});
+}
@@ -0,0 +1,77 @@
+/*
+ * Compact (quantized) storage for the per-vertex attributes line extraction needs.
+ *
+ * Per vertex, TriMesh2 keeps float normals, principal directions, principal curvatures and curvature derivatives:
+ * 60 bytes. A QuantizedVertex packs them in 20 bytes:
+ *  - normal and first principal direction as octahedral unit vectors, 2 x 16 bit each
+ *    (angular error below 1e-4 radians);
+ *  - the second principal direction isn't stored, it is reconstructed as normal x pdir1;
+ *  - curvatures and curvature derivatives as half floats, relative to a per-mesh scale
+ *    (absolute error below scale * 2^-11).
+ * Positions stay full floats, they define the geometry of the lines themselves.
+ *
+ * The decoders are inline, so the per-vertex kernels in vertex_info can decode on the fly.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef QUANTIZE_H_
+#define QUANTIZE_H_
+
+#include "TriMesh.h"
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+struct QuantizedVertex{
+	uint32_t normal_; // octahedral encoded normal
+	uint32_t pdir1_; // octahedral encoded first principal direction
+	uint16_t curv_[2]; // principal curvatures, as half floats relative to curv_scale_
+	uint16_t dcurv_[4]; // curvature derivatives, as half floats relative to dcurv_scale_
+};
+
+struct QuantizedAttributes{
+	std::vector<QuantizedVertex> vertices_;
+	float curv_scale_;
+	float dcurv_scale_;
+	// which attributes the mesh had (the others are encoded as zero)
+	bool normals_;
+	bool curvatures_;
+	bool dcurv_;
+	QuantizedAttributes(): curv_scale_(0.0f), dcurv_scale_(0.0f), normals_(false), curvatures_(false), dcurv_(false){}
+};
+
+void quantize_attributes(const trimesh::TriMesh* mesh, QuantizedAttributes &q);
+void dequantize_attributes(const QuantizedAttributes &q, trimesh::TriMesh* mesh);
+uint16_t float_to_half(float f);
+uint32_t encode_octahedral(trimesh::vec v);
+
+/**
+ * Decode a half float (quantize_attributes never produces denormals, infinities or NaNs)
+ */
+inline float half_to_float(uint16_t h){
+	uint32_t bits = (h & 0x7fff) ? ((uint32_t(h & 0x8000) << 16) | ((uint32_t(h & 0x7fff) + 0x1c000) << 13)) : (uint32_t(h & 0x8000) << 16);
+	float f;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+/**
+ * Decode an octahedral encoded unit vector
+ */
+inline trimesh::vec decode_octahedral(uint32_t code){
+	float x = int16_t(code & 0xffff) * (1.0f / 32767.0f);
+	float y = int16_t(code >> 16) * (1.0f / 32767.0f);
+	float z = 1.0f - fabs(x) - fabs(y);
+	if(z < 0.0f){
+		float fx = (1.0f - fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float fy = (1.0f - fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = fx;
+		y = fy;
+	}
+	trimesh::vec v(x, y, z);
+	trimesh::normalize(v);
+	return v;
+}
+
+#endif /* QUANTIZE_H_ */
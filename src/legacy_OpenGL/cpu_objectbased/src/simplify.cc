@@ -0,0 +1,330 @@
+/*
+ * Mesh simplification by quadric error edge collapses.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#include "simplify.h"
+#include "CornerTable.h"
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+// a symmetric 4x4 error quadric: aa ab ac ad bb bc bd cc cd dd
+struct Quadric{
+	double q[10];
+	Quadric(){
+		std::fill(q, q + 10, 0.0);
+	}
+	// the quadric of the squared distance to plane ax + by + cz + d = 0, times a weight
+	static Quadric plane(double a, double b, double c, double d, double weight){
+		Quadric k;
+		k.q[0] = weight*a*a; k.q[1] = weight*a*b; k.q[2] = weight*a*c; k.q[3] = weight*a*d;
+		k.q[4] = weight*b*b; k.q[5] = weight*b*c; k.q[6] = weight*b*d;
+		k.q[7] = weight*c*c; k.q[8] = weight*c*d;
+		k.q[9] = weight*d*d;
+		return k;
+	}
+	Quadric& operator+=(const Quadric &k){
+		for(int i = 0; i < 10; i++){
+			q[i] += k.q[i];
+		}
+		return *this;
+	}
+	double error(const trimesh::point &p) const{
+		double x = p[0], y = p[1], z = p[2];
+		return q[0]*x*x + 2*q[1]*x*y + 2*q[2]*x*z + 2*q[3]*x + q[4]*y*y + 2*q[5]*y*z + 2*q[6]*y + q[7]*z*z + 2*q[8]*z + q[9];
+	}
+	// the point with minimal error, if the quadric isn't (nearly) singular
+	bool minimum(trimesh::point &p) const{
+		double det = q[0]*(q[4]*q[7] - q[5]*q[5]) - q[1]*(q[1]*q[7] - q[5]*q[2]) + q[2]*(q[1]*q[5] - q[4]*q[2]);
+		double scale = q[0]*q[4]*q[7];
+		if(fabs(det) <= 1e-10 * fabs(scale) || det == 0.0){
+			return false;
+		}
+		// Cramer's rule on A p = -b
+		double b0 = -q[3], b1 = -q[6], b2 = -q[8];
+		double x = (b0*(q[4]*q[7] - q[5]*q[5]) - q[1]*(b1*q[7] - q[5]*b2) + q[2]*(b1*q[5] - q[4]*b2)) / det;
+		double y = (q[0]*(b1*q[7] - b2*q[5]) - b0*(q[1]*q[7] - q[5]*q[2]) + q[2]*(q[1]*b2 - b1*q[2])) / det;
+		double z = (q[0]*(q[4]*b2 - q[5]*b1) - q[1]*(q[1]*b2 - b1*q[2]) + b0*(q[1]*q[5] - q[4]*q[2])) / det;
+		p = trimesh::point(float(x), float(y), float(z));
+		return true;
+	}
+};
+
+// a candidate edge collapse, valid as long as neither vertex changed since it was queued
+struct Collapse{
+	double cost;
+	int v0, v1;
+	int stamp0, stamp1;
+	trimesh::point target;
+	bool operator>(const Collapse &c) const { return cost > c.cost; }
+};
+
+class Simplifier{
+private:
+	std::vector<trimesh::point> positions_;
+	std::vector<trimesh::TriMesh::Face> faces_;
+	std::vector<char> face_alive_;
+	std::vector<char> vertex_alive_;
+	std::vector<int> stamp_;
+	std::vector<Quadric> quadrics_;
+	std::vector<std::vector<int> > vertex_faces_;
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse> > queue_;
+	int live_faces_;
+
+	void neighbours(int v, std::vector<int> &result) const;
+	void queue(int v0, int v1);
+	bool valid(int v0, int v1, const trimesh::point &target) const;
+	void collapse(int v0, int v1, const trimesh::point &target);
+public:
+	Simplifier(const trimesh::TriMesh* mesh);
+	void run(int target_faces);
+	void result(trimesh::TriMesh* simplified) const;
+};
+
+Simplifier::Simplifier(const trimesh::TriMesh* mesh): positions_(mesh->vertices), faces_(mesh->faces), live_faces_(mesh->faces.size()){
+	int nv = positions_.size();
+	int nf = faces_.size();
+	face_alive_.assign(nf, 1);
+	vertex_alive_.assign(nv, 1);
+	stamp_.assign(nv, 0);
+	quadrics_.resize(nv);
+	vertex_faces_.resize(nv);
+	CornerTable corners;
+	corners.build(mesh);
+	for(int f = 0; f < nf; f++){
+		const trimesh::TriMesh::Face &face = faces_[f];
+		trimesh::vec n = (positions_[face[1]] - positions_[face[0]]) CROSS (positions_[face[2]] - positions_[face[0]]);
+		float area = len(n);
+		if(area > 0.0f){
+			n /= area;
+			// plane quadrics are area weighted, so tiny faces don't dominate
+			Quadric k = Quadric::plane(n[0], n[1], n[2], -(n DOT positions_[face[0]]), 0.5 * area);
+			for(int j = 0; j < 3; j++){
+				quadrics_[face[j]] += k;
+			}
+			// boundary edges: add a heavy plane perpendicular to the face through the edge
+			for(int j = 0; j < 3; j++){
+				if(corners.opposite(3*f + j) < 0){
+					const trimesh::point &a = positions_[face[(j+1)%3]];
+					const trimesh::point &b = positions_[face[(j+2)%3]];
+					trimesh::vec e = b - a;
+					trimesh::vec bn = e CROSS n;
+					float l = len(bn);
+					if(l > 0.0f){
+						bn /= l;
+						Quadric kb = Quadric::plane(bn[0], bn[1], bn[2], -(bn DOT a), 100.0 * len2(e));
+						quadrics_[face[(j+1)%3]] += kb;
+						quadrics_[face[(j+2)%3]] += kb;
+					}
+				}
+			}
+		}
+		for(int j = 0; j < 3; j++){
+			vertex_faces_[face[j]].push_back(f);
+		}
+	}
+	// queue every edge once
+	for(int f = 0; f < nf; f++){
+		for(int j = 0; j < 3; j++){
+			int a = faces_[f][j];
+			int b = faces_[f][(j+1)%3];
+			int c = corners.opposite(3*f + (j+2)%3);
+			if(a < b || c < 0){
+				queue(a, b);
+			}
+		}
+	}
+}
+
+/**
+ * The vertices sharing a live face with vertex v (sorted, unique)
+ */
+void Simplifier::neighbours(int v, std::vector<int> &result) const{
+	result.clear();
+	for(size_t i = 0; i < vertex_faces_[v].size(); i++){
+		int f = vertex_faces_[v][i];
+		if(face_alive_[f]){
+			for(int j = 0; j < 3; j++){
+				if(faces_[f][j] != v){
+					result.push_back(faces_[f][j]);
+				}
+			}
+		}
+	}
+	std::sort(result.begin(), result.end());
+	result.erase(std::unique(result.begin(), result.end()), result.end());
+}
+
+/**
+ * Queue the collapse of edge (v0,v1) with its best target position
+ */
+void Simplifier::queue(int v0, int v1){
+	Quadric k = quadrics_[v0];
+	k += quadrics_[v1];
+	const trimesh::point &p0 = positions_[v0];
+	const trimesh::point &p1 = positions_[v1];
+	trimesh::point mid = 0.5f * (p0 + p1);
+	Collapse c;
+	c.v0 = v0;
+	c.v1 = v1;
+	c.stamp0 = stamp_[v0];
+	c.stamp1 = stamp_[v1];
+	c.target = mid;
+	c.cost = k.error(mid);
+	trimesh::point candidates[2] = { p0, p1 };
+	for(int i = 0; i < 2; i++){
+		double e = k.error(candidates[i]);
+		if(e < c.cost){
+			c.cost = e;
+			c.target = candidates[i];
+		}
+	}
+	// the optimal position, if it stays close to the edge
+	trimesh::point optimum;
+	if(k.minimum(optimum) && dist2(optimum, mid) <= dist2(p0, p1)){
+		double e = k.error(optimum);
+		if(e < c.cost){
+			c.cost = e;
+			c.target = optimum;
+		}
+	}
+	queue_.push(c);
+}
+
+/**
+ * Can we collapse v1 into v0 at the target position? Not if that flips a face, or if the edge's endpoints share more
+ * neighbours than the faces on the edge account for (which would pinch the mesh into a non-manifold one).
+ */
+bool Simplifier::valid(int v0, int v1, const trimesh::point &target) const{
+	std::vector<int> n0, n1, shared;
+	neighbours(v0, n0);
+	neighbours(v1, n1);
+	std::set_intersection(n0.begin(), n0.end(), n1.begin(), n1.end(), std::back_inserter(shared));
+	int edge_faces = 0;
+	for(int k = 0; k < 2; k++){
+		int v = k ? v1 : v0;
+		int other = k ? v0 : v1;
+		for(size_t i = 0; i < vertex_faces_[v].size(); i++){
+			int f = vertex_faces_[v][i];
+			if(!face_alive_[f]){
+				continue;
+			}
+			const trimesh::TriMesh::Face &face = faces_[f];
+			bool on_edge = face[0] == other || face[1] == other || face[2] == other;
+			if(on_edge){
+				edge_faces += k == 0;
+				continue;
+			}
+			// the face's normal before and after moving v to the target
+			trimesh::point p[3], q[3];
+			for(int j = 0; j < 3; j++){
+				p[j] = positions_[face[j]];
+				q[j] = face[j] == v ? target : p[j];
+			}
+			trimesh::vec before = (p[1] - p[0]) CROSS (p[2] - p[0]);
+			trimesh::vec after = (q[1] - q[0]) CROSS (q[2] - q[0]);
+			if((before DOT after) <= 0.0f){
+				return false;
+			}
+		}
+	}
+	return int(shared.size()) <= edge_faces;
+}
+
+/**
+ * Collapse v1 into v0, moving v0 to the target position
+ */
+void Simplifier::collapse(int v0, int v1, const trimesh::point &target){
+	positions_[v0] = target;
+	quadrics_[v0] += quadrics_[v1];
+	vertex_alive_[v1] = 0;
+	for(size_t i = 0; i < vertex_faces_[v1].size(); i++){
+		int f = vertex_faces_[v1][i];
+		if(!face_alive_[f]){
+			continue;
+		}
+		trimesh::TriMesh::Face &face = faces_[f];
+		if(face[0] == v0 || face[1] == v0 || face[2] == v0){
+			// faces on the collapsed edge degenerate
+			face_alive_[f] = 0;
+			live_faces_--;
+		}
+		else{
+			for(int j = 0; j < 3; j++){
+				if(face[j] == v1){
+					face[j] = v0;
+				}
+			}
+			vertex_faces_[v0].push_back(f);
+		}
+	}
+	std::vector<int>().swap(vertex_faces_[v1]);
+	// drop dead faces from v0's list
+	std::vector<int> &list = vertex_faces_[v0];
+	list.erase(std::remove_if(list.begin(), list.end(), [this](int f){ return !face_alive_[f]; }), list.end());
+	// all edges around v0 have new costs (the ones queued earlier become outdated)
+	stamp_[v0]++;
+	std::vector<int> n;
+	neighbours(v0, n);
+	for(size_t i = 0; i < n.size(); i++){
+		queue(v0, n[i]);
+	}
+}
+
+/**
+ * Collapse the cheapest edges until we reach the target number of faces (or run out of valid collapses)
+ */
+void Simplifier::run(int target_faces){
+	while(live_faces_ > target_faces && !queue_.empty()){
+		Collapse c = queue_.top();
+		queue_.pop();
+		if(!vertex_alive_[c.v0] || !vertex_alive_[c.v1] || c.stamp0 != stamp_[c.v0] || c.stamp1 != stamp_[c.v1]){
+			continue; // outdated
+		}
+		if(valid(c.v0, c.v1, c.target)){
+			collapse(c.v0, c.v1, c.target);
+		}
+	}
+}
+
+/**
+ * Write the remaining vertices and faces to a mesh
+ */
+void Simplifier::result(trimesh::TriMesh* simplified) const{
+	std::vector<int> remap(positions_.size(), -1);
+	simplified->vertices.clear();
+	simplified->faces.clear();
+	for(size_t f = 0; f < faces_.size(); f++){
+		if(!face_alive_[f]){
+			continue;
+		}
+		trimesh::TriMesh::Face face;
+		for(int j = 0; j < 3; j++){
+			int v = faces_[f][j];
+			if(remap[v] < 0){
+				remap[v] = simplified->vertices.size();
+				simplified->vertices.push_back(positions_[v]);
+			}
+			face[j] = remap[v];
+		}
+		simplified->faces.push_back(face);
+	}
+}
+
+/**
+ * Simplify a mesh to (about) a given number of faces
+ *
+ * @param *mesh: the mesh to simplify
+ * @param target_faces: the number of faces to aim for
+ * @param *simplified: the (empty) mesh to store the result in
+ */
+void simplify_mesh(const trimesh::TriMesh* mesh, int target_faces, trimesh::TriMesh* simplified){
+	Simplifier simplifier(mesh);
+	simplifier.run(target_faces);
+	simplifier.result(simplified);
+	simplified->need_bsphere();
+}
@@ -0,0 +1,19 @@
+/*
+ * Mesh simplification by quadric error edge collapses (Garland and Heckbert, "Surface Simplification Using Quadric
+ * Error Metrics", SIGGRAPH 1997).
+ *
+ * Used to build the level of detail hierarchy of a Model. Collapses which would flip a face or make the mesh
+ * non-manifold are rejected, and boundary edges get an extra constraint quadric, so holes keep their shape.
+ * Only positions and faces end up in the simplified mesh: everything else gets recomputed on it.
+ *
+ *      Author: Jeroen Baert
+ */
+
+#ifndef SIMPLIFY_H_
+#define SIMPLIFY_H_
+
+#include "TriMesh.h"
+
+void simplify_mesh(const trimesh::TriMesh* mesh, int target_faces, trimesh::TriMesh* simplified);
+
+#endif /* SIMPLIFY_H_ */
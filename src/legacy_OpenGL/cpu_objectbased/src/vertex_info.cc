@@ -12,17 +12,16 @@
  * @param *mesh: Pointer to a TriMesh
  * @param camera: the current camera position, in 3-dimensional coordinates
  * @param &ndotv: The vector where the results will be stored.
- *
+ * @param begin, end: the vertices to compute it for (begin ... end-1)
+ * @param &config: how to split up the loop
  */
-void compute_ndotv(const trimesh::TriMesh*mesh, const trimesh::vec camera, std::vector<float> &ndotv)
+void compute_ndotv(const trimesh::TriMesh*mesh, const trimesh::vec camera, FrameVector<float> &ndotv, int begin, int end, const KernelConfig &config)
 {
-	#pragma omp parallel for
-	for(unsigned int i = 0; i < mesh->vertices.size(); i++)
-	{
+	parallel_for(begin, end, config.chunk_, [&](int i){
 		trimesh::vec view = camera - mesh->vertices[i];
 		trimesh::normalize(view);
 		ndotv[i] = mesh->normals[i] DOT view;
-	}
+	}, config.threads_);
 }
 
 /**
@@ -33,13 +32,14 @@ void compute_ndotv(const trimesh::TriMesh*mesh, const trimesh::vec camera, std::
  * @param &kr: The vector where the results of the radial curvature computation will be stored
  * @param &num: The vector where numerator of the directional derivative of the radial curvature computation will be stored
  * @param &den: The vector where denominator of the directional derivative of the radial curvature computation will be stored
+ * @param begin, end: the vertices to compute it for (begin ... end-1)
+ * @param &config: how to split up the loop
  *
+ * All result vectors should already be sized to the number of vertices.
  */
-void compute_CurvDerivatives(const trimesh::TriMesh *mesh, const trimesh::vec camera, std::vector<float> &kr, std::vector<float> &num, std::vector<float> &den, float sc_threshold)
+void compute_CurvDerivatives(const trimesh::TriMesh *mesh, const trimesh::vec camera, FrameVector<float> &kr, FrameVector<float> &num, FrameVector<float> &den, float sc_threshold, int begin, int end, const KernelConfig &config)
 {
-	#pragma omp parallel for
-	for(unsigned int i = 0; i < mesh->vertices.size(); i++)
-	{
+	parallel_for(begin, end, config.chunk_, [&](int i){
 		// compute ndtov
 		trimesh::vec view = camera - mesh->vertices[i];
 		float norm = 1.0f / len(view);
@@ -50,9 +50,6 @@ void compute_CurvDerivatives(const trimesh::TriMesh *mesh, const trimesh::vec ca
 		float u2 = u*u;
 		float t = view DOT mesh->pdir2[i];
 		float v2 = t*t;
-		kr.resize(mesh->curv1.size());
-		num.resize(mesh->curv1.size());
-		den.resize(mesh->curv1.size());
 		float first = (mesh->curv1)[i] * u2;
 		float second = (mesh->curv2)[i] * v2;
 		kr[i] = first+second;
@@ -66,6 +63,80 @@ void compute_CurvDerivatives(const trimesh::TriMesh *mesh, const trimesh::vec ca
 		den[i] = ndotv;
 		// filtering of lines: see NPAR 2004 paper, page 5: other strategies for trimming suggestive contours
 		num[i] -= sc_threshold * den[i];
-	}
+	}, config.threads_);
+}
+
+
+/**
+ * Compute ndotv_ for a given mesh_, decoding normals from their compact representation
+ *
+ * @param *mesh: Pointer to a TriMesh (only its positions are used)
+ * @param &q: the compact per-vertex attributes
+ * @param camera: the current camera position, in 3-dimensional coordinates
+ * @param &ndotv: The vector where the results will be stored.
+ * @param begin, end: the vertices to compute it for (begin ... end-1)
+ * @param &config: how to split up the loop
+ */
+void compute_ndotv(const trimesh::TriMesh *mesh, const QuantizedAttributes &q, const trimesh::vec camera, FrameVector<float> &ndotv, int begin, int end, const KernelConfig &config)
+{
+	parallel_for(begin, end, config.chunk_, [&](int i){
+		trimesh::vec view = camera - mesh->vertices[i];
+		trimesh::normalize(view);
+		ndotv[i] = decode_octahedral(q.vertices_[i].normal_) DOT view;
+	}, config.threads_);
 }
 
+/**
+ * Compute view-dependent curvature information for a given mesh_, decoding normals, principal directions, curvatures
+ * and their derivatives from their compact representation. The second principal direction is reconstructed as
+ * normal x pdir1.
+ *
+ * @param *mesh: Pointer to a TriMesh (only its positions are used)
+ * @param &q: the compact per-vertex attributes
+ * @param camera: the current camera position, in 3-dimensional coordinates
+ * @param &kr: The vector where the results of the radial curvature computation will be stored
+ * @param &num: The vector where numerator of the directional derivative of the radial curvature computation will be stored
+ * @param &den: The vector where denominator of the directional derivative of the radial curvature computation will be stored
+ * @param begin, end: the vertices to compute it for (begin ... end-1)
+ * @param &config: how to split up the loop
+ *
+ * All result vectors should already be sized to the number of vertices.
+ */
+void compute_CurvDerivatives(const trimesh::TriMesh *mesh, const QuantizedAttributes &q, const trimesh::vec camera, FrameVector<float> &kr, FrameVector<float> &num, FrameVector<float> &den, float sc_threshold, int begin, int end, const KernelConfig &config)
+{
+	const float curv_scale = q.curv_scale_;
+	const float dcurv_scale = q.dcurv_scale_;
+	parallel_for(begin, end, config.chunk_, [&](int i){
+		// decode attributes
+		const QuantizedVertex &qv = q.vertices_[i];
+		trimesh::vec normal = decode_octahedral(qv.normal_);
+		trimesh::vec pdir1 = decode_octahedral(qv.pdir1_);
+		trimesh::vec pdir2 = normal CROSS pdir1;
+		float curv1 = half_to_float(qv.curv_[0]) * curv_scale;
+		float curv2 = half_to_float(qv.curv_[1]) * curv_scale;
+		float dcurv[4];
+		for(int j = 0; j < 4; j++){
+			dcurv[j] = half_to_float(qv.dcurv_[j]) * dcurv_scale;
+		}
+		// compute ndtov
+		trimesh::vec view = camera - mesh->vertices[i];
+		float norm = 1.0f / len(view);
+		view *= norm;
+		float ndotv = normal DOT view;
+		// compute radial curvature (Euler's formula)
+		float u = view DOT pdir1;
+		float u2 = u*u;
+		float t = view DOT pdir2;
+		float v2 = t*t;
+		kr[i] = curv1 * u2 + curv2 * v2;
+		// compute numerator and denominator of derivative of radial curvature
+		num[i] = u2 * ( u*dcurv[0] + 3.0f*t*dcurv[1] ) + v2 * (3.0f*u*dcurv[2] + t*dcurv[3]);
+		float thetafix = (1.0f / (u2+v2));
+		num[i] *= thetafix;
+		float tr = (curv2 - curv1) * u * t *thetafix;
+		num[i] -= 2.0f * ndotv * trimesh::sqr(tr);
+		den[i] = ndotv;
+		// filtering of lines
+		num[i] -= sc_threshold * den[i];
+	}, config.threads_);
+}
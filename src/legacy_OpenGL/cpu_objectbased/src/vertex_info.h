@@ -11,9 +11,15 @@
 
 #include "TriMesh.h"
 #include "Model.h"
+#include "quantize.h"
+#include "ThreadPool.h"
 #include <vector>
 
-void compute_ndotv(const trimesh::TriMesh *mesh, const trimesh::vec camera, std::vector<float> &ndtov);
-void compute_CurvDerivatives(const trimesh::TriMesh *mesh, const trimesh::vec camera, std::vector<float> &kr, std::vector<float> &num, std::vector<float> &den, float sc_threshold);
+// (for the vertices begin ... end-1)
+void compute_ndotv(const trimesh::TriMesh *mesh, const trimesh::vec camera, FrameVector<float> &ndtov, int begin, int end, const KernelConfig &config = KernelConfig());
+void compute_CurvDerivatives(const trimesh::TriMesh *mesh, const trimesh::vec camera, FrameVector<float> &kr, FrameVector<float> &num, FrameVector<float> &den, float sc_threshold, int begin, int end, const KernelConfig &config = KernelConfig());
+// the same, decoding compact attributes on the fly
+void compute_ndotv(const trimesh::TriMesh *mesh, const QuantizedAttributes &q, const trimesh::vec camera, FrameVector<float> &ndtov, int begin, int end, const KernelConfig &config = KernelConfig());
+void compute_CurvDerivatives(const trimesh::TriMesh *mesh, const QuantizedAttributes &q, const trimesh::vec camera, FrameVector<float> &kr, FrameVector<float> &num, FrameVector<float> &den, float sc_threshold, int begin, int end, const KernelConfig &config = KernelConfig());
 
 #endif /* VERTEX_INFO_H_ */
@@ -4,6 +4,9 @@
  *
  * Modified for suggestive contour rendering with shaders by Jeroen Baert
  * www.forceflow.be
+ *
+ * The mesh loader, curvature estimation and the thread pool they run on are shared with the other viewers: compile
+ * src/common along, with it on the include path and TRIMESH_GLOBAL_NAMESPACE defined (see trimesh_compat.h).
  */
 
 #include <GL/glew.h>
@@ -17,12 +20,15 @@
 #include <malloc.h>
 #include "TriMesh.h"
 #include "XForm.h"
+#include "MeshParser.h"
 #include "GLCamera.h"
 #include "ICP.h"
 #include "textfile.h"
 #include <sstream>
 
 #include "FPSCounter.h"
+#include "curvature.h"
+#include "ThreadPool.h"
 
 using std::string;
 using std::cout;
@@ -668,16 +674,22 @@ int main(int argc, char *argv[])
 	if (argc < 2)
 		usage(argv[0]);
 
+	// meshes get parsed, and their curvatures estimated, in parallel on this pool
+	ThreadPool::setDefault(new ThreadPool(0, false));
+
 	for (int i = 1; i < argc; i++) {
 		const char *filename = argv[i];
-		TriMesh *themesh = TriMesh::read(filename);
+		TriMesh *themesh = MeshParser::read(filename);
 		if (!themesh)
 			usage(argv[0]);
 		themesh->need_normals();
 		themesh->need_tstrips();
 		themesh->need_bsphere();
-		themesh->need_curvatures();
-		themesh->need_dcurv();
+		// curvatures and their derivatives are computed in parallel
+		FaceColoring coloring;
+		color_faces(themesh, coloring);
+		compute_curvatures(themesh, coloring);
+		compute_dcurv(themesh, coloring);
 		feature_size = themesh->feature_size();
 		meshes.push_back(themesh);
 
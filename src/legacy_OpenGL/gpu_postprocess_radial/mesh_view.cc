@@ -4,6 +4,9 @@ Princeton University
 
 mesh_view.cc
 Simple viewer
+
+The mesh loader and the thread pool it runs on are shared with the other viewers: compile src/common along, with it
+on the include path and TRIMESH_GLOBAL_NAMESPACE defined (see trimesh_compat.h).
 */
 
 #define GL_GLEXT_PROTOTYPES
@@ -25,6 +28,8 @@ Simple viewer
 #include "TriMesh.h"
 #include "textfile.h"
 #include "XForm.h"
+#include "MeshParser.h"
+#include "ThreadPool.h"
 #include "GLCamera.h"
 #include "ICP.h"
 #include "FPSCounter.h"
@@ -671,9 +676,12 @@ int main(int argc, char *argv[])
 	if (argc < 2)
 		usage(argv[0]);
 
+	// meshes get parsed in parallel on this pool
+	ThreadPool::setDefault(new ThreadPool(0, false));
+
 	for (int i = 1; i < argc; i++) {
 		const char *filename = argv[i];
-		TriMesh *themesh = TriMesh::read(filename);
+		TriMesh *themesh = MeshParser::read(filename);
 		if (!themesh)
 			usage(argv[0]);
 		themesh->need_normals();
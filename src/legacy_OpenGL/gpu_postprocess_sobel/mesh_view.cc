@@ -4,6 +4,9 @@
  *
  * Modified for contour rendering with sobel shader by Jeroen Baert
  * www.forceflow.be
+ *
+ * The mesh loader and the thread pool it runs on are shared with the other viewers: compile src/common along, with it
+ * on the include path and TRIMESH_GLOBAL_NAMESPACE defined (see trimesh_compat.h).
  */
 
 // GL includes
@@ -22,6 +25,8 @@
 #include "TriMesh.h"
 #include "textfile.h"
 #include "XForm.h"
+#include "MeshParser.h"
+#include "ThreadPool.h"
 #include "GLCamera.h"
 #include "ICP.h"
 
@@ -669,9 +674,12 @@ int main(int argc, char *argv[])
 	if (argc < 2)
 		usage(argv[0]);
 
+	// meshes get parsed in parallel on this pool
+	ThreadPool::setDefault(new ThreadPool(0, false));
+
 	for (int i = 1; i < argc; i++) {
 		const char *filename = argv[i];
-		TriMesh *themesh = TriMesh::read(filename);
+		TriMesh *themesh = MeshParser::read(filename);
 		if (!themesh)
 			usage(argv[0]);
 		themesh->need_normals();
@@ -13,6 +13,8 @@ Simple viewer
 #include "TriMesh.h"
 #include "TriMesh_algo.h"
 #include "XForm.h"
+#include "MeshParser.h"
+#include "ThreadPool.h"
 #include "GLCamera.h"
 #include "GLManager.h"
 #include "ICP.h"
@@ -885,13 +887,16 @@ int main(int argc, char *argv[])
 		glutInitWindowSize(window_size, window_size);
 	}
 
+	// meshes get parsed in parallel on this pool
+	ThreadPool::setDefault(new ThreadPool(0, false));
+
 	for (int i = 1; i < argc; i++) {
 		if (!strcmp(argv[i], "-grab")) {
 			grab_only = true;
 			continue;
 		}
 		const char *filename = argv[i];
-		TriMesh *themesh = TriMesh::read(filename);
+		TriMesh *themesh = MeshParser::read(filename);
 		if (!themesh)
 			usage();
 		meshes.push_back(themesh);